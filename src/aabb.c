@@ -0,0 +1,307 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "aabb.h"
+#include "game_types.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HAVE_NEON_KERNEL 1
+#endif
+
+typedef int (*AabbOverlapFn)( AabbBatch const *batch, int first, int last, AabbQuery const *query, int *hits );
+
+static int overlap_scalar( AabbBatch const *batch, int first, int last, AabbQuery const *query, int *hits );
+static float round_down( double value );
+static float round_up( double value );
+static void *grow( void *array, size_t element_size, int capacity );
+
+#ifdef HAVE_X86_KERNELS
+static int overlap_sse2( AabbBatch const *batch, int first, int last, AabbQuery const *query, int *hits );
+static int overlap_avx2( AabbBatch const *batch, int first, int last, AabbQuery const *query, int *hits );
+#endif
+#ifdef HAVE_NEON_KERNEL
+static int overlap_neon( AabbBatch const *batch, int first, int last, AabbQuery const *query, int *hits );
+#endif
+
+// NULL where the kernel isn't compiled for this architecture
+static AabbOverlapFn const kernels[AABB_KERNEL_COUNT] = {
+    [AABB_KERNEL_SCALAR] = overlap_scalar,
+#ifdef HAVE_X86_KERNELS
+    [AABB_KERNEL_SSE2] = overlap_sse2,
+    [AABB_KERNEL_AVX2] = overlap_avx2,
+#endif
+#ifdef HAVE_NEON_KERNEL
+    [AABB_KERNEL_NEON] = overlap_neon,
+#endif
+};
+
+static char const *const kernel_names[AABB_KERNEL_COUNT] = {
+    [AABB_KERNEL_SCALAR] = "scalar",
+    [AABB_KERNEL_SSE2] = "sse2",
+    [AABB_KERNEL_AVX2] = "avx2",
+    [AABB_KERNEL_NEON] = "neon",
+};
+
+static AabbKernel current_kernel = AABB_KERNEL_SCALAR;
+static bool kernel_selected = false;
+
+void aabb_batch_reserve( AabbBatch *batch, int capacity )
+{
+    if (capacity <= batch->capacity)
+    {
+        return;
+    }
+    batch->xmin = grow(batch->xmin, sizeof(float), capacity);
+    batch->xmax = grow(batch->xmax, sizeof(float), capacity);
+    batch->ymin = grow(batch->ymin, sizeof(float), capacity);
+    batch->ymax = grow(batch->ymax, sizeof(float), capacity);
+    batch->enabled = grow(batch->enabled, sizeof(uint32_t), capacity);
+    batch->capacity = capacity;
+}
+
+void aabb_batch_clear( AabbBatch *batch )
+{
+    batch->count = 0;
+}
+
+void aabb_batch_push( AabbBatch *batch, Box const *box )
+{
+    if (batch->count == batch->capacity)
+    {
+        aabb_batch_reserve(batch, batch->capacity ? batch->capacity * 2 : 16);
+    }
+    int i = batch->count++;
+    batch->xmin[i] = round_down(box->top_left.x);
+    batch->xmax[i] = round_up(box->top_left.x + box->width);
+    batch->ymin[i] = round_down(box->top_left.y);
+    batch->ymax[i] = round_up(box->top_left.y + box->height);
+    batch->enabled[i] = box->enabled ? UINT32_MAX : 0;
+}
+
+void aabb_batch_free( AabbBatch *batch )
+{
+    free(batch->xmin);
+    free(batch->xmax);
+    free(batch->ymin);
+    free(batch->ymax);
+    free(batch->enabled);
+    *batch = (AabbBatch) { 0 };
+}
+
+// Same outward rounding as the stored boxes so the float test can only find more overlaps, never fewer
+AabbQuery aabb_query( Box const *box )
+{
+    AabbQuery query = {
+        .xmin = round_down(box->top_left.x),
+        .xmax = round_up(box->top_left.x + box->width),
+        .ymin = round_down(box->top_left.y),
+        .ymax = round_up(box->top_left.y + box->height)
+    };
+    return query;
+}
+
+/*
+ * Writes the indices in [first, last) of the enabled boxes overlapping the query to hits in
+ * ascending order and returns how many there were. hits must have room for last - first.
+*/
+int aabb_overlap( AabbBatch const *batch, int first, int last, AabbQuery const *query, int *hits )
+{
+    if (!kernel_selected)
+    {
+        aabb_use_cpu_features(aabb_detect_cpu_features());
+    }
+    return kernels[current_kernel](batch, first, last, query, hits);
+}
+
+// For builds without SDL - main uses SDL's answers instead so there is one source of truth in the game
+AabbCpuFeatures aabb_detect_cpu_features( void )
+{
+    AabbCpuFeatures features = { false, false, false };
+#if defined(HAVE_X86_KERNELS) && defined(__GNUC__)
+    __builtin_cpu_init();
+    features.sse2 = __builtin_cpu_supports("sse2");
+    features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+#ifdef HAVE_NEON_KERNEL
+    features.neon = true;
+#endif
+    return features;
+}
+
+// Picks the widest kernel that is both compiled in and supported
+void aabb_use_cpu_features( AabbCpuFeatures features )
+{
+    if (!(features.avx2 && aabb_use_kernel(AABB_KERNEL_AVX2))
+        && !(features.neon && aabb_use_kernel(AABB_KERNEL_NEON))
+        && !(features.sse2 && aabb_use_kernel(AABB_KERNEL_SSE2)))
+    {
+        aabb_use_kernel(AABB_KERNEL_SCALAR);
+    }
+}
+
+// Returns false (and keeps the current kernel) if it isn't compiled for this architecture
+bool aabb_use_kernel( AabbKernel kernel )
+{
+    if (kernel >= AABB_KERNEL_COUNT || !kernels[kernel])
+    {
+        return false;
+    }
+    current_kernel = kernel;
+    kernel_selected = true;
+    return true;
+}
+
+AabbKernel aabb_current_kernel( void )
+{
+    if (!kernel_selected)
+    {
+        aabb_use_cpu_features(aabb_detect_cpu_features());
+    }
+    return current_kernel;
+}
+
+char const *aabb_kernel_name( AabbKernel kernel )
+{
+    return (kernel < AABB_KERNEL_COUNT) ? kernel_names[kernel] : "unknown";
+}
+
+/* ------- KERNELS ------- */
+
+// Strict comparisons like box_collision - boxes that only touch don't overlap
+static int overlap_scalar( AabbBatch const *batch, int first, int last, AabbQuery const *query, int *hits )
+{
+    int count = 0;
+    for (int i = first; i < last; i++)
+    {
+        bool overlaps = batch->enabled[i]
+            && query->xmax > batch->xmin[i] && batch->xmax[i] > query->xmin
+            && query->ymax > batch->ymin[i] && batch->ymax[i] > query->ymin;
+        // Written every time and only kept when it hit - no branch to mispredict
+        hits[count] = i;
+        count += overlaps;
+    }
+    return count;
+}
+
+#ifdef HAVE_X86_KERNELS
+__attribute__((target("sse2")))
+static int overlap_sse2( AabbBatch const *batch, int first, int last, AabbQuery const *query, int *hits )
+{
+    __m128 query_xmin = _mm_set1_ps(query->xmin);
+    __m128 query_xmax = _mm_set1_ps(query->xmax);
+    __m128 query_ymin = _mm_set1_ps(query->ymin);
+    __m128 query_ymax = _mm_set1_ps(query->ymax);
+
+    int count = 0;
+    int i = first;
+    for (; i + 4 <= last; i += 4)
+    {
+        __m128 mask = _mm_and_ps(_mm_cmpgt_ps(query_xmax, _mm_loadu_ps(batch->xmin + i)),
+                                 _mm_cmpgt_ps(_mm_loadu_ps(batch->xmax + i), query_xmin));
+        mask = _mm_and_ps(mask, _mm_cmpgt_ps(query_ymax, _mm_loadu_ps(batch->ymin + i)));
+        mask = _mm_and_ps(mask, _mm_cmpgt_ps(_mm_loadu_ps(batch->ymax + i), query_ymin));
+        mask = _mm_and_ps(mask, _mm_castsi128_ps(_mm_loadu_si128((__m128i const *) (batch->enabled + i))));
+
+        for (unsigned bits = (unsigned) _mm_movemask_ps(mask); bits; bits &= bits - 1)
+        {
+            hits[count++] = i + __builtin_ctz(bits);
+        }
+    }
+    return count + overlap_scalar(batch, i, last, query, hits + count);
+}
+
+__attribute__((target("avx2")))
+static int overlap_avx2( AabbBatch const *batch, int first, int last, AabbQuery const *query, int *hits )
+{
+    __m256 query_xmin = _mm256_set1_ps(query->xmin);
+    __m256 query_xmax = _mm256_set1_ps(query->xmax);
+    __m256 query_ymin = _mm256_set1_ps(query->ymin);
+    __m256 query_ymax = _mm256_set1_ps(query->ymax);
+
+    int count = 0;
+    int i = first;
+    for (; i + 8 <= last; i += 8)
+    {
+        // _CMP_GT_OQ is false for NaN, same as the scalar > and _mm_cmpgt_ps
+        __m256 mask = _mm256_and_ps(_mm256_cmp_ps(query_xmax, _mm256_loadu_ps(batch->xmin + i), _CMP_GT_OQ),
+                                    _mm256_cmp_ps(_mm256_loadu_ps(batch->xmax + i), query_xmin, _CMP_GT_OQ));
+        mask = _mm256_and_ps(mask, _mm256_cmp_ps(query_ymax, _mm256_loadu_ps(batch->ymin + i), _CMP_GT_OQ));
+        mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_loadu_ps(batch->ymax + i), query_ymin, _CMP_GT_OQ));
+        mask = _mm256_and_ps(mask, _mm256_castsi256_ps(_mm256_loadu_si256((__m256i const *) (batch->enabled + i))));
+
+        for (unsigned bits = (unsigned) _mm256_movemask_ps(mask); bits; bits &= bits - 1)
+        {
+            hits[count++] = i + __builtin_ctz(bits);
+        }
+    }
+    // Leaving the upper halves dirty makes every later SSE instruction in the tick (ours, libm's, qsort's)
+    // pay a transition penalty - more than the whole kernel saves
+    _mm256_zeroupper();
+    return count + overlap_sse2(batch, i, last, query, hits + count);
+}
+#endif
+
+#ifdef HAVE_NEON_KERNEL
+static int overlap_neon( AabbBatch const *batch, int first, int last, AabbQuery const *query, int *hits )
+{
+    float32x4_t query_xmin = vdupq_n_f32(query->xmin);
+    float32x4_t query_xmax = vdupq_n_f32(query->xmax);
+    float32x4_t query_ymin = vdupq_n_f32(query->ymin);
+    float32x4_t query_ymax = vdupq_n_f32(query->ymax);
+
+    int count = 0;
+    int i = first;
+    for (; i + 4 <= last; i += 4)
+    {
+        uint32x4_t mask = vandq_u32(vcgtq_f32(query_xmax, vld1q_f32(batch->xmin + i)),
+                                    vcgtq_f32(vld1q_f32(batch->xmax + i), query_xmin));
+        mask = vandq_u32(mask, vcgtq_f32(query_ymax, vld1q_f32(batch->ymin + i)));
+        mask = vandq_u32(mask, vcgtq_f32(vld1q_f32(batch->ymax + i), query_ymin));
+        mask = vandq_u32(mask, vld1q_u32(batch->enabled + i));
+
+        // No movemask on NEON - skip the lanes one by one only when something hit
+        uint32_t lanes[4];
+        vst1q_u32(lanes, mask);
+        if (lanes[0] | lanes[1] | lanes[2] | lanes[3])
+        {
+            for (int lane = 0; lane < 4; lane++)
+            {
+                hits[count] = i + lane;
+                count += lanes[lane] & 1;
+            }
+        }
+    }
+    return count + overlap_scalar(batch, i, last, query, hits + count);
+}
+#endif
+
+static float round_down( double value )
+{
+    float rounded = (float) value;
+    return ((double) rounded > value) ? nextafterf(rounded, -INFINITY) : rounded;
+}
+
+static float round_up( double value )
+{
+    float rounded = (float) value;
+    return ((double) rounded < value) ? nextafterf(rounded, INFINITY) : rounded;
+}
+
+static void *grow( void *array, size_t element_size, int capacity )
+{
+    array = realloc(array, element_size * capacity);
+    if (!array)
+    {
+        fprintf(stderr, "Out of memory growing box batch\n");
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
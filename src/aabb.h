@@ -0,0 +1,66 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "game_types.h"
+
+/*
+ * Batched box overlap tests - one query box against a packed array of boxes, 4 or 8 at a time with
+ * SSE2/AVX2 on x86 and NEON on the Pi. Every kernel gives exactly the same hits as the scalar one.
+ * Boxes are stored as floats rounded outwards, so a float overlap is never missed where box_collision
+ * (doubles) would find one - the hits are candidates to confirm with box_collision, never fewer.
+ *
+ * Usage:
+ *   aabb_batch_clear(&batch);  aabb_batch_push(&batch, &box) for each box
+ *   AabbQuery query = aabb_query(&attack_box);
+ *   int count = aabb_overlap(&batch, 0, batch.count, &query, hits);
+*/
+
+typedef struct AabbBatch {
+    float *xmin;
+    float *xmax;
+    float *ymin;
+    float *ymax;
+    uint32_t *enabled;  // All bits set when enabled, 0 otherwise
+    int count;
+    int capacity;
+} AabbBatch;
+
+typedef struct AabbQuery {
+    float xmin;
+    float xmax;
+    float ymin;
+    float ymax;
+} AabbQuery;
+
+typedef enum {
+    AABB_KERNEL_SCALAR,
+    AABB_KERNEL_SSE2,
+    AABB_KERNEL_AVX2,
+    AABB_KERNEL_NEON,
+    AABB_KERNEL_COUNT
+} AabbKernel;
+
+// What the CPU can run - main fills this in from SDL_cpuinfo.h, SDL free builds use aabb_detect_cpu_features
+typedef struct AabbCpuFeatures {
+    bool sse2;
+    bool avx2;
+    bool neon;
+} AabbCpuFeatures;
+
+extern void aabb_batch_reserve( AabbBatch *batch, int capacity );
+extern void aabb_batch_clear( AabbBatch *batch );
+extern void aabb_batch_push( AabbBatch *batch, Box const *box );
+extern void aabb_batch_free( AabbBatch *batch );
+extern AabbQuery aabb_query( Box const *box );
+
+extern int aabb_overlap( AabbBatch const *batch, int first, int last, AabbQuery const *query, int *hits );
+
+extern AabbCpuFeatures aabb_detect_cpu_features( void );
+extern void aabb_use_cpu_features( AabbCpuFeatures features );
+extern bool aabb_use_kernel( AabbKernel kernel );
+extern AabbKernel aabb_current_kernel( void );
+extern char const *aabb_kernel_name( AabbKernel kernel );
+
+#endif
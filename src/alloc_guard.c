@@ -0,0 +1,70 @@
+#include "alloc_guard.h"
+
+#ifdef ALLOC_GUARD
+
+#include <execinfo.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// The sim thread runs matches too, so the section is shared by every thread
+static _Atomic(char const *) guarded;
+
+extern void *__real_malloc( size_t size );
+extern void *__real_calloc( size_t count, size_t size );
+extern void *__real_realloc( void *pointer, size_t size );
+extern void __real_free( void *pointer );
+
+static void check( char const *function );
+
+void alloc_guard_begin( char const *what )
+{
+    atomic_store(&guarded, what);
+}
+
+void alloc_guard_end( void )
+{
+    atomic_store(&guarded, NULL);
+}
+
+void *__wrap_malloc( size_t size )
+{
+    check("malloc");
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc( size_t count, size_t size )
+{
+    check("calloc");
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc( void *pointer, size_t size )
+{
+    check("realloc");
+    return __real_realloc(pointer, size);
+}
+
+void __wrap_free( void *pointer )
+{
+    check("free");
+    __real_free(pointer);
+}
+
+// stderr is unbuffered and the backtrace goes straight to its fd, so reporting doesn't allocate
+static void check( char const *function )
+{
+    char const *what = atomic_load(&guarded);
+    if (!what)
+    {
+        return;
+    }
+    fprintf(stderr, "%s called during %s\n", function, what);
+    void *frames[32];
+    backtrace_symbols_fd(frames, backtrace(frames, 32), STDERR_FILENO);
+    abort();
+}
+
+#endif
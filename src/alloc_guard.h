@@ -0,0 +1,34 @@
+#ifndef ALLOC_GUARD_H
+#define ALLOC_GUARD_H
+
+/*
+ * Debug check that nothing allocates while a match is running - once a match is set up every tick
+ * should run out of the match arena and the preallocated scratch lists, and a malloc on the Pi can
+ * stall a frame for milliseconds. Only compiled in with make ALLOC_GUARD=1, which links with
+ * -Wl,--wrap so every malloc/calloc/realloc/free our code makes goes through alloc_guard.c first -
+ * inside a guarded section that prints a backtrace and aborts. Libraries (SDL, libc's own stdio
+ * buffers) aren't wrapped. Without ALLOC_GUARD the macros expand to nothing.
+ *
+ * Usage:
+ *   set the match up (match_init, combat_reserve etc)
+ *   ALLOC_GUARD_BEGIN("match");
+ *   ... ticks ...
+ *   ALLOC_GUARD_END();
+*/
+
+#ifdef ALLOC_GUARD
+
+#define ALLOC_GUARD_BEGIN(what) alloc_guard_begin(what)
+#define ALLOC_GUARD_END() alloc_guard_end()
+
+#else
+
+#define ALLOC_GUARD_BEGIN(what) ((void) (what))
+#define ALLOC_GUARD_END() ((void) 0)
+
+#endif
+
+extern void alloc_guard_begin( char const *what );
+extern void alloc_guard_end( void );
+
+#endif
@@ -0,0 +1,36 @@
+#include <stdbool.h>
+#include "animation.h"
+#include "game_types.h"
+#include "sword.h"
+#include "roster.h"
+#include "fighter_store.h"
+
+/* Picks which frame of the player's anim_row to draw - no SDL in here. The row itself comes from the state table in player.c */
+
+void animation_update_frame( PlayerState player, double dt )
+{
+    // Frame counts and timing per row come from the fighter (roster.h) - the roster checks every row has frames
+    FighterAnimation const *animation = &player->def->animations[player->anim_row];
+    double time_per_frame = animation->time_per_frame;
+    player->time_in_anim += dt;
+    if ((player->time_in_anim / time_per_frame) >= animation->frames)
+    {
+        if (!animation->loops)
+        {
+            player->time_in_anim -= dt; 
+        } else
+        {
+            player->time_in_anim = 0;
+        }
+    }
+}
+
+int animation_current_frame( PlayerState player )
+{
+    // Only non-kick attacks have special animations
+    if (FIGHTER_STATE(player) == STATE_ATTACK)
+    {
+        return sword_get_frame(player);
+    }
+    return player->time_in_anim / player->def->animations[player->anim_row].time_per_frame;
+}
@@ -0,0 +1,31 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "game_types.h"
+
+/* Rows of the player spritesheet - each row is one animation */
+#define CROUCH_ROW 0
+#define KICK_ROW 1
+#define KICK_DISARMED_ROW 2
+#define HIGH_ATTACK_ROW 3
+#define MIDDLE_ATTACK_ROW 4
+#define LOW_ATTACK_ROW 5
+#define DEATH_ROW 6
+#define DEATH_DISARMED_ROW 7
+#define FALL_ROW 8
+#define FALL_DISARMED_ROW 9
+#define IDLE_LOW_ROW 10
+#define IDLE_DISARMED_ROW 11
+#define IDLE_HIGH_ROW 12
+#define IDLE_MIDDLE_ROW 13
+#define JUMP_ROW 14
+#define JUMP_DISARMED_ROW 15
+#define RUN_ROW 16
+#define RUN_DISARMED_ROW 17
+#define STUNNED_ROW 18
+#define THROW_ROW 19
+
+extern void animation_update_frame( PlayerState player, double dt );
+extern int animation_current_frame( PlayerState player );
+
+#endif
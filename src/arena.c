@@ -0,0 +1,49 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+// Whatever malloc would have given us - enough for any struct or SIMD array we put in here
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+// Returns false (with the reason printed) if the memory can't be had
+bool arena_init( Arena *arena, size_t size )
+{
+    arena->base = malloc(size);
+    arena->size = arena->base ? size : 0;
+    arena->used = 0;
+    if (!arena->base)
+    {
+        fprintf(stderr, "Couldn't allocate a %zu byte arena\n", size);
+        return false;
+    }
+    return true;
+}
+
+// Running out means the arena was sized wrong for what the match needs - not something to recover from
+void *arena_alloc( Arena *arena, size_t size )
+{
+    size_t start = (arena->used + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    if (start > arena->size || size > arena->size - start)
+    {
+        fprintf(stderr, "Arena full - %zu bytes wanted, %zu of %zu used\n", size, arena->used, arena->size);
+        exit(EXIT_FAILURE);
+    }
+    arena->used = start + size;
+    void *memory = arena->base + start;
+    memset(memory, 0, size);
+    return memory;
+}
+
+void arena_reset( Arena *arena )
+{
+    arena->used = 0;
+}
+
+void arena_free( Arena *arena )
+{
+    free(arena->base);
+    *arena = (Arena) { 0 };
+}
@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Linear allocator for everything that lives exactly as long as a match - one malloc up front,
+ * every allocation after that is a pointer bump, and arena_reset drops the lot at once, so setting
+ * up the next match costs nothing and never touches the heap. Nothing is freed on its own.
+ *
+ * Usage:
+ *   Arena arena;
+ *   arena_init(&arena, MATCH_ARENA_SIZE);
+ *   Match match = arena_alloc(&arena, sizeof(struct Match));     // Zeroed
+ *   next match:  arena_reset(&arena), then allocate everything again
+ *   arena_free(&arena) at exit
+*/
+
+typedef struct Arena {
+    unsigned char *base;
+    size_t size;
+    size_t used;
+} Arena;
+
+extern bool arena_init( Arena *arena, size_t size );
+extern void *arena_alloc( Arena *arena, size_t size );
+extern void arena_reset( Arena *arena );
+extern void arena_free( Arena *arena );
+
+#endif
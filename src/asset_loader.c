@@ -0,0 +1,109 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <SDL2/SDL_thread.h>
+#include "asset_loader.h"
+
+struct AssetLoader {
+    SDL_Thread *workers[ASSET_LOADER_MAX_WORKERS];
+    int worker_count;
+    AssetRegion regions[ASSET_LOADER_MAX_REGIONS];
+    int count;
+    atomic_int next;                                // Next region a worker takes
+    atomic_bool ready[ASSET_LOADER_MAX_REGIONS];
+    atomic_bool quit;
+    size_t page_size;
+};
+
+static int asset_loader_run( void *data );
+static void fault_in( AssetRegion const *region, size_t page_size );
+
+//NOTE: must be stopped with asset_loader_stop - the regions have to stay mapped until then
+AssetLoader asset_loader_start( AssetRegion const *regions, int count, int worker_count )
+{
+    assert(count > 0 && count <= ASSET_LOADER_MAX_REGIONS);
+    AssetLoader loader = calloc(1, sizeof(struct AssetLoader));
+    assert(loader != NULL);
+
+    for (int i = 0; i < count; i++)
+    {
+        loader->regions[i] = regions[i];
+        atomic_init(&loader->ready[i], false);
+    }
+    loader->count = count;
+    atomic_init(&loader->next, 0);
+    atomic_init(&loader->quit, false);
+    long page_size = sysconf(_SC_PAGESIZE);
+    loader->page_size = (page_size > 0) ? (size_t) page_size : 4096;
+
+    // More workers than regions would only wait
+    worker_count = (worker_count < 1) ? 1 : worker_count;
+    worker_count = (worker_count > ASSET_LOADER_MAX_WORKERS) ? ASSET_LOADER_MAX_WORKERS : worker_count;
+    worker_count = (worker_count > count) ? count : worker_count;
+    for (int i = 0; i < worker_count; i++)
+    {
+        loader->workers[i] = SDL_CreateThread(asset_loader_run, "asset loader", loader);
+        if (!loader->workers[i])
+        {
+            fprintf(stderr, "Could not create asset loader thread: %s\n", SDL_GetError());
+            exit(EXIT_FAILURE);
+        }
+        loader->worker_count++;
+    }
+    return loader;
+}
+
+// Once true the region's pages are in memory and stay true - the render thread can upload it
+bool asset_loader_ready( AssetLoader loader, int region )
+{
+    return atomic_load_explicit(&loader->ready[region], memory_order_acquire);
+}
+
+// Waits for the workers - the ones still reading finish the region they are on first
+void asset_loader_stop( AssetLoader loader )
+{
+    atomic_store(&loader->quit, true);
+    for (int i = 0; i < loader->worker_count; i++)
+    {
+        SDL_WaitThread(loader->workers[i], NULL);
+    }
+    free(loader);
+}
+
+// Each worker takes the next region nobody has yet, so the pool works through them in order
+static int asset_loader_run( void *data )
+{
+    AssetLoader loader = data;
+    while (!atomic_load(&loader->quit))
+    {
+        int region = atomic_fetch_add(&loader->next, 1);
+        if (region >= loader->count)
+        {
+            break;
+        }
+        fault_in(&loader->regions[region], loader->page_size);
+        atomic_store_explicit(&loader->ready[region], true, memory_order_release);
+    }
+    return 0;
+}
+
+// One read per page of every row (and the row's last byte) - enough to make the kernel bring it all in
+static void fault_in( AssetRegion const *region, size_t page_size )
+{
+    unsigned char sum = 0;
+    for (int row = 0; row < region->rows; row++)
+    {
+        unsigned char const *start = region->data + region->pitch * (size_t) row;
+        for (size_t offset = 0; offset < region->row_size; offset += page_size)
+        {
+            sum ^= start[offset];
+        }
+        sum ^= start[region->row_size - 1];
+    }
+    // Keeps the reads from being optimised away
+    volatile unsigned char sink = sum;
+    (void) sink;
+}
@@ -0,0 +1,36 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Gets the asset pack (pack.h) off the disk on a pool of worker threads while the render thread keeps
+ * drawing. The pack needs no decoding, so a cold boot is spent waiting on page faults - the workers
+ * take that wait by reading every page of each region, in the order given, and the render thread
+ * only uploads regions that are already in memory (GPU uploads have to happen on its thread).
+ *
+ * Usage:
+ *   AssetRegion regions[] = { { pixels, width * 4, pitch, height }, ... };     // Most wanted first
+ *   AssetLoader loader = asset_loader_start(regions, count, 4);
+ *   if (asset_loader_ready(loader, i)) { upload region i }       // Every frame, render thread
+ *   asset_loader_stop(loader);
+*/
+
+#define ASSET_LOADER_MAX_REGIONS 32
+#define ASSET_LOADER_MAX_WORKERS 8
+
+typedef struct {
+    unsigned char const *data;      // First row
+    size_t row_size;                // Bytes of each row that belong to the region
+    size_t pitch;                   // Bytes from one row to the next
+    int rows;
+} AssetRegion;
+
+typedef struct AssetLoader *AssetLoader;
+
+extern AssetLoader asset_loader_start( AssetRegion const *regions, int count, int worker_count );
+extern bool asset_loader_ready( AssetLoader loader, int region );
+extern void asset_loader_stop( AssetLoader loader );
+
+#endif
@@ -0,0 +1,252 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL_image.h>
+#include "pack.h"
+
+/*
+ * Offline asset packer - decodes every image the renderer uses into the pixel format its textures
+ * are created in and writes them, with any data files, into the one pack the game maps at startup
+ * (layout in pack.h). Files ending in .png become images, anything else is stored as it is.
+ *
+ * Usage:
+ *   assetc [-f argb8888|abgr8888] -o <pack> <name>=<file>...
+*/
+
+#define PATH_SIZE 4096
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} Output;
+
+typedef struct {
+    char const *name;
+    SDL_PixelFormatEnum format;
+} Format;
+
+// 4 byte formats GL and GLES renderers upload without converting
+static Format const formats[] = {
+    { "argb8888", SDL_PIXELFORMAT_ARGB8888 },
+    { "abgr8888", SDL_PIXELFORMAT_ABGR8888 },
+};
+
+#define FORMAT_COUNT (sizeof(formats) / sizeof(formats[0]))
+
+static char const *source_path;
+
+static void fail( char const *message, char const *detail );
+static void add_image( Output *out, PackEntry *entry, char const *path, SDL_PixelFormatEnum format );
+static void add_file( Output *out, PackEntry *entry, char const *path );
+static size_t reserve( Output *out, size_t size );
+static bool ends_with( char const *text, char const *suffix );
+
+int main( int argc, char *argv[] )
+{
+    SDL_PixelFormatEnum format = SDL_PIXELFORMAT_ARGB8888;
+    char const *output_path = NULL;
+    int first_source = argc;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            char const *name = argv[++i];
+            format = SDL_PIXELFORMAT_UNKNOWN;
+            for (size_t j = 0; j < FORMAT_COUNT; j++)
+            {
+                format = (strcmp(formats[j].name, name) == 0) ? formats[j].format : format;
+            }
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            output_path = argv[++i];
+        }
+        else
+        {
+            first_source = i;
+            break;
+        }
+    }
+    int entry_count = argc - first_source;
+    if (format == SDL_PIXELFORMAT_UNKNOWN || !output_path || entry_count == 0)
+    {
+        fprintf(stderr, "Usage: %s [-f argb8888|abgr8888] -o <pack> <name>=<file>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (entry_count > PACK_MAX_ENTRIES)
+    {
+        fprintf(stderr, "At most %d files fit in a pack\n", PACK_MAX_ENTRIES);
+        return EXIT_FAILURE;
+    }
+
+    Output out = { 0 };
+    PackHeader header = {
+        .magic = PACK_MAGIC,
+        .version = PACK_VERSION,
+        .entry_count = (uint16_t) entry_count
+    };
+    static PackEntry entries[PACK_MAX_ENTRIES];
+    reserve(&out, sizeof(header) + sizeof(entries[0]) * (size_t) entry_count);
+
+    for (int i = 0; i < entry_count; i++)
+    {
+        char *argument = argv[first_source + i];
+        char *equals = strchr(argument, '=');
+        source_path = argument;
+        if (!equals || equals == argument || equals - argument >= PACK_NAME_SIZE)
+        {
+            fail("expected <name>=<file> with a name under 24 characters", NULL);
+        }
+        *equals = '\0';
+        source_path = equals + 1;
+        for (int j = 0; j < i; j++)
+        {
+            if (strcmp(entries[j].name, argument) == 0)
+            {
+                fail("two entries are called", argument);
+            }
+        }
+        strcpy(entries[i].name, argument);
+        if (ends_with(source_path, ".png"))
+        {
+            add_image(&out, &entries[i], source_path, format);
+        }
+        else
+        {
+            add_file(&out, &entries[i], source_path);
+        }
+    }
+    if (out.size > UINT32_MAX)
+    {
+        fprintf(stderr, "Pack is too big\n");
+        return EXIT_FAILURE;
+    }
+    header.size = (uint32_t) out.size;
+    memcpy(out.data, &header, sizeof(header));
+    memcpy(out.data + sizeof(header), entries, sizeof(entries[0]) * (size_t) entry_count);
+
+    // Written beside the old pack and renamed over it, so a running game that has it mapped keeps its copy
+    char temp_path[PATH_SIZE];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", output_path) >= (int) sizeof(temp_path))
+    {
+        fprintf(stderr, "Output path is too long\n");
+        return EXIT_FAILURE;
+    }
+    FILE *file = fopen(temp_path, "wb");
+    if (!file)
+    {
+        perror(temp_path);
+        return EXIT_FAILURE;
+    }
+    if (fwrite(out.data, 1, out.size, file) != out.size || fclose(file) != 0 || rename(temp_path, output_path) != 0)
+    {
+        perror(output_path);
+        remove(temp_path);
+        return EXIT_FAILURE;
+    }
+    free(out.data);
+    return EXIT_SUCCESS;
+}
+
+static void fail( char const *message, char const *detail )
+{
+    fprintf(stderr, "%s: %s%s%s\n", source_path, message, detail ? " " : "", detail ? detail : "");
+    exit(EXIT_FAILURE);
+}
+
+// Rows are packed tightly (pitch is width * 4) whatever pitch SDL gave the converted surface
+static void add_image( Output *out, PackEntry *entry, char const *path, SDL_PixelFormatEnum format )
+{
+    SDL_Surface *loaded = IMG_Load(path);
+    if (!loaded)
+    {
+        fail("can't load:", IMG_GetError());
+    }
+    SDL_Surface *converted = SDL_ConvertSurfaceFormat(loaded, format, 0);
+    SDL_FreeSurface(loaded);
+    if (!converted)
+    {
+        fail("can't convert:", SDL_GetError());
+    }
+
+    size_t pitch = (size_t) converted->w * 4;
+    size_t size = pitch * (size_t) converted->h;
+    size_t offset = reserve(out, size);
+    for (int row = 0; row < converted->h; row++)
+    {
+        memcpy(out->data + offset + pitch * (size_t) row, (unsigned char const *) converted->pixels + (size_t) converted->pitch * row, pitch);
+    }
+    entry->kind = PACK_IMAGE;
+    entry->format = format;
+    entry->width = (uint32_t) converted->w;
+    entry->height = (uint32_t) converted->h;
+    entry->pitch = (uint32_t) pitch;
+    entry->offset = (uint32_t) offset;
+    entry->size = (uint32_t) size;
+    SDL_FreeSurface(converted);
+}
+
+static void add_file( Output *out, PackEntry *entry, char const *path )
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fail("can't open", NULL);
+    }
+    if (fseek(file, 0, SEEK_END) != 0)
+    {
+        fail("can't read", NULL);
+    }
+    long size = ftell(file);
+    rewind(file);
+    if (size < 0)
+    {
+        fail("can't read", NULL);
+    }
+    size_t offset = reserve(out, (size_t) size);
+    if (fread(out->data + offset, 1, (size_t) size, file) != (size_t) size)
+    {
+        fail("can't read", NULL);
+    }
+    fclose(file);
+    entry->kind = PACK_DATA;
+    entry->offset = (uint32_t) offset;
+    entry->size = (uint32_t) size;
+}
+
+// Zeroed space at the next PACK_ALIGNMENT boundary, returning its offset
+static size_t reserve( Output *out, size_t size )
+{
+    size_t offset = (out->size + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+    size_t end = offset + size;
+    if (end > out->capacity)
+    {
+        size_t capacity = out->capacity ? out->capacity : 4096;
+        while (capacity < end)
+        {
+            capacity *= 2;
+        }
+        unsigned char *data = realloc(out->data, capacity);
+        if (!data)
+        {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        out->data = data;
+        out->capacity = capacity;
+    }
+    memset(out->data + out->size, 0, end - out->size);
+    out->size = end;
+    return offset;
+}
+
+static bool ends_with( char const *text, char const *suffix )
+{
+    size_t length = strlen(text);
+    size_t suffix_length = strlen(suffix);
+    return length >= suffix_length && strcmp(text + length - suffix_length, suffix) == 0;
+}
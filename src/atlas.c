@@ -0,0 +1,72 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "atlas.h"
+
+static bool frame_fits( AtlasHeader const *header, AtlasFrame const *frame );
+
+bool atlas_load( Atlas *atlas, char const *path )
+{
+    static unsigned char buffer[sizeof(Atlas) + 1];
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        perror(path);
+        return false;
+    }
+    size_t size = fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+    return atlas_read(atlas, buffer, size, path);
+}
+
+// An atlas file already in memory (the asset pack) - returns false, with the reason printed, if it
+// isn't one this build can use. name is only for the message
+bool atlas_read( Atlas *atlas, void const *data, size_t size, char const *name )
+{
+    AtlasHeader *header = &atlas->header;
+    bool valid = size >= sizeof(*header);
+    if (valid)
+    {
+        memcpy(header, data, sizeof(*header));
+        size_t frames_size = (size_t) header->rows * header->columns * sizeof(AtlasFrame);
+        valid = header->magic == ATLAS_MAGIC && header->version == ATLAS_VERSION
+            && header->rows * header->columns <= ATLAS_MAX_FRAMES && size == sizeof(*header) + frames_size;
+        if (valid)
+        {
+            memcpy(atlas->frames, (unsigned char const *) data + sizeof(*header), frames_size);
+        }
+    }
+    for (int i = 0; valid && i < header->rows * header->columns; i++)
+    {
+        valid = frame_fits(header, &atlas->frames[i]);
+    }
+    if (!valid)
+    {
+        fprintf(stderr, "%s is not an atlas this build can use - make rebuilds it\n", name);
+    }
+    return valid;
+}
+
+AtlasFrame const *atlas_frame( Atlas const *atlas, int row, int column )
+{
+    if (row < 0 || row >= atlas->header.rows || column < 0 || column >= atlas->header.columns)
+    {
+        return NULL;
+    }
+    AtlasFrame const *frame = &atlas->frames[row * atlas->header.columns + column];
+    return (frame->w > 0) ? frame : NULL;
+}
+
+// Inside the image and inside its cell - then the renderer never has to check
+static bool frame_fits( AtlasHeader const *header, AtlasFrame const *frame )
+{
+    if (frame->w == 0)
+    {
+        return true;
+    }
+    bool flipped_fits = !(header->flags & ATLAS_FLIPPED)
+        || (frame->flipped_x + frame->w <= header->width && frame->flipped_y + frame->h <= header->height);
+    return frame->x + frame->w <= header->width && frame->y + frame->h <= header->height && flipped_fits
+        && frame->offset_x + frame->w <= header->cell_width && frame->offset_y + frame->h <= header->cell_height;
+}
@@ -0,0 +1,68 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Fighter sprites as atlasc packs them - every cell of the spritesheet grid cut down to its opaque
+ * pixels and packed tightly into one image, so the texture holds no empty cells or transparent
+ * borders and nothing is drawn where nothing shows. Built by make from assets/spritesheet.png.
+ *
+ * Files (native byte order):
+ *   <atlas>        AtlasHeader then AtlasFrame[rows][columns]
+ *   <atlas>.png    the packed pixels
+ *
+ * A frame is drawn by scaling the cell it came from onto the screen as before and putting its
+ * packed pixels at (offset_x, offset_y) inside that - mirrored to (cell_width - offset_x - w) when
+ * facing left. With ATLAS_FLIPPED every frame also has a pre-flipped copy to read from instead.
+ *
+ * Usage:
+ *   static Atlas atlas;  atlas_load(&atlas, ATLAS_PATH);     // The game reads it out of the asset pack (pack.h)
+ *   AtlasFrame const *frame = atlas_frame(&atlas, row, column);    // NULL for empty cells
+*/
+
+#define ATLAS_PATH "../assets/spritesheet.atlas"
+#define ATLAS_IMAGE_PATH "../assets/spritesheet.atlas.png"
+
+#define ATLAS_MAGIC 0x534c5441u     // "ATLS"
+#define ATLAS_VERSION 1
+#define ATLAS_MAX_FRAMES 512        // rows * columns
+#define ATLAS_PADDING 1             // Transparent px around every frame so filtering can't bleed
+
+#define ATLAS_FLIPPED (1u << 0)     // Pre-flipped copies are baked in (atlasc -f)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint16_t rows;
+    uint16_t columns;
+    uint16_t cell_width;    // Grid of the source spritesheet
+    uint16_t cell_height;
+    uint16_t width;         // Packed image
+    uint16_t height;
+} AtlasHeader;
+
+typedef struct {
+    uint16_t x;             // Packed pixels - w is 0 for a cell with nothing in it
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint16_t flipped_x;     // Mirrored copy, same size - only with ATLAS_FLIPPED
+    uint16_t flipped_y;
+    uint16_t offset_x;      // Where the packed pixels sat in their cell
+    uint16_t offset_y;
+} AtlasFrame;
+
+typedef struct Atlas {
+    AtlasHeader header;
+    AtlasFrame frames[ATLAS_MAX_FRAMES];
+} Atlas;
+
+extern bool atlas_load( Atlas *atlas, char const *path );
+extern bool atlas_read( Atlas *atlas, void const *data, size_t size, char const *name );
+extern AtlasFrame const *atlas_frame( Atlas const *atlas, int row, int column );
+
+#endif
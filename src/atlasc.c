@@ -0,0 +1,353 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include <SDL_image.h>
+#include "atlas.h"
+
+/*
+ * Offline sprite atlas packer - cuts every cell of a spritesheet grid down to its opaque pixels,
+ * drops the cells with nothing in them and shelf packs what's left into the smallest power of two
+ * wide image it fits, writing that and the frame table the renderer reads (layout in atlas.h).
+ * Frames go tallest first, left to right along shelves, each with ATLAS_PADDING clear pixels around
+ * it. -f also packs a mirrored copy of every frame, for renderers that would rather read a flipped
+ * frame than flip one.
+ *
+ * Usage:
+ *   atlasc -r <rows> -c <columns> [-f] -o <atlas> <spritesheet.png>      also writes <atlas>.png
+*/
+
+#define PATH_SIZE 4096
+#define MIN_WIDTH 64
+#define MAX_SIZE 4096       // Biggest texture the Pi's GPU takes
+
+typedef struct {
+    int width;
+    int height;
+    int pitch;              // Bytes per row
+    uint8_t *pixels;        // RGBA, alpha last
+} Image;
+
+typedef struct {
+    int frame;              // Index into the frame table
+    bool flipped;
+    int w;                  // Padded
+    int h;
+    int x;                  // Where it landed
+    int y;
+} Placement;
+
+static char const *source_path;
+
+static void fail( char const *message, char const *detail );
+static void trim( Image const *sheet, int cell_width, int cell_height, int row, int column, AtlasFrame *frame );
+static int compare_placements( void const *a, void const *b );
+static int pack( Placement *placements, int count, int width );
+static void copy_frame( Image const *sheet, Image *atlas, AtlasFrame const *frame, int cell_x, int cell_y, bool flipped );
+static void write_atlas( char const *path, Atlas const *atlas );
+
+int main( int argc, char *argv[] )
+{
+    int rows = 0;
+    int columns = 0;
+    bool flipped = false;
+    char const *output_path = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            rows = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            columns = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-f") == 0)
+        {
+            flipped = true;
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            output_path = argv[++i];
+        }
+        else if (i == argc - 1)
+        {
+            source_path = argv[i];
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (rows <= 0 || columns <= 0 || !output_path || !source_path)
+    {
+        fprintf(stderr, "Usage: %s -r <rows> -c <columns> [-f] -o <atlas> <spritesheet.png>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (rows * columns > ATLAS_MAX_FRAMES)
+    {
+        fprintf(stderr, "At most %d cells fit in an atlas\n", ATLAS_MAX_FRAMES);
+        return EXIT_FAILURE;
+    }
+
+    SDL_Surface *loaded = IMG_Load(source_path);
+    if (!loaded)
+    {
+        fail("can't load:", IMG_GetError());
+    }
+    SDL_Surface *source = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (!source)
+    {
+        fail("can't convert to RGBA:", SDL_GetError());
+    }
+    Image sheet = { source->w, source->h, source->pitch, source->pixels };
+    if (sheet.width % columns != 0 || sheet.height % rows != 0)
+    {
+        fail("doesn't divide into the grid given", NULL);
+    }
+
+    static Atlas atlas;
+    atlas.header = (AtlasHeader) {
+        .magic = ATLAS_MAGIC,
+        .version = ATLAS_VERSION,
+        .flags = flipped ? ATLAS_FLIPPED : 0,
+        .rows = (uint16_t) rows,
+        .columns = (uint16_t) columns,
+        .cell_width = (uint16_t) (sheet.width / columns),
+        .cell_height = (uint16_t) (sheet.height / rows)
+    };
+
+    static Placement placements[ATLAS_MAX_FRAMES * 2];
+    int count = 0;
+    int widest = 0;
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            int index = row * columns + column;
+            AtlasFrame *frame = &atlas.frames[index];
+            trim(&sheet, atlas.header.cell_width, atlas.header.cell_height, row, column, frame);
+            if (frame->w == 0)
+            {
+                continue;
+            }
+            for (int copy = 0; copy <= (flipped ? 1 : 0); copy++)
+            {
+                placements[count++] = (Placement) {
+                    .frame = index,
+                    .flipped = copy == 1,
+                    .w = frame->w + 2 * ATLAS_PADDING,
+                    .h = frame->h + 2 * ATLAS_PADDING
+                };
+            }
+            if (frame->w + 2 * ATLAS_PADDING > widest)
+            {
+                widest = frame->w + 2 * ATLAS_PADDING;
+            }
+        }
+    }
+    if (count == 0)
+    {
+        fail("has nothing in it", NULL);
+    }
+    qsort(placements, (size_t) count, sizeof(placements[0]), compare_placements);
+
+    // Every width the tallest-first shelves could use, keeping the one with the least area
+    int best_width = 0;
+    long best_area = 0;
+    for (int width = MIN_WIDTH; width <= MAX_SIZE; width *= 2)
+    {
+        if (width < widest)
+        {
+            continue;
+        }
+        int height = pack(placements, count, width);
+        if (height <= MAX_SIZE && (best_width == 0 || (long) width * height < best_area))
+        {
+            best_width = width;
+            best_area = (long) width * height;
+        }
+    }
+    if (best_width == 0)
+    {
+        fail("doesn't fit in one texture", NULL);
+    }
+    atlas.header.width = (uint16_t) best_width;
+    atlas.header.height = (uint16_t) pack(placements, count, best_width);
+
+    SDL_Surface *packed = SDL_CreateRGBSurfaceWithFormat(0, atlas.header.width, atlas.header.height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!packed)
+    {
+        fail("can't create the atlas image:", SDL_GetError());
+    }
+    SDL_FillRect(packed, NULL, 0);
+    Image image = { packed->w, packed->h, packed->pitch, packed->pixels };
+    for (int i = 0; i < count; i++)
+    {
+        Placement const *placement = &placements[i];
+        AtlasFrame *frame = &atlas.frames[placement->frame];
+        int x = placement->x + ATLAS_PADDING;
+        int y = placement->y + ATLAS_PADDING;
+        if (placement->flipped)
+        {
+            frame->flipped_x = (uint16_t) x;
+            frame->flipped_y = (uint16_t) y;
+        }
+        else
+        {
+            frame->x = (uint16_t) x;
+            frame->y = (uint16_t) y;
+        }
+        int row = placement->frame / columns;
+        int column = placement->frame % columns;
+        copy_frame(&sheet, &image, frame, column * atlas.header.cell_width, row * atlas.header.cell_height, placement->flipped);
+    }
+
+    // Image first and both renamed into place, so make never sees a table without its pixels
+    char image_path[PATH_SIZE];
+    char temp_path[PATH_SIZE];
+    if (snprintf(image_path, sizeof(image_path), "%s.png", output_path) >= (int) sizeof(image_path)
+        || snprintf(temp_path, sizeof(temp_path), "%s.png.tmp", output_path) >= (int) sizeof(temp_path))
+    {
+        fprintf(stderr, "Output path is too long\n");
+        return EXIT_FAILURE;
+    }
+    if (IMG_SavePNG(packed, temp_path) != 0 || rename(temp_path, image_path) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", image_path, IMG_GetError());
+        remove(temp_path);
+        return EXIT_FAILURE;
+    }
+    write_atlas(output_path, &atlas);
+
+    SDL_FreeSurface(packed);
+    SDL_FreeSurface(source);
+    return EXIT_SUCCESS;
+}
+
+static void fail( char const *message, char const *detail )
+{
+    fprintf(stderr, "%s: %s%s%s\n", source_path, message, detail ? " " : "", detail ? detail : "");
+    exit(EXIT_FAILURE);
+}
+
+// Smallest rectangle holding every pixel with any alpha - w stays 0 for an empty cell
+static void trim( Image const *sheet, int cell_width, int cell_height, int row, int column, AtlasFrame *frame )
+{
+    int left = cell_width;
+    int right = -1;
+    int top = cell_height;
+    int bottom = -1;
+    for (int y = 0; y < cell_height; y++)
+    {
+        uint8_t const *line = sheet->pixels + (size_t) (row * cell_height + y) * sheet->pitch + (size_t) column * cell_width * 4;
+        for (int x = 0; x < cell_width; x++)
+        {
+            if (line[x * 4 + 3] != 0)
+            {
+                left = (x < left) ? x : left;
+                right = (x > right) ? x : right;
+                top = (y < top) ? y : top;
+                bottom = y;
+            }
+        }
+    }
+    *frame = (AtlasFrame) { 0 };
+    if (right < 0)
+    {
+        return;
+    }
+    frame->w = (uint16_t) (right - left + 1);
+    frame->h = (uint16_t) (bottom - top + 1);
+    frame->offset_x = (uint16_t) left;
+    frame->offset_y = (uint16_t) top;
+}
+
+// Tallest first, then widest - ties by frame so the same sheet always packs the same way
+static int compare_placements( void const *a, void const *b )
+{
+    Placement const *first = a;
+    Placement const *second = b;
+    if (first->h != second->h)
+    {
+        return second->h - first->h;
+    }
+    if (first->w != second->w)
+    {
+        return second->w - first->w;
+    }
+    if (first->frame != second->frame)
+    {
+        return first->frame - second->frame;
+    }
+    return (int) first->flipped - (int) second->flipped;
+}
+
+// Fills shelves left to right - a shelf is as tall as its first (tallest) frame. Returns the height used
+static int pack( Placement *placements, int count, int width )
+{
+    int x = 0;
+    int shelf_y = 0;
+    int shelf_height = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (x + placements[i].w > width)
+        {
+            x = 0;
+            shelf_y += shelf_height;
+            shelf_height = 0;
+        }
+        if (shelf_height == 0)
+        {
+            shelf_height = placements[i].h;
+        }
+        placements[i].x = x;
+        placements[i].y = shelf_y;
+        x += placements[i].w;
+    }
+    return shelf_y + shelf_height;
+}
+
+static void copy_frame( Image const *sheet, Image *atlas, AtlasFrame const *frame, int cell_x, int cell_y, bool flipped )
+{
+    int x = flipped ? frame->flipped_x : frame->x;
+    int y = flipped ? frame->flipped_y : frame->y;
+    for (int row = 0; row < frame->h; row++)
+    {
+        uint8_t const *from = sheet->pixels + (size_t) (cell_y + frame->offset_y + row) * sheet->pitch + (size_t) (cell_x + frame->offset_x) * 4;
+        uint8_t *to = atlas->pixels + (size_t) (y + row) * atlas->pitch + (size_t) x * 4;
+        if (!flipped)
+        {
+            memcpy(to, from, (size_t) frame->w * 4);
+            continue;
+        }
+        for (int column = 0; column < frame->w; column++)
+        {
+            memcpy(to + column * 4, from + (frame->w - 1 - column) * 4, 4);
+        }
+    }
+}
+
+static void write_atlas( char const *path, Atlas const *atlas )
+{
+    char temp_path[PATH_SIZE];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE *file = fopen(temp_path, "wb");
+    if (!file)
+    {
+        perror(temp_path);
+        exit(EXIT_FAILURE);
+    }
+    size_t frame_count = (size_t) atlas->header.rows * atlas->header.columns;
+    if (fwrite(&atlas->header, sizeof(atlas->header), 1, file) != 1
+        || fwrite(atlas->frames, sizeof(AtlasFrame), frame_count, file) != frame_count
+        || fclose(file) != 0 || rename(temp_path, path) != 0)
+    {
+        perror(path);
+        remove(temp_path);
+        exit(EXIT_FAILURE);
+    }
+}
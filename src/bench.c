@@ -0,0 +1,766 @@
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "animation.h"
+#include "combat.h"
+#include "aabb.h"
+#include "game_types.h"
+#include "input.h"
+#include "player.h"
+#include "sword.h"
+#include "match.h"
+#include "projectile.h"
+#include "snapshot.h"
+#include "roster.h"
+#include "fighter_store.h"
+
+/*
+ * Microbenchmarks for the functions that run every tick/frame.
+ * Usage: ./microbench [-o results.csv] [-b baseline.csv] [-t threshold_percent] [-f filter]
+ *   -o  write results as CSV (name,iterations,min_ns,median_ns,mean_ns,stddev_ns)
+ *   -b  compare medians against a previous results file, exits with 1 if anything regressed
+ *   -t  how much slower (in %) than the baseline counts as a regression (default 10)
+ *   -f  only run benchmarks whose name contains this string
+ * Normally run through make bench / make bench-baseline.
+*/
+
+#define MAX_BENCHMARKS 256
+#define WARMUP_ITERATIONS 10000
+#define SAMPLES 31
+#define MIN_SAMPLE_NS 200000        // Each sample runs enough iterations to take at least 0.2ms
+#define REGRESSION_FLOOR_NS 1.0     // Ignore differences smaller than this - timer noise
+#define SETUP_TICKS 12              // Ticks to simulate when setting a state up
+
+typedef void (*BenchFn)( void *ctx );
+
+typedef struct {
+    char name[64];
+    uint64_t iterations;
+    double min_ns;
+    double median_ns;
+    double mean_ns;
+    double stddev_ns;
+} BenchResult;
+
+typedef struct {
+    struct PlayerState template;    // Copied over work before every call so each call sees the same state
+    struct PlayerState work;
+    struct PlayerState other;       // Second player for combat
+    struct PlayerState other_work;
+    FighterStore templates;         // template and other
+    FighterStore working;           // work and other_work, so combat_update sees just those two
+    _Alignas(double) unsigned char template_memory[FIGHTER_STORE_SIZE(2)];
+    _Alignas(double) unsigned char working_memory[FIGHTER_STORE_SIZE(2)];
+    PlayerInput input;
+    Box box1, box2;
+    Vector_2D move1, move2;         // For box_time_of_impact
+} BenchCtx;
+
+// Lots of fighters spread out so no boxes touch - nothing changes so no copying between calls
+typedef struct {
+    struct PlayerState *states;
+    FighterStore fighters;
+    void *fighter_memory;
+    int count;
+    PlayerInput *inputs;
+} CrowdCtx;
+
+// A full pool of swords hanging in the air - no speed or gravity, so every call does the same work
+typedef struct {
+    ProjectilePool pool;
+    struct PlayerState states[PROJECTILE_POOL_CAPACITY];    // Owners
+    FighterStore fighters;
+    _Alignas(double) unsigned char fighter_memory[FIGHTER_STORE_SIZE(PROJECTILE_POOL_CAPACITY)];
+} ProjectileCtx;
+
+#define AABB_BATCH_BOXES 1024
+
+typedef struct {
+    AabbBatch batch;
+    AabbQuery query;
+    int hits[AABB_BATCH_BOXES];
+} BatchCtx;
+
+static BenchResult results[MAX_BENCHMARKS];
+static int result_count = 0;
+static char const *filter = NULL;
+
+// Written to so the compiler can't throw away calls whose results we don't use
+static volatile int sink;
+
+// What the snapshot benchmarks save and restore - match_init'd in main
+static struct Match snapshot_match;
+
+static const PlayerInput NO_INPUT = {0.0, JOYSTICK_MID, false, false};
+
+static uint64_t now_ns( void )
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static int compare_doubles( void const *a, void const *b )
+{
+    double x = *(double const *) a, y = *(double const *) b;
+    return (x > y) - (x < y);
+}
+
+static void bench_run( char const *name, BenchFn fn, void *ctx )
+{
+    if (filter && !strstr(name, filter))
+    {
+        return;
+    }
+    if (result_count == MAX_BENCHMARKS)
+    {
+        fprintf(stderr, "Too many benchmarks - increase MAX_BENCHMARKS\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < WARMUP_ITERATIONS; i++)
+    {
+        fn(ctx);
+    }
+
+    // Find how many iterations make a sample long enough to time accurately
+    uint64_t iterations = 1;
+    while (true)
+    {
+        uint64_t start = now_ns();
+        for (uint64_t i = 0; i < iterations; i++)
+        {
+            fn(ctx);
+        }
+        if (now_ns() - start >= MIN_SAMPLE_NS)
+        {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    double samples[SAMPLES];
+    double sum = 0.0;
+    for (int s = 0; s < SAMPLES; s++)
+    {
+        uint64_t start = now_ns();
+        for (uint64_t i = 0; i < iterations; i++)
+        {
+            fn(ctx);
+        }
+        samples[s] = (double) (now_ns() - start) / (double) iterations;
+        sum += samples[s];
+    }
+    qsort(samples, SAMPLES, sizeof(double), compare_doubles);
+
+    BenchResult *result = &results[result_count++];
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->iterations = iterations * SAMPLES;
+    result->min_ns = samples[0];
+    result->median_ns = samples[SAMPLES / 2];
+    result->mean_ns = sum / SAMPLES;
+
+    double variance = 0.0;
+    for (int s = 0; s < SAMPLES; s++)
+    {
+        variance += (samples[s] - result->mean_ns) * (samples[s] - result->mean_ns);
+    }
+    result->stddev_ns = sqrt(variance / (SAMPLES - 1));
+
+    printf("%-48s %10.2f ns  (min %.2f, mean %.2f, sd %.2f)\n", result->name,
+        result->median_ns, result->min_ns, result->mean_ns, result->stddev_ns);
+}
+
+/* ------- Benchmarked calls ------- */
+
+static void run_state_copy( void *ctx )
+{
+    BenchCtx *c = ctx;
+    player_copy(&c->work, &c->template);
+    sink = FIGHTER_STATE(&c->work);
+}
+
+static void run_player_update( void *ctx )
+{
+    BenchCtx *c = ctx;
+    player_copy(&c->work, &c->template);
+    player_update(&c->work, c->input, SIM_DT);
+}
+
+static void run_combat_update( void *ctx )
+{
+    BenchCtx *c = ctx;
+    player_copy(&c->work, &c->template);
+    player_copy(&c->other_work, &c->other);
+    combat_update(&c->working, NULL);
+}
+
+static void run_combat_crowd( void *ctx )
+{
+    CrowdCtx *c = ctx;
+    combat_update(&c->fighters, NULL);
+}
+
+static void run_projectile_pool_update( void *ctx )
+{
+    ProjectileCtx *c = ctx;
+    projectile_pool_update(&c->pool, &c->fighters, SIM_DT);
+}
+
+static void run_player_update_crowd( void *ctx )
+{
+    CrowdCtx *c = ctx;
+    for (int i = 0; i < c->count; i++)
+    {
+        player_update(c->fighters.players[i], c->inputs[i], SIM_DT);
+    }
+}
+
+static void run_player_update_batch_crowd( void *ctx )
+{
+    CrowdCtx *c = ctx;
+    player_update_batch(&c->fighters, c->inputs, SIM_DT);
+}
+
+static void run_aabb_overlap( void *ctx )
+{
+    BatchCtx *c = ctx;
+    sink = aabb_overlap(&c->batch, 0, c->batch.count, &c->query, c->hits);
+}
+
+static void run_box_collision( void *ctx )
+{
+    BenchCtx *c = ctx;
+    sink = box_collision(c->box1, c->box2);
+}
+
+static void run_box_time_of_impact( void *ctx )
+{
+    BenchCtx *c = ctx;
+    double time;
+    sink = box_time_of_impact(c->box1, c->move1, c->box2, c->move2, &time);
+}
+
+static void run_sword_get_frame( void *ctx )
+{
+    BenchCtx *c = ctx;
+    sink = sword_get_frame(&c->template);
+}
+
+static void run_sword_update_attack_hitbox( void *ctx )
+{
+    BenchCtx *c = ctx;
+    sword_update_attack_hitbox(&c->work);
+}
+
+static void run_player_update_attachments( void *ctx )
+{
+    BenchCtx *c = ctx;
+    player_update_attachments(&c->work);
+}
+
+static void run_move_sword_to_player( void *ctx )
+{
+    BenchCtx *c = ctx;
+    move_sword_to_player(&c->work.sword, FIGHTER_POS(&c->work), c->work.is_right_facing, c->work.stance);
+}
+
+static void run_update_player_frame( void *ctx )
+{
+    BenchCtx *c = ctx;
+    animation_update_frame(&c->work, 1.0 / 60.0);
+}
+
+static void run_snapshot_save( void *ctx )
+{
+    game_snapshot_save(ctx, &snapshot_match, 0.0);
+}
+
+static void run_snapshot_restore( void *ctx )
+{
+    sink = game_snapshot_restore(ctx, &snapshot_match, NULL);
+}
+
+static void run_snapshot_hash( void *ctx )
+{
+    sink = (int) game_snapshot_hash(ctx);
+}
+
+/* ------- Setting up states ------- */
+
+static void step( PlayerState player, PlayerInput input, int ticks )
+{
+    for (int i = 0; i < ticks; i++)
+    {
+        player_update(player, input, SIM_DT);
+    }
+}
+
+// player must already be bound to a store slot - it keeps it
+static void new_player( PlayerState player, Stance stance )
+{
+    FighterStore *store = player->store;
+    int slot = player->slot;
+    memset(player, 0, sizeof(struct PlayerState));
+    fighter_store_bind(store, slot, player);
+    player_init(player, PLAYER_1, 0);
+    player->stance = stance;
+    FIGHTER_POS(player).x = SCREEN_SIZE_X / 2.0;
+    step(player, NO_INPUT, SETUP_TICKS);
+}
+
+// Every state here is reached through player_update so it is one the game can really be in
+static bool setup_state( PlayerState player, Stance stance, char const *state, PlayerInput *input )
+{
+    PlayerInput right = NO_INPUT, jump = NO_INPUT, attack = NO_INPUT, down = NO_INPUT;
+    right.move_x = 1.0;
+    jump.jump_pressed = true;
+    attack.attack_pressed = true;
+    down.joystick_pos = JOYSTICK_DOWN;
+
+    new_player(player, stance);
+    *input = NO_INPUT;
+
+    if (strcmp(state, "idle") == 0)
+    {
+        return true;
+    }
+    if (strcmp(state, "run") == 0)
+    {
+        step(player, right, SETUP_TICKS);
+        *input = right;
+        return true;
+    }
+    if (strcmp(state, "jump") == 0)
+    {
+        step(player, jump, 1);
+        step(player, NO_INPUT, SETUP_TICKS);
+        return FIGHTER_STATE(player) == STATE_JUMP;
+    }
+    if (strcmp(state, "dive_kick") == 0)
+    {
+        step(player, jump, 1);
+        step(player, NO_INPUT, SETUP_TICKS);
+        step(player, attack, 1);
+        return FIGHTER_STATE(player) == STATE_DIVE_KICK;
+    }
+    if (strcmp(state, "crouch") == 0)
+    {
+        // Have to hold down from LOW to crouch
+        for (int i = 0; i < SIM_TICK_RATE && FIGHTER_STATE(player) != STATE_CROUCH; i++)
+        {
+            step(player, down, 1);
+        }
+        *input = down;
+        return FIGHTER_STATE(player) == STATE_CROUCH;
+    }
+    if (strcmp(state, "stunned") == 0)
+    {
+        // Kicked by itself - only the attacker's def and facing are read, and knocking doesn't change them
+        player_receive_dive_kick(player, player);
+        step(player, NO_INPUT, SETUP_TICKS);
+        return FIGHTER_STATE(player) == STATE_STUNNED || FIGHTER_STATE(player) == STATE_STUNNED_LANDED;
+    }
+    if (strcmp(state, "dead") == 0)
+    {
+        player_set_death_state(player);
+        return true;
+    }
+    return false;
+}
+
+// Holds attack until the sword reaches the given frame of its attack
+static bool setup_attack_phase( PlayerState player, Stance stance, int phase )
+{
+    PlayerInput attack = NO_INPUT;
+    attack.attack_pressed = true;
+
+    new_player(player, stance);
+    step(player, attack, 1);
+    for (int i = 0; i < 2 * SIM_TICK_RATE && FIGHTER_STATE(player) == STATE_ATTACK; i++)
+    {
+        if (sword_get_frame(player) == phase)
+        {
+            return true;
+        }
+        step(player, NO_INPUT, 1);
+    }
+    return false;
+}
+
+static char const *stance_name( Stance stance )
+{
+    switch (stance)
+    {
+        case LOW: return "low";
+        case MIDDLE: return "middle";
+        case HIGH: return "high";
+        default: return "unknown";
+    }
+}
+
+static void bench_player_states( BenchCtx *c )
+{
+    static char const *states[] = { "idle", "run", "jump", "dive_kick", "crouch", "stunned", "dead" };
+    char name[64];
+
+    for (Stance stance = LOW; stance <= HIGH; stance++)
+    {
+        for (size_t s = 0; s < sizeof(states) / sizeof(states[0]); s++)
+        {
+            if (!setup_state(&c->template, stance, states[s], &c->input))
+            {
+                // e.g. can only crouch from LOW
+                continue;
+            }
+            player_copy(&c->work, &c->template);
+
+            snprintf(name, sizeof(name), "player_update/%s/%s", stance_name(stance), states[s]);
+            bench_run(name, run_player_update, c);
+            snprintf(name, sizeof(name), "player_update_attachments/%s/%s", stance_name(stance), states[s]);
+            bench_run(name, run_player_update_attachments, c);
+            snprintf(name, sizeof(name), "update_player_frame/%s/%s", stance_name(stance), states[s]);
+            bench_run(name, run_update_player_frame, c);
+        }
+
+        for (int phase = 0; phase < 4; phase++)
+        {
+            if (!setup_attack_phase(&c->template, stance, phase))
+            {
+                continue;
+            }
+            player_copy(&c->work, &c->template);
+            c->input = NO_INPUT;
+
+            snprintf(name, sizeof(name), "player_update/%s/attack_%d", stance_name(stance), phase);
+            bench_run(name, run_player_update, c);
+            snprintf(name, sizeof(name), "sword_get_frame/%s/attack_%d", stance_name(stance), phase);
+            bench_run(name, run_sword_get_frame, c);
+            snprintf(name, sizeof(name), "sword_update_attack_hitbox/%s/attack_%d", stance_name(stance), phase);
+            bench_run(name, run_sword_update_attack_hitbox, c);
+        }
+    }
+
+    new_player(&c->work, MIDDLE);
+    bench_run("move_sword_to_player", run_move_sword_to_player, c);
+}
+
+static void bench_combat( BenchCtx *c )
+{
+    PlayerInput input;
+
+    // Far apart - every check misses
+    setup_state(&c->template, MIDDLE, "idle", &input);
+    setup_state(&c->other, MIDDLE, "idle", &input);
+    FIGHTER_POS(&c->other).x = SCREEN_SIZE_X;
+    step(&c->other, NO_INPUT, 1);
+    bench_run("combat_update/no_contact", run_combat_update, c);
+
+    // Standing on top of each other - player 2's sword kills player 1 on the first check
+    setup_state(&c->template, MIDDLE, "idle", &input);
+    setup_state(&c->other, MIDDLE, "idle", &input);
+    run_combat_update(c);
+    if (player_is_dead(&c->work))
+    {
+        bench_run("combat_update/sword_kill", run_combat_update, c);
+    }
+
+    // Player 1 dive kicks a crouching player 2 (crouching puts the sword away) - last check hits
+    setup_state(&c->template, MIDDLE, "dive_kick", &input);
+    setup_state(&c->other, LOW, "crouch", &input);
+    FIGHTER_HURTBOX(&c->other).top_left = c->template.hitbox.top_left;
+    run_combat_update(c);
+    if (FIGHTER_STATE(&c->other_work) == STATE_STUNNED)
+    {
+        bench_run("combat_update/dive_kick", run_combat_update, c);
+    }
+
+    // Broadphase cost as the fighter count goes up
+    int crowd_sizes[] = { 4, 64, 1024 };
+    for (int s = 0; s < (int) (sizeof(crowd_sizes) / sizeof(crowd_sizes[0])); s++)
+    {
+        CrowdCtx crowd = { .count = crowd_sizes[s] };
+        crowd.states = calloc(crowd.count, sizeof(struct PlayerState));
+        crowd.fighter_memory = malloc(FIGHTER_STORE_SIZE(crowd.count));
+        assert(crowd.states != NULL && crowd.fighter_memory != NULL);
+        fighter_store_init(&crowd.fighters, crowd.fighter_memory, crowd.count);
+        for (int i = 0; i < crowd.count; i++)
+        {
+            // Moved after the update as player_update keeps fighters on screen
+            fighter_store_bind(&crowd.fighters, i, &crowd.states[i]);
+            setup_state(&crowd.states[i], (Stance) (i % 3), "idle", &input);
+            double dx = i * 4.0 * SCREEN_SIZE_X / 16.0;
+            crowd.fighters.pos[i].x += dx;
+            crowd.fighters.prev_pos[i].x += dx;
+            crowd.fighters.hurtbox[i].top_left.x += dx;
+            crowd.states[i].sword.hitbox.top_left.x += dx;
+            crowd.states[i].hitbox.top_left.x += dx;
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "combat_update/crowd_%d", crowd.count);
+        bench_run(name, run_combat_crowd, &crowd);
+        free(crowd.states);
+        free(crowd.fighter_memory);
+    }
+
+    c->box1 = (Box) { {0.0, 0.0}, 50.0, 150.0, true };
+    c->box2 = (Box) { {25.0, 100.0}, 55.0, 10.0, true };
+    bench_run("box_collision/overlap", run_box_collision, c);
+    c->box2.top_left.x = 500.0;
+    bench_run("box_collision/apart", run_box_collision, c);
+    c->box2.enabled = false;
+    bench_run("box_collision/disabled", run_box_collision, c);
+
+    // A dive kick box that went right through a hurtbox during the tick
+    c->box1 = (Box) { {0.0, 0.0}, 50.0, 150.0, true };
+    c->box2 = (Box) { {100.0, 100.0}, 40.0, 30.0, true };
+    c->move1 = (Vector_2D) { 0.0, 0.0 };
+    c->move2 = (Vector_2D) { 180.0, 10.0 };
+    bench_run("box_time_of_impact/pass_through", run_box_time_of_impact, c);
+    c->box2.top_left.y = 300.0;
+    bench_run("box_time_of_impact/miss", run_box_time_of_impact, c);
+}
+
+// player_update over a whole crowd, one fighter at a time and as one batch. Everyone runs towards a
+// wall and then keeps pushing into it, so the state settles during the warmup and stays put
+static void bench_crowd_update( void )
+{
+    CrowdCtx crowd = { .count = 1024 };
+    crowd.states = calloc(crowd.count, sizeof(struct PlayerState));
+    crowd.fighter_memory = malloc(FIGHTER_STORE_SIZE(crowd.count));
+    crowd.inputs = calloc(crowd.count, sizeof(PlayerInput));
+    assert(crowd.states != NULL && crowd.fighter_memory != NULL && crowd.inputs != NULL);
+    fighter_store_init(&crowd.fighters, crowd.fighter_memory, crowd.count);
+    for (int i = 0; i < crowd.count; i++)
+    {
+        fighter_store_bind(&crowd.fighters, i, &crowd.states[i]);
+        new_player(&crowd.states[i], (Stance) (i % 3));
+        crowd.inputs[i] = NO_INPUT;
+        crowd.inputs[i].move_x = (i % 2 == 0) ? 1.0 : -1.0;
+    }
+
+    bench_run("player_update/crowd_1024", run_player_update_crowd, &crowd);
+    bench_run("player_update_batch/crowd_1024", run_player_update_batch_crowd, &crowd);
+
+    free(crowd.states);
+    free(crowd.fighter_memory);
+    free(crowd.inputs);
+}
+
+static void bench_projectiles( void )
+{
+    static ProjectileCtx c;
+    projectile_pool_clear(&c.pool);
+    fighter_store_init(&c.fighters, c.fighter_memory, PROJECTILE_POOL_CAPACITY);
+    for (int i = 0; i < PROJECTILE_POOL_CAPACITY; i++)
+    {
+        fighter_store_bind(&c.fighters, i, &c.states[i]);
+        new_player(&c.states[i], MIDDLE);
+        c.pool.pos_x[i] = (i + 0.5) * SCREEN_SIZE_X / PROJECTILE_POOL_CAPACITY;
+        c.pool.pos_y[i] = SCREEN_SIZE_Y / 2.0;
+        c.pool.vel_x[i] = c.pool.vel_y[i] = c.pool.gravity[i] = 0.0;
+        c.pool.half_width[i] = c.states[i].def->sword_length / 2.0;
+        c.pool.half_height[i] = c.states[i].def->sword_width / 2.0;
+        c.pool.flags[i] = PROJECTILE_FLYING;
+        c.pool.owner[i] = i;
+        c.states[i].sword.thrown = true;
+    }
+    c.pool.count = PROJECTILE_POOL_CAPACITY;
+    bench_run("projectile_pool_update/full", run_projectile_pool_update, &c);
+}
+
+// Every kernel this CPU can run against the same boxes - their hits must match the scalar kernel exactly
+static bool bench_aabb( void )
+{
+    static BatchCtx c;
+    static int expected[AABB_BATCH_BOXES];
+    AabbKernel detected = aabb_current_kernel();
+
+    // Fighter sized boxes scattered over a few screens with every 8th one switched off
+    uint32_t random = 12345;
+    for (int i = 0; i < AABB_BATCH_BOXES; i++)
+    {
+        random = random * 1664525u + 1013904223u;
+        Box box = { { (random >> 8) % (4 * SCREEN_SIZE_X), (random >> 4) % SCREEN_SIZE_Y }, 50.0, 150.0, i % 8 != 0 };
+        aabb_batch_push(&c.batch, &box);
+    }
+    Box attack = { { SCREEN_SIZE_X, SCREEN_SIZE_Y / 2.0 }, 300.0, 40.0, true };
+    c.query = aabb_query(&attack);
+
+    aabb_use_kernel(AABB_KERNEL_SCALAR);
+    int expected_count = aabb_overlap(&c.batch, 0, c.batch.count, &c.query, expected);
+
+    bool all_match = true;
+    for (AabbKernel kernel = AABB_KERNEL_SCALAR; kernel < AABB_KERNEL_COUNT; kernel++)
+    {
+        AabbCpuFeatures cpu = aabb_detect_cpu_features();
+        bool supported = kernel == AABB_KERNEL_SCALAR || (kernel == AABB_KERNEL_SSE2 && cpu.sse2)
+            || (kernel == AABB_KERNEL_AVX2 && cpu.avx2) || (kernel == AABB_KERNEL_NEON && cpu.neon);
+        if (!supported || !aabb_use_kernel(kernel))
+        {
+            continue;
+        }
+
+        int count = aabb_overlap(&c.batch, 0, c.batch.count, &c.query, c.hits);
+        if (count != expected_count || memcmp(c.hits, expected, count * sizeof(int)) != 0)
+        {
+            fprintf(stderr, "aabb_overlap %s kernel disagrees with scalar (%d hits, expected %d)\n",
+                aabb_kernel_name(kernel), count, expected_count);
+            all_match = false;
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "aabb_overlap/%s/%d_boxes", aabb_kernel_name(kernel), AABB_BATCH_BOXES);
+        bench_run(name, run_aabb_overlap, &c);
+    }
+    aabb_use_kernel(detected);
+    aabb_batch_free(&c.batch);
+    return all_match;
+}
+
+/* ------- Results ------- */
+
+static void write_results( char const *path )
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "Could not write %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(file, "name,iterations,min_ns,median_ns,mean_ns,stddev_ns\n");
+    for (int i = 0; i < result_count; i++)
+    {
+        BenchResult *r = &results[i];
+        fprintf(file, "%s,%llu,%.3f,%.3f,%.3f,%.3f\n", r->name, (unsigned long long) r->iterations,
+            r->min_ns, r->median_ns, r->mean_ns, r->stddev_ns);
+    }
+    fclose(file);
+    printf("Wrote %d results to %s\n", result_count, path);
+}
+
+// Returns number of regressions
+static int compare_baseline( char const *path, double threshold_percent )
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "Could not read baseline %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    int regressions = 0;
+    char line[256];
+    char name[64];
+    unsigned long long iterations;
+    double min_ns, median_ns, mean_ns, stddev_ns;
+
+    printf("\nComparing medians against %s (threshold %.1f%%):\n", path, threshold_percent);
+    while (fgets(line, sizeof(line), file))
+    {
+        if (sscanf(line, "%63[^,],%llu,%lf,%lf,%lf,%lf", name, &iterations, &min_ns, &median_ns, &mean_ns, &stddev_ns) != 6)
+        {
+            // Header line
+            continue;
+        }
+        for (int i = 0; i < result_count; i++)
+        {
+            if (strcmp(results[i].name, name) != 0)
+            {
+                continue;
+            }
+            double difference = results[i].median_ns - median_ns;
+            double percent = (median_ns > 0.0) ? 100.0 * difference / median_ns : 0.0;
+            if (percent > threshold_percent && difference > REGRESSION_FLOOR_NS)
+            {
+                printf("  REGRESSION %-48s %8.2f -> %8.2f ns (%+.1f%%)\n", name, median_ns, results[i].median_ns, percent);
+                regressions++;
+            }
+            else if (-percent > threshold_percent && -difference > REGRESSION_FLOOR_NS)
+            {
+                printf("  faster     %-48s %8.2f -> %8.2f ns (%+.1f%%)\n", name, median_ns, results[i].median_ns, percent);
+            }
+        }
+    }
+    fclose(file);
+
+    printf("%d regression(s)\n", regressions);
+    return regressions;
+}
+
+int main( int argc, char **argv )
+{
+    char const *output_path = NULL;
+    char const *baseline_path = NULL;
+    double threshold_percent = 10.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            output_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            baseline_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            threshold_percent = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [-o results.csv] [-b baseline.csv] [-t threshold_percent] [-f filter]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    combat_verbose = false;
+    // Every player here is the roster's first fighter
+    if (!roster_open(roster_path(ROSTER_PATH)))
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Static so the (large) player structs don't need to be set up on the stack
+    static BenchCtx ctx;
+    fighter_store_init(&ctx.templates, ctx.template_memory, 2);
+    fighter_store_bind(&ctx.templates, 0, &ctx.template);
+    fighter_store_bind(&ctx.templates, 1, &ctx.other);
+    fighter_store_init(&ctx.working, ctx.working_memory, 2);
+    fighter_store_bind(&ctx.working, 0, &ctx.work);
+    fighter_store_bind(&ctx.working, 1, &ctx.other_work);
+    new_player(&ctx.template, MIDDLE);
+    bench_run("state_copy (overhead included in player_update/combat_update)", run_state_copy, &ctx);
+
+    bench_player_states(&ctx);
+    bench_combat(&ctx);
+    bench_crowd_update();
+    bench_projectiles();
+    bool kernels_agree = bench_aabb();
+
+    static GameSnapshot snapshot;
+    match_init(&snapshot_match, 0, 0);
+    bench_run("game_snapshot_save", run_snapshot_save, &snapshot);
+    bench_run("game_snapshot_restore", run_snapshot_restore, &snapshot);
+    bench_run("game_snapshot_hash", run_snapshot_hash, &snapshot);
+
+    if (output_path)
+    {
+        write_results(output_path);
+    }
+    if (baseline_path && compare_baseline(baseline_path, threshold_percent) > 0)
+    {
+        return 1;
+    }
+    return kernels_agree ? 0 : 1;
+}
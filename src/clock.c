@@ -0,0 +1,54 @@
+#include <stdint.h>
+#include <time.h>
+#include "clock.h"
+
+static uint64_t monotonic_raw_now( void );
+static uint64_t virtual_now( void );
+
+static ClockReadFn clock_read = monotonic_raw_now;
+static uint64_t virtual_time_ns = 0;
+
+void clock_use_monotonic_raw( void )
+{
+    clock_read = monotonic_raw_now;
+}
+
+void clock_use_virtual( uint64_t start_ns )
+{
+    virtual_time_ns = start_ns;
+    clock_read = virtual_now;
+}
+
+// For sources that need a library we don't want the simulation to depend on e.g. SDL
+void clock_use_source( ClockReadFn read_ns )
+{
+    clock_read = read_ns;
+}
+
+void clock_virtual_advance( uint64_t ns )
+{
+    virtual_time_ns += ns;
+}
+
+uint64_t clock_now_ns( void )
+{
+    return clock_read();
+}
+
+// Split into whole seconds and remainder so counter * 1e9 can't overflow
+uint64_t clock_counter_to_ns( uint64_t counter, uint64_t frequency )
+{
+    return (counter / frequency) * NS_PER_SECOND + (counter % frequency) * NS_PER_SECOND / frequency;
+}
+
+static uint64_t monotonic_raw_now( void )
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t) ts.tv_sec * NS_PER_SECOND + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t virtual_now( void )
+{
+    return virtual_time_ns;
+}
@@ -0,0 +1,25 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+/*
+ * Pluggable time source used by the timers and the game loop. Everything is integer nanoseconds.
+ * Defaults to clock_gettime(CLOCK_MONOTONIC_RAW) so the simulation never needs SDL,
+ * the game switches to SDL's performance counter with clock_use_sdl() (clock_sdl.h).
+ * The virtual clock only moves when clock_virtual_advance() is called - for tests and headless
+ * runs that need timing dependent code to run faster than real time.
+*/
+
+#define NS_PER_SECOND 1000000000ULL
+
+typedef uint64_t (*ClockReadFn)( void );
+
+extern void clock_use_monotonic_raw( void );
+extern void clock_use_virtual( uint64_t start_ns );
+extern void clock_use_source( ClockReadFn read_ns );
+extern void clock_virtual_advance( uint64_t ns );
+extern uint64_t clock_now_ns( void );
+extern uint64_t clock_counter_to_ns( uint64_t counter, uint64_t frequency );
+
+#endif
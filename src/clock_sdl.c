@@ -0,0 +1,20 @@
+#include <stdint.h>
+#include <SDL2/SDL_timer.h>
+#include "clock_sdl.h"
+#include "clock.h"
+
+// Performance frequency never changes while running so only ask SDL once
+static uint64_t sdl_frequency = 0;
+
+static uint64_t sdl_now( void );
+
+void clock_use_sdl( void )
+{
+    sdl_frequency = SDL_GetPerformanceFrequency();
+    clock_use_source(sdl_now);
+}
+
+static uint64_t sdl_now( void )
+{
+    return clock_counter_to_ns(SDL_GetPerformanceCounter(), sdl_frequency);
+}
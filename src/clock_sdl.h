@@ -0,0 +1,7 @@
+#ifndef CLOCK_SDL_H
+#define CLOCK_SDL_H
+
+// Kept apart from clock.h so headless builds don't have to link SDL
+extern void clock_use_sdl( void );
+
+#endif
@@ -1,40 +1,147 @@
+#include <math.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "player.h"
 #include "combat.h"
+#include "aabb.h"
+#include "projectile.h"
 #include "game_types.h"
+#include "fighter_store.h"
 
-static bool box_collision(Box box1, Box box2);
+// Headless runs switch this off so millions of ticks aren't spent in printf
+bool combat_verbose = true;
 
-void combat_update(PlayerState player1, PlayerState player2) 
+/*
+ * Boxes are swept - every box moves with its fighter from prev_pos to pos over the tick (the same
+ * path the renderer interpolates along), and an attack box hits a hurtbox if they overlap at any time
+ * during the tick, not just at its end. A dive kick can't pass through a fighter between two ticks
+ * however low the tick rate, and everything that overlapped at the end of the tick still hits.
+ * Thrown swords are attack boxes like any other, swept from where the projectile pool last had them.
+ *
+ * The broadphase works on each box's bounds over the whole tick. Hurtboxes and attack boxes are both
+ * sorted by left edge, the hurtboxes packed into an AabbBatch.
+ * A hurtbox can only reach an attack box if its left edge lies between (attack left - widest hurtbox)
+ * and (attack left + widest attack box), and that window only ever moves right as we sweep through
+ * the attack boxes, so each one is tested against its window with the batched kernel (see aabb.h)
+ * instead of against every fighter. The kernel's float hits are confirmed with box_collision and the
+ * contacts sorted before anything is applied, so the result never depends on fighter positions,
+ * sort stability or which kernel ran.
+*/
+
+typedef enum {
+    BOX_HURT,
+    BOX_SWORD,
+    BOX_THROWN,
+    BOX_DIVE_KICK
+} BoxKind;
+
+typedef struct {
+    double xmin;
+    BoxKind kind;
+    int fighter;            // Slot in the FighterStore passed to combat_update - the thrower for BOX_THROWN
+    int projectile;         // Pool index for BOX_THROWN
+    Box box;                // Where the box is at the end of the tick
+    Vector_2D movement;     // How far it moved to get there
+    Box bounds;             // Everywhere the box is during the tick
+} SweepBox;
+
+// Resolve order - kills first, then dive kicks, each in the order they happened
+typedef struct {
+    BoxKind kind;
+    double time;    // Fraction of the tick when the boxes first touched
+    int victim;
+    int attacker;
+    int projectile;
+} Contact;
+
+#define SMALL_SORT 16
+
+// Window slack in px - the window only has to be conservative, box_collision has the final say
+#define WINDOW_MARGIN 1.0
+
+#define HIT_KILLED  (1u << 0)
+#define HIT_KNOCKED (1u << 1)   // Took part in a dive kick exchange
+
+/* Scratch lists - reserved by combat_reserve or grown when more fighters turn up than last time, never freed */
+typedef struct {
+    SweepBox *hurt;         // Sorted by xmin, same order as hurt_batch
+    SweepBox *attacks;
+    AabbBatch hurt_batch;
+    int *candidates;
+    Contact *contacts;
+    uint8_t *hit;           // Per fighter HIT_* flags for this tick
+    int fighter_capacity;
+    int contact_capacity;
+    int hurt_count;
+    int attack_count;
+    int contact_count;
+    double widest_hurtbox;
+    double widest_attack;
+} CombatScratch;
+
+static CombatScratch scratch;
+
+static void gather_boxes( FighterStore const *fighters, ProjectilePool const *projectiles );
+static void add_box( BoxKind kind, int fighter, int projectile, Box const *box, Vector_2D movement );
+static void find_contacts( void );
+static void add_contact( SweepBox const *attack, double time, int victim );
+static Box tick_bounds( Box const *box, Vector_2D movement );
+static void resolve_contacts( FighterStore *fighters, ProjectilePool *projectiles );
+static int resolve_rank( BoxKind kind );
+static void sort_boxes( SweepBox *boxes, int box_count );
+static int compare_boxes( void const *a, void const *b );
+static int compare_contacts( void const *a, void const *b );
+static void *grow( void *array, size_t element_size, int capacity );
+
+// projectiles can be NULL when nobody can throw
+void combat_update(FighterStore *fighters, ProjectilePool *projectiles) 
 {
     // TODO() check for sword protection/collision using stances and current action
-    if (box_collision(player1->hurtbox, player2->sword.hitbox))
-    {
-        printf("Player 1 died collision!\n");
-        player_set_death_state(player1);
-        return;
-    } 
-    else if (box_collision(player2->hurtbox, player1->sword.hitbox))
+    gather_boxes(fighters, projectiles);
+    sort_boxes(scratch.hurt, scratch.hurt_count);
+    sort_boxes(scratch.attacks, scratch.attack_count);
+
+    aabb_batch_clear(&scratch.hurt_batch);
+    for (int i = 0; i < scratch.hurt_count; i++)
     {
-        player_set_death_state(player2);
-        printf("Player 2 died collision!\n");
-        return;
+        aabb_batch_push(&scratch.hurt_batch, &scratch.hurt[i].bounds);
     }
-    else if (box_collision(player1->hurtbox, player2->hitbox))
+
+    scratch.contact_count = 0;
+    find_contacts();
+
+    qsort(scratch.contacts, scratch.contact_count, sizeof(Contact), compare_contacts);
+    resolve_contacts(fighters, projectiles);
+}
+
+/*
+ * Grows the scratch lists for this many fighters now rather than on the tick that first needs them.
+ * Contacts get one per attack box - every contact a 1v1 can make, as each box has only one fighter
+ * to hit - so a 1v1 set up with combat_reserve(2) never allocates in combat_update. Crowds can
+ * still make more and the list grows.
+*/
+void combat_reserve( int fighter_count )
+{
+    if (fighter_count <= scratch.fighter_capacity)
     {
-        player_receive_dive_kick(player1, player2);
-        player_end_dive_kick(player2);
-        printf("Player2 divekick/punch etc player 1");
+        return;
     }
-    else if (box_collision(player2->hurtbox, player1->hitbox))
+    int attack_capacity = fighter_count * 2 + PROJECTILE_POOL_CAPACITY;
+    scratch.fighter_capacity = fighter_count;
+    scratch.hurt = grow(scratch.hurt, sizeof(SweepBox), fighter_count);
+    scratch.attacks = grow(scratch.attacks, sizeof(SweepBox), attack_capacity);
+    scratch.candidates = grow(scratch.candidates, sizeof(int), fighter_count);
+    scratch.hit = grow(scratch.hit, sizeof(uint8_t), fighter_count);
+    aabb_batch_reserve(&scratch.hurt_batch, fighter_count);
+    if (attack_capacity > scratch.contact_capacity)
     {
-        player_receive_dive_kick(player2, player1);
-        player_end_dive_kick(player1);
-        printf("Player1 divekick/punch etc player 2");
+        scratch.contact_capacity = attack_capacity;
+        scratch.contacts = grow(scratch.contacts, sizeof(Contact), attack_capacity);
     }
 }
 
-static bool box_collision( Box box1, Box box2 ) 
+bool box_collision( Box box1, Box box2 ) 
 {
     double box1_xmin = box1.top_left.x;
     double box1_xmax = box1.top_left.x + box1.width;
@@ -52,3 +159,314 @@ static bool box_collision( Box box1, Box box2 )
     return box1.enabled && box2.enabled && x_axis_collides && y_axis_collides;
 }
 
+/*
+ * Swept box_collision - box1 and box2 are where the boxes end up, move1 and move2 how far each moved
+ * to get there. Returns true if they overlap at any point on the way, with *time (0 start, 1 end)
+ * the moment they first do. Boxes that box_collision says overlap at the end always hit.
+*/
+bool box_time_of_impact( Box box1, Vector_2D move1, Box box2, Vector_2D move2, double *time )
+{
+    if (!box1.enabled || !box2.enabled)
+    {
+        return false;
+    }
+    bool overlap_at_end = box_collision(box1, box2);
+
+    // Box1 moving against box2 standing still at its start - per axis, the times the sides pass
+    double move[2] = { move1.x - move2.x, move1.y - move2.y };
+    double min1[2] = { box1.top_left.x - move1.x, box1.top_left.y - move1.y };
+    double min2[2] = { box2.top_left.x - move2.x, box2.top_left.y - move2.y };
+    double size1[2] = { box1.width, box1.height };
+    double size2[2] = { box2.width, box2.height };
+
+    double entry = -INFINITY;
+    double exit = INFINITY;
+    for (int axis = 0; axis < 2; axis++)
+    {
+        double max1 = min1[axis] + size1[axis];
+        double max2 = min2[axis] + size2[axis];
+        if (move[axis] == 0.0)
+        {
+            // Never meet along this axis unless they already overlap on it
+            if (!(max1 > min2[axis] && max2 > min1[axis]))
+            {
+                entry = INFINITY;
+            }
+            continue;
+        }
+        double touch = (move[axis] > 0.0) ? min2[axis] - max1 : max2 - min1[axis];
+        double leave = (move[axis] > 0.0) ? max2 - min1[axis] : min2[axis] - max1;
+        double axis_entry = touch / move[axis];
+        double axis_exit = leave / move[axis];
+        entry = (axis_entry > entry) ? axis_entry : entry;
+        exit = (axis_exit < exit) ? axis_exit : exit;
+    }
+
+    bool swept = entry < exit && entry < 1.0 && exit > 0.0;
+    if (!swept && !overlap_at_end)
+    {
+        return false;
+    }
+    // Rounding can make the sweep miss an overlap that is only just there at the end
+    *time = !swept ? 1.0 : (entry > 0.0) ? entry : 0.0;
+    return true;
+}
+
+// Hurtboxes in one list, swords, thrown swords and dive kicks in the other - boxes travel with their
+// fighter, so each one's movement is how far the fighter moved this tick
+static void gather_boxes( FighterStore const *fighters, ProjectilePool const *projectiles )
+{
+    combat_reserve(fighters->count);
+
+    scratch.hurt_count = 0;
+    scratch.attack_count = 0;
+    scratch.widest_hurtbox = 0.0;
+    scratch.widest_attack = 0.0;
+    for (int i = 0; i < fighters->count; i++)
+    {
+        Vector_2D movement = { fighters->pos[i].x - fighters->prev_pos[i].x, fighters->pos[i].y - fighters->prev_pos[i].y };
+        add_box(BOX_HURT, i, -1, &fighters->hurtbox[i], movement);
+
+        PlayerState fighter = fighters->players[i];
+        // A thrown sword's hitbox is the projectile's - gathered below while it's still dangerous
+        if (!fighter->sword.thrown)
+        {
+            add_box(BOX_SWORD, i, -1, &fighter->sword.hitbox, movement);
+        }
+        add_box(BOX_DIVE_KICK, i, -1, &fighter->hitbox, movement);
+    }
+
+    for (int p = 0; projectiles && p < projectiles->count; p++)
+    {
+        if (projectiles->flags[p] & PROJECTILE_FLYING)
+        {
+            Box box = projectile_box(projectiles, p);
+            Vector_2D movement = { projectiles->pos_x[p] - projectiles->prev_x[p],
+                                   projectiles->pos_y[p] - projectiles->prev_y[p] };
+            add_box(BOX_THROWN, projectiles->owner[p], p, &box, movement);
+        }
+    }
+}
+
+static void add_box( BoxKind kind, int fighter, int projectile, Box const *box, Vector_2D movement )
+{
+    if (!box->enabled)
+    {
+        return;
+    }
+    Box bounds = tick_bounds(box, movement);
+    SweepBox sweep = { .xmin = bounds.top_left.x, .kind = kind, .fighter = fighter, .projectile = projectile,
+                       .box = *box, .movement = movement, .bounds = bounds };
+    if (kind == BOX_HURT)
+    {
+        scratch.hurt[scratch.hurt_count++] = sweep;
+        if (bounds.width > scratch.widest_hurtbox)
+        {
+            scratch.widest_hurtbox = bounds.width;
+        }
+    }
+    else
+    {
+        scratch.attacks[scratch.attack_count++] = sweep;
+        if (bounds.width > scratch.widest_attack)
+        {
+            scratch.widest_attack = bounds.width;
+        }
+    }
+}
+
+static void find_contacts( void )
+{
+    int first = 0, last = 0;
+    for (int a = 0; a < scratch.attack_count; a++)
+    {
+        SweepBox const *attack = &scratch.attacks[a];
+
+        // Hurtboxes starting in [attack left - widest hurtbox, attack left + widest attack)
+        double window_left = attack->xmin - scratch.widest_hurtbox - WINDOW_MARGIN;
+        double window_right = attack->xmin + scratch.widest_attack + WINDOW_MARGIN;
+        while (first < scratch.hurt_count && scratch.hurt[first].xmin < window_left)
+        {
+            first++;
+        }
+        if (last < first)
+        {
+            last = first;
+        }
+        while (last < scratch.hurt_count && scratch.hurt[last].xmin < window_right)
+        {
+            last++;
+        }
+
+        AabbQuery query = aabb_query(&attack->bounds);
+        int candidate_count = aabb_overlap(&scratch.hurt_batch, first, last, &query, scratch.candidates);
+
+        for (int c = 0; c < candidate_count; c++)
+        {
+            SweepBox const *hurt = &scratch.hurt[scratch.candidates[c]];
+            double time;
+            if (hurt->fighter != attack->fighter
+                && box_time_of_impact(attack->box, attack->movement, hurt->box, hurt->movement, &time))
+            {
+                add_contact(attack, time, hurt->fighter);
+            }
+        }
+    }
+}
+
+static void add_contact( SweepBox const *attack, double time, int victim )
+{
+    if (scratch.contact_count == scratch.contact_capacity)
+    {
+        scratch.contact_capacity = scratch.contact_capacity ? scratch.contact_capacity * 2 : 16;
+        scratch.contacts = grow(scratch.contacts, sizeof(Contact), scratch.contact_capacity);
+    }
+    scratch.contacts[scratch.contact_count++] = (Contact) {
+        .kind = attack->kind, .time = time, .victim = victim, .attacker = attack->fighter, .projectile = attack->projectile
+    };
+}
+
+// Box at the end of the tick joined with where it started
+static Box tick_bounds( Box const *box, Vector_2D movement )
+{
+    Box bounds = *box;
+    bounds.top_left.x -= (movement.x > 0.0) ? movement.x : 0.0;
+    bounds.top_left.y -= (movement.y > 0.0) ? movement.y : 0.0;
+    bounds.width += fabs(movement.x);
+    bounds.height += fabs(movement.y);
+    return bounds;
+}
+
+/*
+ * Kills go first, earliest first and lowest victim index between those at the same time. A fighter
+ * killed this tick can't kill anyone else or take part in a dive kick, and nobody is in more than one
+ * dive kick exchange per tick - the first one they were in. With two fighters and hits that start
+ * at the same time this is exactly the old player 1 first else-if chain.
+ * A thrown sword kills whoever it reaches first even if its thrower died earlier in the tick, then
+ * drops harmlessly.
+*/
+static void resolve_contacts( FighterStore *fighters, ProjectilePool *projectiles )
+{
+    for (int i = 0; i < fighters->count; i++)
+    {
+        scratch.hit[i] = 0;
+    }
+
+    for (int i = 0; i < scratch.contact_count; i++)
+    {
+        Contact const *contact = &scratch.contacts[i];
+        PlayerState victim = fighters->players[contact->victim];
+        PlayerState attacker = fighters->players[contact->attacker];
+
+        uint8_t *victim_hit = &scratch.hit[contact->victim];
+        uint8_t *attacker_hit = &scratch.hit[contact->attacker];
+
+        if (contact->kind == BOX_SWORD)
+        {
+            if ((*victim_hit | *attacker_hit) & HIT_KILLED)
+            {
+                continue;
+            }
+            player_set_death_state(victim);
+            *victim_hit |= HIT_KILLED;
+            if (combat_verbose) printf("Fighter %d died collision!\n", contact->victim + 1);
+        }
+        else if (contact->kind == BOX_THROWN)
+        {
+            if ((*victim_hit & HIT_KILLED) || !(projectiles->flags[contact->projectile] & PROJECTILE_FLYING))
+            {
+                continue;
+            }
+            player_set_death_state(victim);
+            projectile_pool_drop(projectiles, contact->projectile);
+            *victim_hit |= HIT_KILLED;
+            if (combat_verbose) printf("Fighter %d died to a thrown sword!\n", contact->victim + 1);
+        }
+        else if (((*victim_hit | *attacker_hit) & (HIT_KILLED | HIT_KNOCKED)) == 0)
+        {
+            player_receive_dive_kick(victim, attacker);
+            player_end_dive_kick(attacker);
+            *victim_hit |= HIT_KNOCKED;
+            *attacker_hit |= HIT_KNOCKED;
+            if (combat_verbose) printf("Fighter %d divekick/punch etc fighter %d", contact->attacker + 1, contact->victim + 1);
+        }
+    }
+}
+
+// Swords in hand and thrown ones are both kills, so they're ordered only by time between them
+static int resolve_rank( BoxKind kind )
+{
+    return (kind == BOX_DIVE_KICK) ? 1 : 0;
+}
+
+// A 1v1 only has a handful of boxes - not worth qsort's call per comparison
+static void sort_boxes( SweepBox *boxes, int box_count )
+{
+    if (box_count > SMALL_SORT)
+    {
+        qsort(boxes, box_count, sizeof(SweepBox), compare_boxes);
+        return;
+    }
+    for (int i = 1; i < box_count; i++)
+    {
+        SweepBox box = boxes[i];
+        int j = i;
+        for (; j > 0 && compare_boxes(&boxes[j - 1], &box) > 0; j--)
+        {
+            boxes[j] = boxes[j - 1];
+        }
+        boxes[j] = box;
+    }
+}
+
+// Fighter and kind break ties so equal edges always sort the same way
+static int compare_boxes( void const *a, void const *b )
+{
+    SweepBox const *box_a = a, *box_b = b;
+    if (box_a->xmin != box_b->xmin)
+    {
+        return (box_a->xmin < box_b->xmin) ? -1 : 1;
+    }
+    if (box_a->fighter != box_b->fighter)
+    {
+        return (box_a->fighter < box_b->fighter) ? -1 : 1;
+    }
+    return (int) box_a->kind - (int) box_b->kind;
+}
+
+static int compare_contacts( void const *a, void const *b )
+{
+    Contact const *contact_a = a, *contact_b = b;
+    if (resolve_rank(contact_a->kind) != resolve_rank(contact_b->kind))
+    {
+        return resolve_rank(contact_a->kind) - resolve_rank(contact_b->kind);
+    }
+    if (contact_a->time != contact_b->time)
+    {
+        return (contact_a->time < contact_b->time) ? -1 : 1;
+    }
+    if (contact_a->victim != contact_b->victim)
+    {
+        return contact_a->victim - contact_b->victim;
+    }
+    if (contact_a->attacker != contact_b->attacker)
+    {
+        return contact_a->attacker - contact_b->attacker;
+    }
+    if (contact_a->kind != contact_b->kind)
+    {
+        return (int) contact_a->kind - (int) contact_b->kind;
+    }
+    return contact_a->projectile - contact_b->projectile;
+}
+
+static void *grow( void *array, size_t element_size, int capacity )
+{
+    array = realloc(array, element_size * capacity);
+    if (!array)
+    {
+        fprintf(stderr, "Out of memory growing combat lists\n");
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
@@ -1,8 +1,23 @@
 #ifndef COMBAT_H
 #define COMBAT_H
 
-typedef struct PlayerState *PlayerState;
+#include <stdbool.h>
+#include "game_types.h"
 
-void combat_update(PlayerState player1, PlayerState player2);
+typedef struct ProjectilePool ProjectilePool;
+typedef struct FighterStore FighterStore;
+
+extern bool combat_verbose;
+
+/*
+ * Resolves every hit between all the fighters in a store for one tick, reading positions and hurtboxes
+ * straight from its arrays. Boxes are swept from prev_pos to pos, so call it after every fighter has
+ * moved - and after projectile_pool_update, which moves the thrown swords it checks as well.
+ * Usage: combat_update(&match->fighters, &match->projectiles);
+*/
+void combat_update(FighterStore *fighters, ProjectilePool *projectiles);
+void combat_reserve( int fighter_count );
+bool box_collision(Box box1, Box box2);
+bool box_time_of_impact( Box box1, Vector_2D move1, Box box2, Vector_2D move2, double *time );
 
 #endif
@@ -0,0 +1,46 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include "fighter_store.h"
+#include "game_types.h"
+
+// Carves the arrays out of memory widest alignment first, so only memory itself needs aligning
+void fighter_store_init( FighterStore *store, void *memory, int capacity )
+{
+    assert(capacity > 0 && ((uintptr_t) memory % _Alignof(double)) == 0);
+    memset(memory, 0, FIGHTER_STORE_SIZE(capacity));
+
+    unsigned char *cursor = memory;
+    store->pos = (Vector_2D *) cursor;
+    cursor += (size_t) capacity * sizeof(Vector_2D);
+    store->prev_pos = (Vector_2D *) cursor;
+    cursor += (size_t) capacity * sizeof(Vector_2D);
+    store->vel = (Vector_2D *) cursor;
+    cursor += (size_t) capacity * sizeof(Vector_2D);
+    store->hurtbox = (Box *) cursor;
+    cursor += (size_t) capacity * sizeof(Box);
+    store->players = (PlayerState *) cursor;
+    cursor += (size_t) capacity * sizeof(PlayerState);
+    store->state = cursor;
+    cursor += capacity;
+    store->landed = cursor;
+
+    store->count = 0;
+    store->capacity = capacity;
+}
+
+/*
+ * Points player at slot - player_init then fills the slot in. Binding a slot again (a respawn
+ * reusing it) is fine, slots just have to be bound from 0 up with no gaps.
+*/
+void fighter_store_bind( FighterStore *store, int slot, PlayerState player )
+{
+    assert(slot >= 0 && slot < store->capacity && slot <= store->count);
+    player->store = store;
+    player->slot = slot;
+    store->players[slot] = player;
+    if (slot == store->count)
+    {
+        store->count++;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef FIGHTER_STORE_H
+#define FIGHTER_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "game_types.h"
+
+/*
+ * The fields every tick's physics and combat touch - position, velocity, hurtbox and state - for a
+ * group of fighters that are stepped together, one array per field. They live here and only here:
+ * a PlayerState is the cold record (sword, timers, stance, def) plus which store and slot its hot
+ * fields are in, so player_update_batch and combat_update run straight down the arrays without
+ * copying anything in or out.
+ *
+ * A Match owns a store for its two players, a crowd (headless -n, the benchmarks) one for all of
+ * its fighters. A PlayerState copied with = still points at the original's slot - copies that must
+ * be independent (render snapshots) get a slot of their own and are filled in with player_copy.
+ *
+ * Usage:
+ *   fighter_store_init(&store, memory, capacity);   // memory: FIGHTER_STORE_SIZE(capacity) bytes
+ *   fighter_store_bind(&store, slot, player);       // Once per fighter, before player_init
+ *   FIGHTER_POS(player).x += 10.0;
+ *   player_update_batch(&store, inputs, SIM_DT);          // inputs[slot] for every bound slot
+*/
+
+// Bytes of backing memory for a store of capacity fighters - must be aligned for a double
+#define FIGHTER_STORE_SIZE(capacity) \
+    ((size_t) (capacity) * (3 * sizeof(Vector_2D) + sizeof(Box) + sizeof(PlayerState) + 2 * sizeof(uint8_t)))
+
+typedef struct FighterStore {
+    Vector_2D *pos;         // Center of fighter
+    Vector_2D *prev_pos;    // Center at the previous tick (render interpolation and swept combat)
+    Vector_2D *vel;
+    Box *hurtbox;
+    PlayerState *players;   // The cold record bound to each slot
+    uint8_t *state;         // FighterState
+    uint8_t *landed;        // Touched the ground in the last physics step - player_update handles it
+    int count;              // Slots [0, count) have been bound
+    int capacity;
+} FighterStore;
+
+// One fighter's hot fields, as lvalues - player must have been bound to a store
+#define FIGHTER_POS(player)      ((player)->store->pos[(player)->slot])
+#define FIGHTER_PREV_POS(player) ((player)->store->prev_pos[(player)->slot])
+#define FIGHTER_VEL(player)      ((player)->store->vel[(player)->slot])
+#define FIGHTER_HURTBOX(player)  ((player)->store->hurtbox[(player)->slot])
+#define FIGHTER_STATE(player)    ((player)->store->state[(player)->slot])
+
+extern void fighter_store_init( FighterStore *store, void *memory, int capacity );
+extern void fighter_store_bind( FighterStore *store, int slot, PlayerState player );
+
+#endif
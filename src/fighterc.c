@@ -0,0 +1,544 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "roster.h"
+#include "animation.h"
+#include "game_types.h"
+
+/*
+ * Offline fighter compiler - reads fighter text sources and writes the roster file the game maps
+ * (layout in roster.h). Attacks are authored as frame lengths in seconds and flattened here into per
+ * tick tables for one tick rate, stepping the timer the way the game used to step its double attack
+ * timer (+= 1.0 / tick_rate every tick) so frames change on the same ticks they always did.
+ *
+ * Source format - one setting per line, # starts a comment:
+ *   name swordsman
+ *   speed 450                          any FighterDef double by name (see settings below)
+ *   guard_offset <low|middle|high> 40
+ *   attack <low|middle|high>           up to MAX_FRAMES frames, then end
+ *     duration 1.1
+ *     delay 0.4
+ *     frame <seconds> <x> <y> <width> <height>     hitbox relative to the fighter facing right
+ *     frame <seconds> off                          no hitbox this frame
+ *   end
+ *   animation <row> <frames> <loop|once> <seconds per frame>     every row in animation.h
+ *
+ * Usage:
+ *   fighterc -t <tick_rate> -o <roster> <fighter source>...
+*/
+
+#define MAX_FRAMES 8
+#define MAX_TOKENS 8
+#define LINE_SIZE 256
+#define PATH_SIZE 4096
+
+typedef struct {
+    char const *name;
+    size_t offset;
+} Setting;
+
+static Setting const settings[] = {
+    { "width", offsetof(FighterDef, width) },
+    { "height", offsetof(FighterDef, height) },
+    { "crouched_height", offsetof(FighterDef, crouched_height) },
+    { "speed", offsetof(FighterDef, speed) },
+    { "jump_speed", offsetof(FighterDef, jump_speed) },
+    { "gravity", offsetof(FighterDef, gravity) },
+    { "jump_delay", offsetof(FighterDef, jump_delay) },
+    { "stance_delay", offsetof(FighterDef, stance_delay) },
+    { "dive_kick_width", offsetof(FighterDef, dive_kick_width) },
+    { "dive_kick_height", offsetof(FighterDef, dive_kick_height) },
+    { "dive_kick_x_offset", offsetof(FighterDef, dive_kick_x_offset) },
+    { "dive_kick_y_offset", offsetof(FighterDef, dive_kick_y_offset) },
+    { "dive_kick_x_speed", offsetof(FighterDef, dive_kick_x_speed) },
+    { "dive_kick_y_speed", offsetof(FighterDef, dive_kick_y_speed) },
+    { "dive_kick_stun_time", offsetof(FighterDef, dive_kick_stun_time) },
+    { "dive_kick_x_impact", offsetof(FighterDef, dive_kick_x_impact) },
+    { "dive_kick_y_impact", offsetof(FighterDef, dive_kick_y_impact) },
+    { "dive_kick_recovery_time", offsetof(FighterDef, dive_kick_recovery_time) },
+    { "sword_length", offsetof(FighterDef, sword_length) },
+    { "sword_width", offsetof(FighterDef, sword_width) },
+    { "guard_angle_penalty", offsetof(FighterDef, guard_angle_penalty) },
+    { "throw_speed", offsetof(FighterDef, throw_speed) },
+    { "throw_lift", offsetof(FighterDef, throw_lift) },
+    { "throw_gravity", offsetof(FighterDef, throw_gravity) },
+    { "throw_time", offsetof(FighterDef, throw_time) },
+};
+
+#define SETTING_COUNT (sizeof(settings) / sizeof(settings[0]))
+
+static char const *const stance_names[FIGHTER_STANCES] = { [LOW] = "low", [MIDDLE] = "middle", [HIGH] = "high" };
+
+static char const *const animation_names[FIGHTER_ANIMATIONS] = {
+    [CROUCH_ROW] = "crouch",
+    [KICK_ROW] = "kick",
+    [KICK_DISARMED_ROW] = "kick_disarmed",
+    [HIGH_ATTACK_ROW] = "high_attack",
+    [MIDDLE_ATTACK_ROW] = "middle_attack",
+    [LOW_ATTACK_ROW] = "low_attack",
+    [DEATH_ROW] = "death",
+    [DEATH_DISARMED_ROW] = "death_disarmed",
+    [FALL_ROW] = "fall",
+    [FALL_DISARMED_ROW] = "fall_disarmed",
+    [IDLE_LOW_ROW] = "idle_low",
+    [IDLE_DISARMED_ROW] = "idle_disarmed",
+    [IDLE_HIGH_ROW] = "idle_high",
+    [IDLE_MIDDLE_ROW] = "idle_middle",
+    [JUMP_ROW] = "jump",
+    [JUMP_DISARMED_ROW] = "jump_disarmed",
+    [RUN_ROW] = "run",
+    [RUN_DISARMED_ROW] = "run_disarmed",
+    [STUNNED_ROW] = "stunned",
+    [THROW_ROW] = "throw",
+};
+
+/* An attack as written in the source, before flattening */
+typedef struct {
+    double duration;
+    double delay;
+    double frame_lengths[MAX_FRAMES];
+    Box hitboxes[MAX_FRAMES];
+    int frame_count;
+    bool has_duration;
+    bool has_delay;
+    bool defined;
+} AttackSource;
+
+typedef struct {
+    FighterDef def;
+    AttackSource attacks[FIGHTER_STANCES];
+    bool has_setting[SETTING_COUNT];
+    bool has_guard[FIGHTER_STANCES];
+    bool has_animation[FIGHTER_ANIMATIONS];
+} FighterSource;
+
+/* The roster being built - grown as fighters are appended */
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} Output;
+
+static char const *source_path;
+static int source_line;
+
+static void fail( char const *message, char const *detail );
+static bool read_fighter( char const *path, FighterSource *source );
+static int split( char *line, char *tokens[] );
+static double number( char const *token );
+static int lookup( char const *const names[], int count, char const *name, char const *what );
+static void check_complete( FighterSource const *source );
+static size_t append_fighter( Output *out, FighterSource const *source, int tick_rate );
+static size_t append( Output *out, void const *data, size_t size );
+static int frame_at( AttackSource const *attack, double timer );
+
+int main( int argc, char *argv[] )
+{
+    int tick_rate = 0;
+    char const *output_path = NULL;
+    int first_source = argc;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            tick_rate = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            output_path = argv[++i];
+        }
+        else
+        {
+            first_source = i;
+            break;
+        }
+    }
+    int fighter_count = argc - first_source;
+    if (tick_rate <= 0 || tick_rate > UINT16_MAX || !output_path || fighter_count == 0)
+    {
+        fprintf(stderr, "Usage: %s -t <tick_rate> -o <roster> <fighter source>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (fighter_count > ROSTER_MAX_FIGHTERS)
+    {
+        fprintf(stderr, "At most %d fighters fit in a roster\n", ROSTER_MAX_FIGHTERS);
+        return EXIT_FAILURE;
+    }
+
+    Output out = { 0 };
+    RosterHeader header = {
+        .magic = ROSTER_MAGIC,
+        .version = ROSTER_VERSION,
+        .tick_rate = (uint16_t) tick_rate,
+        .fighter_count = (uint32_t) fighter_count
+    };
+    append(&out, &header, sizeof(header));
+
+    for (int i = 0; i < fighter_count; i++)
+    {
+        static FighterSource source;
+        memset(&source, 0, sizeof(source));
+        if (!read_fighter(argv[first_source + i], &source))
+        {
+            return EXIT_FAILURE;
+        }
+        for (int j = 0; j < i; j++)
+        {
+            FighterDef const *other = (FighterDef const *) (out.data + header.fighters[j]);
+            if (strcmp(other->name, source.def.name) == 0)
+            {
+                fail("two fighters are called", source.def.name);
+            }
+        }
+        header.fighters[i] = (uint32_t) append_fighter(&out, &source, tick_rate);
+    }
+    header.size = (uint32_t) out.size;
+    memcpy(out.data, &header, sizeof(header));
+
+    // Written beside the old roster and renamed over it, so a game that has the old one mapped (or is
+    // watching it for hot reload) never sees a half written file
+    char temp_path[PATH_SIZE];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", output_path) >= (int) sizeof(temp_path))
+    {
+        fprintf(stderr, "Output path is too long\n");
+        return EXIT_FAILURE;
+    }
+    FILE *file = fopen(temp_path, "wb");
+    if (!file)
+    {
+        perror(temp_path);
+        return EXIT_FAILURE;
+    }
+    if (fwrite(out.data, 1, out.size, file) != out.size || fclose(file) != 0 || rename(temp_path, output_path) != 0)
+    {
+        perror(output_path);
+        remove(temp_path);
+        return EXIT_FAILURE;
+    }
+    free(out.data);
+    return EXIT_SUCCESS;
+}
+
+// source_line is 0 for problems with the fighter as a whole
+static void fail( char const *message, char const *detail )
+{
+    if (source_line > 0)
+    {
+        fprintf(stderr, "%s:%d: ", source_path, source_line);
+    }
+    else
+    {
+        fprintf(stderr, "%s: ", source_path);
+    }
+    fprintf(stderr, "%s%s%s\n", message, detail ? " " : "", detail ? detail : "");
+    exit(EXIT_FAILURE);
+}
+
+static bool read_fighter( char const *path, FighterSource *source )
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        perror(path);
+        return false;
+    }
+    source_path = path;
+    source_line = 0;
+
+    char line[LINE_SIZE];
+    AttackSource *attack = NULL;    // Inside an attack block
+    while (fgets(line, sizeof(line), file))
+    {
+        source_line++;
+        char *tokens[MAX_TOKENS];
+        int count = split(line, tokens);
+        if (count == 0)
+        {
+            continue;
+        }
+
+        if (attack)
+        {
+            if (strcmp(tokens[0], "end") == 0 && count == 1)
+            {
+                attack = NULL;
+            }
+            else if (strcmp(tokens[0], "duration") == 0 && count == 2)
+            {
+                attack->duration = number(tokens[1]);
+                attack->has_duration = true;
+            }
+            else if (strcmp(tokens[0], "delay") == 0 && count == 2)
+            {
+                attack->delay = number(tokens[1]);
+                attack->has_delay = true;
+            }
+            else if (strcmp(tokens[0], "frame") == 0 && (count == 3 || count == 6))
+            {
+                if (attack->frame_count == MAX_FRAMES)
+                {
+                    fail("too many frames in attack", NULL);
+                }
+                int frame = attack->frame_count++;
+                attack->frame_lengths[frame] = number(tokens[1]);
+                if (count == 3 && strcmp(tokens[2], "off") != 0)
+                {
+                    fail("expected a hitbox or off, got", tokens[2]);
+                }
+                if (count == 6)
+                {
+                    attack->hitboxes[frame] = (Box) {
+                        .top_left = { number(tokens[2]), number(tokens[3]) },
+                        .width = number(tokens[4]),
+                        .height = number(tokens[5]),
+                        .enabled = true
+                    };
+                }
+            }
+            else
+            {
+                fail("unexpected in attack block:", tokens[0]);
+            }
+            continue;
+        }
+
+        if (strcmp(tokens[0], "name") == 0 && count == 2)
+        {
+            if (strlen(tokens[1]) >= FIGHTER_NAME_SIZE)
+            {
+                fail("name too long:", tokens[1]);
+            }
+            strcpy(source->def.name, tokens[1]);
+        }
+        else if (strcmp(tokens[0], "guard_offset") == 0 && count == 3)
+        {
+            int stance = lookup(stance_names, FIGHTER_STANCES, tokens[1], "stance");
+            source->def.guard_offsets[stance] = number(tokens[2]);
+            source->has_guard[stance] = true;
+        }
+        else if (strcmp(tokens[0], "attack") == 0 && count == 2)
+        {
+            int stance = lookup(stance_names, FIGHTER_STANCES, tokens[1], "stance");
+            attack = &source->attacks[stance];
+            if (attack->defined)
+            {
+                fail("attack defined twice:", tokens[1]);
+            }
+            attack->defined = true;
+        }
+        else if (strcmp(tokens[0], "animation") == 0 && count == 5)
+        {
+            int row = lookup(animation_names, FIGHTER_ANIMATIONS, tokens[1], "animation");
+            bool loops = strcmp(tokens[3], "loop") == 0;
+            if (!loops && strcmp(tokens[3], "once") != 0)
+            {
+                fail("expected loop or once, got", tokens[3]);
+            }
+            source->def.animations[row] = (FighterAnimation) {
+                .frames = (int32_t) number(tokens[2]),
+                .loops = loops,
+                .time_per_frame = number(tokens[4])
+            };
+            source->has_animation[row] = true;
+        }
+        else if (count == 2)
+        {
+            size_t i = 0;
+            while (i < SETTING_COUNT && strcmp(settings[i].name, tokens[0]) != 0)
+            {
+                i++;
+            }
+            if (i == SETTING_COUNT)
+            {
+                fail("unknown setting", tokens[0]);
+            }
+            double value = number(tokens[1]);
+            memcpy((unsigned char *) &source->def + settings[i].offset, &value, sizeof(value));
+            source->has_setting[i] = true;
+        }
+        else
+        {
+            fail("can't read line starting", tokens[0]);
+        }
+    }
+    fclose(file);
+    if (attack)
+    {
+        fail("attack block missing its end", NULL);
+    }
+    check_complete(source);
+    return true;
+}
+
+// Splits on whitespace, dropping comments - returns the token count
+static int split( char *line, char *tokens[] )
+{
+    char *comment = strchr(line, '#');
+    if (comment)
+    {
+        *comment = '\0';
+    }
+    int count = 0;
+    for (char *token = strtok(line, " \t\r\n"); token; token = strtok(NULL, " \t\r\n"))
+    {
+        if (count == MAX_TOKENS)
+        {
+            fail("too many values on one line", NULL);
+        }
+        tokens[count++] = token;
+    }
+    return count;
+}
+
+static double number( char const *token )
+{
+    char *end;
+    double value = strtod(token, &end);
+    if (end == token || *end != '\0')
+    {
+        fail("not a number:", token);
+    }
+    return value;
+}
+
+static int lookup( char const *const names[], int count, char const *name, char const *what )
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (strcmp(names[i], name) == 0)
+        {
+            return i;
+        }
+    }
+    fprintf(stderr, "%s:%d: unknown %s %s\n", source_path, source_line, what, name);
+    exit(EXIT_FAILURE);
+}
+
+// Every setting is required - a fighter that silently got a 0 gravity is worse than a build error
+static void check_complete( FighterSource const *source )
+{
+    source_line = 0;
+    if (source->def.name[0] == '\0')
+    {
+        fail("fighter has no name", NULL);
+    }
+    for (size_t i = 0; i < SETTING_COUNT; i++)
+    {
+        if (!source->has_setting[i])
+        {
+            fail("missing setting", settings[i].name);
+        }
+    }
+    for (int stance = 0; stance < FIGHTER_STANCES; stance++)
+    {
+        AttackSource const *attack = &source->attacks[stance];
+        if (!source->has_guard[stance])
+        {
+            fail("missing guard_offset", stance_names[stance]);
+        }
+        if (!attack->defined || !attack->has_duration || !attack->has_delay || attack->frame_count == 0)
+        {
+            fail("missing or incomplete attack", stance_names[stance]);
+        }
+        if (attack->duration <= 0.0)
+        {
+            fail("attack duration must be positive:", stance_names[stance]);
+        }
+    }
+    for (int row = 0; row < FIGHTER_ANIMATIONS; row++)
+    {
+        if (!source->has_animation[row] || source->def.animations[row].frames <= 0
+            || source->def.animations[row].time_per_frame <= 0.0)
+        {
+            fail("missing or empty animation", animation_names[row]);
+        }
+    }
+}
+
+// Returns where the FighterDef went
+static size_t append_fighter( Output *out, FighterSource const *source, int tick_rate )
+{
+    double dt = 1.0 / tick_rate;
+    size_t start = append(out, &source->def, sizeof(FighterDef));
+
+    for (int stance = 0; stance < FIGHTER_STANCES; stance++)
+    {
+        AttackSource const *attack = &source->attacks[stance];
+        source_line = 0;
+
+        // Step the timer until the attack is over, as sword_update_internal_state used to
+        int ticks = 0;
+        for (double timer = 0.0; timer < attack->duration; timer += dt)
+        {
+            ticks++;
+        }
+
+        size_t table = out->size;
+        double timer = 0.0;
+        for (int tick = 0; tick < ticks; tick++)
+        {
+            int frame = frame_at(attack, timer);
+            if (frame >= attack->frame_count)
+            {
+                fail("attack frames end before the attack does:", stance_names[stance]);
+            }
+            for (int facing = 0; facing < 2; facing++)
+            {
+                AttackTick entry = { .frame = frame, .hitbox = attack->hitboxes[frame] };
+                // Mirrored boxes hang off the other side of the hurtbox
+                if (!facing)
+                {
+                    entry.hitbox.top_left.x = -entry.hitbox.top_left.x - entry.hitbox.width;
+                }
+                append(out, &entry, sizeof(entry));
+            }
+            timer += dt;
+        }
+
+        FighterDef *def = (FighterDef *) (out->data + start);
+        def->attacks[stance] = (FighterAttack) {
+            .ticks = ticks,
+            .table = (uint32_t) (table - start),
+            .delay = attack->delay
+        };
+    }
+    FighterDef *def = (FighterDef *) (out->data + start);
+    def->size = (uint32_t) (out->size - start);
+    return start;
+}
+
+// Appends at the next 8 byte boundary (zero padded) and returns where it went
+static size_t append( Output *out, void const *data, size_t size )
+{
+    size_t start = (out->size + 7) & ~(size_t) 7;
+    if (start + size > out->capacity)
+    {
+        out->capacity = (start + size) * 2;
+        out->data = realloc(out->data, out->capacity);
+        if (!out->data)
+        {
+            fprintf(stderr, "Out of memory building roster\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memset(out->data + out->size, 0, start - out->size);
+    memcpy(out->data + start, data, size);
+    out->size = start + size;
+    return start;
+}
+
+// Same walk through the frame lengths sword_get_frame used to do every call
+static int frame_at( AttackSource const *attack, double timer )
+{
+    int current_frame = 0;
+    double time_remaining = timer;
+    while (current_frame < attack->frame_count && time_remaining > attack->frame_lengths[current_frame])
+    {
+        time_remaining -= attack->frame_lengths[current_frame];
+        current_frame++;
+    }
+    return current_frame;
+}
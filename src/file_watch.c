@@ -0,0 +1,98 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "file_watch.h"
+
+struct FileWatch {
+    int fd;
+    char name[NAME_MAX + 1];    // File name within the watched directory
+};
+
+// NULL (with the reason printed) if the directory can't be watched
+FileWatch file_watch_start( char const *path )
+{
+    FileWatch watch = calloc(1, sizeof(struct FileWatch));
+    if (!watch)
+    {
+        return NULL;
+    }
+
+    // Split into directory and name - "file" is in ".", "/file" in "/"
+    char directory[PATH_MAX] = ".";
+    char const *slash = strrchr(path, '/');
+    char const *name = slash ? slash + 1 : path;
+    size_t directory_length = slash ? (size_t) (slash - path) : 0;
+    if (directory_length >= sizeof(directory) || strlen(name) > NAME_MAX || *name == '\0')
+    {
+        fprintf(stderr, "Can't watch %s\n", path);
+        free(watch);
+        return NULL;
+    }
+    if (slash)
+    {
+        memcpy(directory, path, directory_length);
+        directory[directory_length] = '\0';
+        if (directory_length == 0)
+        {
+            strcpy(directory, "/");
+        }
+    }
+    strcpy(watch->name, name);
+
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch->fd < 0 || inotify_add_watch(watch->fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        perror(directory);
+        if (watch->fd >= 0)
+        {
+            close(watch->fd);
+        }
+        free(watch);
+        return NULL;
+    }
+    return watch;
+}
+
+// Drains every queued event so one save only reports a change once
+bool file_watch_changed( FileWatch watch )
+{
+    _Alignas(struct inotify_event) char buffer[4096];
+    bool changed = false;
+    for (;;)
+    {
+        ssize_t length = read(watch->fd, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            if (length < 0 && errno != EAGAIN && errno != EINTR)
+            {
+                perror("file_watch_changed");
+            }
+            return changed;
+        }
+        for (char const *cursor = buffer; cursor < buffer + length; )
+        {
+            struct inotify_event const *event = (struct inotify_event const *) cursor;
+            // Lost events might have been ours
+            if ((event->mask & IN_Q_OVERFLOW) || (event->len > 0 && strcmp(event->name, watch->name) == 0))
+            {
+                changed = true;
+            }
+            cursor += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+void file_watch_stop( FileWatch watch )
+{
+    if (!watch)
+    {
+        return;
+    }
+    close(watch->fd);
+    free(watch);
+}
@@ -0,0 +1,24 @@
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+#include <stdbool.h>
+
+/*
+ * Tells the game loop when a file on disk has been replaced or rewritten (inotify, Linux only).
+ * The file's directory is watched rather than the file, so tools that write a new file and rename
+ * it over the old one (fighterc, most editors) are caught as well as ones that write in place.
+ * Never blocks - poll it once a frame.
+ *
+ * Usage:
+ *   FileWatch watch = file_watch_start(roster_path(ROSTER_PATH));
+ *   every frame:  if (file_watch_changed(watch)) reload it
+ *   file_watch_stop(watch);
+*/
+
+typedef struct FileWatch *FileWatch;
+
+extern FileWatch file_watch_start( char const *path );
+extern bool file_watch_changed( FileWatch watch );
+extern void file_watch_stop( FileWatch watch );
+
+#endif
@@ -6,6 +6,12 @@
 #define SCREEN_SIZE_X 1280
 #define SCREEN_SIZE_Y 720
 
+// Simulation runs at a fixed tick rate regardless of how fast we render - make TICK_RATE=n overrides it
+#ifndef SIM_TICK_RATE
+#define SIM_TICK_RATE 120
+#endif
+#define SIM_DT (1.0 / SIM_TICK_RATE)
+
 typedef struct PlayerInternals *PlayerInternals;
 
 typedef enum {   
@@ -35,35 +41,51 @@ typedef struct {
     Box hitbox;
     Vector_2D pos; // Center of sword
     PlayerId player; //If throw sword should know owner
-    bool thrown;
+    bool thrown;            // Out of the fighter's hand - flying or lying on the ground (projectile.h)
     struct {
-        double attack_timer;
+        int attack_ticks;       // Ticks into the current attack - indexes attack_table
         double attack_delay;
+        bool launching;         // Thrown this tick, not yet in the projectile pool
     } internal;
 } Sword;
 
 
+// What a fighter is doing - see the state table in player.c for what each one allows
+typedef enum {
+    STATE_IDLE,                 // Standing or running
+    STATE_CROUCH,
+    STATE_ATTACK,               // Sword attack, always on the ground
+    STATE_JUMP,                 // In the air - jumping or falling
+    STATE_DIVE_KICK,
+    STATE_STUNNED,              // Knocked into the air by a dive kick, can't act
+    STATE_STUNNED_LANDED,       // Still stunned, back on the ground
+    STATE_RECOVER,              // Bounced off after landing a dive kick, can't act
+    STATE_RECOVER_LANDED,
+    STATE_DEAD_FALLING,         // Killed in the air
+    STATE_DEAD,
+    STATE_THROW,                // Throwing the sword, can't act
+    STATE_COUNT
+} FighterState;
+
+// The cold side of a fighter - state, pos, prev_pos, vel and hurtbox are in its FighterStore slot
+// (fighter_store.h) and read through FIGHTER_STATE(player) etc
 typedef struct PlayerState{
     PlayerId id;
+    int character;                  // Roster index of def
+    struct FighterDef const *def;   // Movement, attacks and animations - mapped from the roster (roster.h)
+    struct FighterStore *store;
+    int slot;
+    int anim_row;       // Spritesheet row for the current state - set whenever the state or velocity changes
     double time_in_anim;
-    Vector_2D pos;  //Center of player
-    Vector_2D vel;
     Stance stance;
     // bool is_armed;
-    bool is_jumping;
-    bool is_attacking;
-    bool is_dead;
     bool is_right_facing;
-    bool in_stunned_state; //Stunned sprite
-    bool is_crouching;
     Box hitbox; //Punching or for dive kick
-    Box hurtbox;
     Sword sword;
     struct {
         double jump_delay;
         double stance_delay;
-        bool is_stunned; // Player cannot act/move
-        double stunned_duration;
+        double stunned_duration; // Time left in STUNNED / RECOVER / THROW
     } internal; 
 } *PlayerState;
 
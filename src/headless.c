@@ -0,0 +1,460 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "match.h"
+#include "input.h"
+#include "input_script.h"
+#include "combat.h"
+#include "player.h"
+#include "trace.h"
+#include "clock.h"
+#include "snapshot.h"
+#include "replay.h"
+#include "projectile.h"
+#include "roster.h"
+#include "arena.h"
+#include "alloc_guard.h"
+#include "game_types.h"
+#include "fighter_store.h"
+
+/*
+ * Headless simulation - steps matches as fast as the CPU allows with no window, renderer or SDL.
+ * Usage: ./headless [-t ticks] [-n fighters] [-F p1 p2] [-s script] [-r seed] [-p replay] [-w replay] [-f fps] [-c] [-v]
+ *   -t  total number of ticks to simulate (default 10000000)
+ *   -n  free-for-all with this many fighters instead of a 1v1 match - fighters spawn spread across
+ *       the screen and respawn RESPAWN_TIME after dying, for stress testing combat_update (can't be
+ *       combined with -p, -w, -f or -c)
+ *   -F  roster names of the two fighters (default both the first in the roster) - in a free-for-all
+ *       every other fighter is p2's, and a replay brings its own
+ *   -f  drive the ticks from a frame loop like main.c does, with a virtual clock advanced by
+ *       1/fps every frame - results must be identical whatever fps is used
+ *   -s  input script to play (see input_script.h), otherwise random inputs are used
+ *   -r  seed for random inputs (default 1)
+ *   -p  play a replay file (see replay.h) instead, stopping when it ends or at the first tick
+ *       whose state doesn't match the recording - recorded matches make good benchmark workloads
+ *   -w  record the inputs of this run to a replay file
+ *   -c  hash the match state every tick and print a checksum of all of them - two runs with the
+ *       same inputs must print the same checksum
+ *   -v  print combat messages
+*/
+
+#define DEFAULT_TICKS 10000000ULL
+#define RESPAWN_TIME 2.0
+
+// -n mode - every pair of fighters shares an input script like the two players of a match do
+typedef struct {
+    int count;
+    struct PlayerState *states;
+    FighterStore fighters;  // states[i] is slot i
+    void *fighter_memory;
+    PlayerInput *inputs;
+    InputScript *scripts;
+    double *dead_time;
+    int characters[2];      // Roster index for the even and the odd fighters
+    ProjectilePool projectiles;
+    uint64_t deaths;
+} FreeForAll;
+
+typedef struct {
+    Match match;            // Allocated from arena - a new one every match
+    Arena arena;
+    int characters[2];      // Roster index of each player
+    InputScript script;
+    Replay replay;          // Played instead of the script when set
+    Replay recording;
+    uint64_t matches_played;
+    uint64_t wins[2];
+    bool checksum_enabled;
+    uint64_t checksum;
+    bool replay_failed;
+} HeadlessRun;
+
+static bool run_tick( HeadlessRun *run );
+static int run_free_for_all( int fighter_count, int const characters[2], uint64_t total_ticks, char const *script_path, uint32_t seed );
+static void spawn_fighter( FreeForAll *ffa, int index );
+static void close_free_for_all( FreeForAll *ffa, int script_count );
+static double now_seconds( void );
+static void usage( char const *program );
+
+int main( int argc, char **argv )
+{
+    uint64_t total_ticks = DEFAULT_TICKS;
+    int fighter_count = 2;
+    char const *script_path = NULL;
+    char const *replay_path = NULL;
+    char const *record_path = NULL;
+    uint32_t seed = 1;
+    unsigned render_fps = 0;
+    bool checksum_enabled = false;
+    char const *fighter_names[2] = { NULL, NULL };
+    combat_verbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            total_ticks = strtoull(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            fighter_count = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-F") == 0 && i + 2 < argc)
+        {
+            fighter_names[0] = argv[++i];
+            fighter_names[1] = argv[++i];
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            script_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            seed = (uint32_t) strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            replay_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            record_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            render_fps = (unsigned) strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-c") == 0)
+        {
+            checksum_enabled = true;
+        }
+        else if (strcmp(argv[i], "-v") == 0)
+        {
+            combat_verbose = true;
+        }
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (fighter_count < 2)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (replay_path && fighter_names[0])
+    {
+        fprintf(stderr, "-F can't be used with -p - the replay says who played\n");
+        return EXIT_FAILURE;
+    }
+    if (fighter_count > 2 && (replay_path || record_path || render_fps || checksum_enabled))
+    {
+        fprintf(stderr, "-p, -w, -f and -c can't be used with -n - replays, frame pacing and checksums are 1v1 only\n");
+        return EXIT_FAILURE;
+    }
+
+    char const *roster_file = roster_path(ROSTER_PATH);
+    if (!roster_open(roster_file))
+    {
+        return EXIT_FAILURE;
+    }
+    int characters[2] = { 0, 0 };
+    for (int i = 0; i < 2; i++)
+    {
+        if (fighter_names[i] && (characters[i] = roster_find(fighter_names[i])) < 0)
+        {
+            fprintf(stderr, "No fighter called %s in %s\n", fighter_names[i], roster_file);
+            roster_close();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (fighter_count > 2)
+    {
+        return run_free_for_all(fighter_count, characters, total_ticks, script_path, seed);
+    }
+
+    InputScript script = script_path ? input_script_load(script_path) : input_script_random(seed);
+    if (!script)
+    {
+        roster_close();
+        return EXIT_FAILURE;
+    }
+
+    HeadlessRun run = { .script = script, .characters = { characters[0], characters[1] }, .checksum_enabled = checksum_enabled };
+    if (replay_path && !(run.replay = replay_open_read(replay_path)))
+    {
+        input_script_free(script);
+        roster_close();
+        return EXIT_FAILURE;
+    }
+    if (run.replay)
+    {
+        run.characters[PLAYER_1] = replay_character(run.replay, PLAYER_1);
+        run.characters[PLAYER_2] = replay_character(run.replay, PLAYER_2);
+    }
+    if (record_path && !(run.recording = replay_open_write(record_path, REPLAY_DEFAULT_HASH_INTERVAL, run.characters[0], run.characters[1])))
+    {
+        replay_close(run.replay);
+        input_script_free(script);
+        roster_close();
+        return EXIT_FAILURE;
+    }
+    if (!arena_init(&run.arena, MATCH_ARENA_SIZE))
+    {
+        replay_close(run.replay);
+        replay_close(run.recording);
+        input_script_free(script);
+        roster_close();
+        return EXIT_FAILURE;
+    }
+    run.match = arena_alloc(&run.arena, sizeof(struct Match));
+    match_init(run.match, run.characters[0], run.characters[1]);
+    ALLOC_GUARD_BEGIN("a match");
+
+    uint64_t frames = 0;
+    double start = now_seconds();
+    if (render_fps == 0)
+    {
+        for (uint64_t tick = 0; tick < total_ticks; tick++)
+        {
+            if (!run_tick(&run))
+            {
+                total_ticks = tick;
+            }
+        }
+    }
+    else
+    {
+        // Same accumulator as the game loop but time only moves when we say so
+        clock_use_virtual(0);
+        uint64_t prev_frame_ns = clock_now_ns();
+        double accumulator = 0.0;
+        uint64_t tick = 0;
+        while (tick < total_ticks)
+        {
+            clock_virtual_advance(NS_PER_SECOND / render_fps);
+            uint64_t current_frame_ns = clock_now_ns();
+            accumulator += (double) (current_frame_ns - prev_frame_ns) / (double) NS_PER_SECOND;
+            prev_frame_ns = current_frame_ns;
+
+            while (accumulator >= SIM_DT && tick < total_ticks)
+            {
+                if (!run_tick(&run))
+                {
+                    total_ticks = tick;
+                    break;
+                }
+                accumulator -= SIM_DT;
+                tick++;
+            }
+            frames++;
+        }
+    }
+    double elapsed = now_seconds() - start;
+    ALLOC_GUARD_END();
+
+    printf("ticks:          %llu\n", (unsigned long long) total_ticks);
+    printf("sim time:       %.1f s\n", total_ticks * SIM_DT);
+    printf("wall time:      %.3f s\n", elapsed);
+    printf("ticks/second:   %.0f\n", elapsed > 0.0 ? total_ticks / elapsed : 0.0);
+    printf("matches:        %llu (player 1 won %llu, player 2 won %llu)\n",
+        (unsigned long long) run.matches_played, (unsigned long long) run.wins[PLAYER_1], (unsigned long long) run.wins[PLAYER_2]);
+    if (render_fps > 0)
+    {
+        printf("render frames:  %llu at %u fps\n", (unsigned long long) frames, render_fps);
+    }
+    if (checksum_enabled)
+    {
+        printf("checksum:       %016llx\n", (unsigned long long) run.checksum);
+    }
+    printf("final tick:     %llu (player 1 at %.3f, %.3f  player 2 at %.3f, %.3f)\n", (unsigned long long) run.match->tick,
+        FIGHTER_POS(&run.match->player1).x, FIGHTER_POS(&run.match->player1).y, FIGHTER_POS(&run.match->player2).x, FIGHTER_POS(&run.match->player2).y);
+
+    if (run.replay && replay_mismatch_tick(run.replay) != 0)
+    {
+        printf("replay:         FAILED (desync by tick %llu)\n", (unsigned long long) replay_mismatch_tick(run.replay));
+    }
+    else if (run.replay)
+    {
+        printf("replay:         %s\n", run.replay_failed ? "FAILED" : "ok");
+    }
+
+    TRACE_DUMP("headless_trace");
+
+    arena_free(&run.arena);
+    input_script_free(script);
+    replay_close(run.replay);
+    replay_close(run.recording);
+    roster_close();
+
+    return run.replay_failed ? EXIT_FAILURE : 0;
+}
+
+// Returns false when a replay being played has ended or stopped matching
+static bool run_tick( HeadlessRun *run )
+{
+    PlayerInput p1_input, p2_input;
+    if (!run->replay)
+    {
+        input_script_next(run->script, &p1_input, &p2_input);
+    }
+    else if (!replay_next_tick(run->replay, &p1_input, &p2_input))
+    {
+        return false;
+    }
+    match_step(run->match, p1_input, p2_input);
+
+    if (run->recording)
+    {
+        replay_record_tick(run->recording, p1_input, p2_input, run->match);
+    }
+    if (run->replay && replay_check_tick(run->replay, run->match) != REPLAY_OK)
+    {
+        run->replay_failed = true;
+        return false;
+    }
+
+    if (run->checksum_enabled)
+    {
+        run->checksum = (run->checksum * 31) ^ match_hash(run->match);
+    }
+
+    if (run->match->is_over)
+    {
+        run->matches_played++;
+        // Both can die on the same tick so count each survivor separately
+        run->wins[PLAYER_1] += !player_is_dead(&run->match->player1);
+        run->wins[PLAYER_2] += !player_is_dead(&run->match->player2);
+
+        // Setting up the next match is allowed to allocate - the ticks of it aren't
+        ALLOC_GUARD_END();
+        arena_reset(&run->arena);
+        run->match = arena_alloc(&run->arena, sizeof(struct Match));
+        match_init(run->match, run->characters[0], run->characters[1]);
+        ALLOC_GUARD_BEGIN("a match");
+    }
+    return true;
+}
+
+static int run_free_for_all( int fighter_count, int const characters[2], uint64_t total_ticks, char const *script_path, uint32_t seed )
+{
+    int script_count = (fighter_count + 1) / 2;
+    FreeForAll ffa = {
+        .count = fighter_count,
+        .states = calloc(fighter_count, sizeof(struct PlayerState)),
+        .fighter_memory = malloc(FIGHTER_STORE_SIZE(fighter_count)),
+        .inputs = calloc(fighter_count + 1, sizeof(PlayerInput)),  // +1 so an odd last pair has somewhere to write
+        .scripts = calloc(script_count, sizeof(InputScript)),
+        .dead_time = calloc(fighter_count, sizeof(double)),
+        .characters = { characters[0], characters[1] }
+    };
+    projectile_pool_clear(&ffa.projectiles);
+    assert(ffa.states && ffa.fighter_memory && ffa.inputs && ffa.scripts && ffa.dead_time);
+    fighter_store_init(&ffa.fighters, ffa.fighter_memory, fighter_count);
+
+    for (int i = 0; i < script_count; i++)
+    {
+        ffa.scripts[i] = script_path ? input_script_load(script_path) : input_script_random(seed + i);
+        if (!ffa.scripts[i])
+        {
+            close_free_for_all(&ffa, script_count);
+            return EXIT_FAILURE;
+        }
+    }
+    for (int i = 0; i < fighter_count; i++)
+    {
+        fighter_store_bind(&ffa.fighters, i, &ffa.states[i]);
+        spawn_fighter(&ffa, i);
+    }
+
+    double start = now_seconds();
+    for (uint64_t tick = 0; tick < total_ticks; tick++)
+    {
+        for (int i = 0; i < script_count; i++)
+        {
+            input_script_next(ffa.scripts[i], &ffa.inputs[2 * i], &ffa.inputs[2 * i + 1]);
+        }
+        match_step_fighters(&ffa.fighters, ffa.inputs, &ffa.projectiles);
+
+        for (int i = 0; i < fighter_count; i++)
+        {
+            if (!player_is_dead(&ffa.states[i]))
+            {
+                continue;
+            }
+            if (ffa.dead_time[i] == 0.0)
+            {
+                ffa.deaths++;
+            }
+            ffa.dead_time[i] += SIM_DT;
+            if (ffa.dead_time[i] >= RESPAWN_TIME)
+            {
+                spawn_fighter(&ffa, i);
+            }
+        }
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("fighters:       %d\n", fighter_count);
+    printf("ticks:          %llu\n", (unsigned long long) total_ticks);
+    printf("sim time:       %.1f s\n", total_ticks * SIM_DT);
+    printf("wall time:      %.3f s\n", elapsed);
+    printf("ticks/second:   %.0f (%.0f fighter ticks/second)\n", elapsed > 0.0 ? total_ticks / elapsed : 0.0,
+        elapsed > 0.0 ? (double) total_ticks * fighter_count / elapsed : 0.0);
+    printf("deaths:         %llu\n", (unsigned long long) ffa.deaths);
+
+    TRACE_DUMP("headless_trace");
+
+    close_free_for_all(&ffa, script_count);
+    return 0;
+}
+
+// Also closes the roster - scripts that never loaded are still NULL and skipped
+static void close_free_for_all( FreeForAll *ffa, int script_count )
+{
+    for (int i = 0; i < script_count; i++)
+    {
+        input_script_free(ffa->scripts[i]);
+    }
+    free(ffa->states);
+    free(ffa->fighter_memory);
+    free(ffa->inputs);
+    free(ffa->scripts);
+    free(ffa->dead_time);
+    roster_close();
+}
+
+// Evenly spaced along the ground, facing the middle of the screen
+static void spawn_fighter( FreeForAll *ffa, int index )
+{
+    PlayerState fighter = &ffa->states[index];
+    // Whatever they threw last life is gone with it
+    projectile_pool_release_owner(&ffa->projectiles, index);
+    player_init(fighter, (index % 2 == 0) ? PLAYER_1 : PLAYER_2, ffa->characters[index % 2]);
+
+    double spacing = (SCREEN_SIZE_X - FIGHTER_HURTBOX(fighter).width) / (ffa->count - 1);
+    FIGHTER_POS(fighter).x = FIGHTER_HURTBOX(fighter).width / 2.0 + index * spacing;
+    FIGHTER_PREV_POS(fighter) = FIGHTER_POS(fighter);
+    fighter->is_right_facing = FIGHTER_POS(fighter).x < SCREEN_SIZE_X / 2.0;
+    ffa->dead_time[index] = 0.0;
+}
+
+// Wall time - deliberately not clock_now_ns() as that may be the virtual clock
+static double now_seconds( void )
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void usage( char const *program )
+{
+    fprintf(stderr, "Usage: %s [-t ticks] [-n fighters] [-F p1 p2] [-s script] [-r seed] [-p replay] [-w replay] [-f fps] [-c] [-v]\n", program);
+}
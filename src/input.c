@@ -3,6 +3,12 @@
 #include "input.h"
 #include "game_types.h"
 
+/* Bits used by input_pack_buttons */
+#define BUTTON_UP       (1u << 0)
+#define BUTTON_DOWN     (1u << 1)
+#define BUTTON_ATTACK   (1u << 2)
+#define BUTTON_JUMP     (1u << 3)
+
 static PlayerInput player1_input( void ); 
 static PlayerInput player2_input( void ); 
 
@@ -23,6 +29,23 @@ PlayerInput input_get( PlayerId player_id )
     return input; 
 }
 
+uint8_t input_pack_buttons( PlayerInput input )
+{
+    uint8_t buttons = 0;
+    buttons |= (input.joystick_pos == JOYSTICK_UP) ? BUTTON_UP : 0;
+    buttons |= (input.joystick_pos == JOYSTICK_DOWN) ? BUTTON_DOWN : 0;
+    buttons |= input.attack_pressed ? BUTTON_ATTACK : 0;
+    buttons |= input.jump_pressed ? BUTTON_JUMP : 0;
+    return buttons;
+}
+
+void input_unpack_buttons( PlayerInput *input, uint8_t buttons )
+{
+    input->joystick_pos = (buttons & BUTTON_UP) ? JOYSTICK_UP : (buttons & BUTTON_DOWN) ? JOYSTICK_DOWN : JOYSTICK_MID;
+    input->attack_pressed = buttons & BUTTON_ATTACK;
+    input->jump_pressed = buttons & BUTTON_JUMP;
+}
+
 static PlayerInput player1_input( void ) 
 {  
     PlayerInput input;
@@ -1,6 +1,7 @@
 #ifndef INPUT_H
 #define INPUT_H
 
+#include <stdint.h>
 #include "game_types.h"
 
 typedef enum {
@@ -18,5 +19,9 @@ typedef struct PlayerInput {
 
 extern PlayerInput input_get( PlayerId player_id ); 
 
+// Joystick direction and buttons in one byte for replay files and network packets
+extern uint8_t input_pack_buttons( PlayerInput input );
+extern void input_unpack_buttons( PlayerInput *input, uint8_t buttons );
+
 #endif
 
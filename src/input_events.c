@@ -0,0 +1,214 @@
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "input_events.h"
+#include "input.h"
+
+// Analog stick has to be pushed this far before it moves the player - applied when the tick's
+// input is built, the ring carries the raw position
+#define MOVE_DEAD_ZONE 0.5
+
+static bool input_ring_peek( InputRing *ring, InputEvent *event );
+static PlayerInput held_to_input( bool held[INPUT_BUTTON_COUNT], bool pressed[INPUT_BUTTON_COUNT], double move_x, double peak_x );
+static void decode_buttons( PlayerInput input, bool buttons[INPUT_BUTTON_COUNT] );
+
+void input_ring_init( InputRing *ring )
+{
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+}
+
+// Producer only - returns false (and counts a drop) if the consumer has fallen a whole ring behind
+bool input_ring_push( InputRing *ring, InputEvent event )
+{
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail == INPUT_RING_CAPACITY)
+    {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+    ring->events[head & (INPUT_RING_CAPACITY - 1)] = event;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+// Consumer only
+bool input_ring_pop( InputRing *ring, InputEvent *event )
+{
+    if (!input_ring_peek(ring, event))
+    {
+        return false;
+    }
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+void input_events_init( InputEvents *events )
+{
+    input_ring_init(&events->keyboard);
+    input_ring_init(&events->hardware);
+    memset(events->held, 0, sizeof(events->held));
+    events->move_x[PLAYER_1] = 0.0;
+    events->move_x[PLAYER_2] = 0.0;
+}
+
+/*
+ * Usage: input_events_next_tick(events, tick_end_ns, &p1_input, &p2_input, &tick)
+ * Consumes every edge up to tick_end_ns (oldest first across both rings) and builds the inputs for
+ * that tick. A button counts if it is held at the end of the tick or was pressed at any point in it,
+ * and the stick counts where it ends the tick or, if that's inside the dead zone, the furthest it got.
+ * tick can be NULL if the caller doesn't need the individual edges.
+*/
+void input_events_next_tick( InputEvents *events, uint64_t tick_end_ns, PlayerInput *p1_input, PlayerInput *p2_input, InputTick *tick )
+{
+    bool pressed[2][INPUT_BUTTON_COUNT] = { { false } };
+    double peak_x[2] = { 0.0, 0.0 };
+    if (tick)
+    {
+        tick->event_count = 0;
+    }
+
+    InputEvent keyboard_event = { 0 }, hardware_event = { 0 };
+    bool have_keyboard = input_ring_peek(&events->keyboard, &keyboard_event) && keyboard_event.timestamp_ns <= tick_end_ns;
+    bool have_hardware = input_ring_peek(&events->hardware, &hardware_event) && hardware_event.timestamp_ns <= tick_end_ns;
+
+    while (have_keyboard || have_hardware)
+    {
+        // Merge both rings in time order
+        InputEvent event;
+        if (have_keyboard && (!have_hardware || keyboard_event.timestamp_ns <= hardware_event.timestamp_ns))
+        {
+            input_ring_pop(&events->keyboard, &event);
+            have_keyboard = input_ring_peek(&events->keyboard, &keyboard_event) && keyboard_event.timestamp_ns <= tick_end_ns;
+        }
+        else
+        {
+            input_ring_pop(&events->hardware, &event);
+            have_hardware = input_ring_peek(&events->hardware, &hardware_event) && hardware_event.timestamp_ns <= tick_end_ns;
+        }
+
+        if (event.player > PLAYER_2 || event.button > INPUT_AXIS_MOVE_X)
+        {
+            continue;
+        }
+        if (event.button == INPUT_AXIS_MOVE_X)
+        {
+            events->move_x[event.player] = event.value;
+            if (fabs(event.value) > fabs(peak_x[event.player]))
+            {
+                peak_x[event.player] = event.value;
+            }
+        }
+        else
+        {
+            events->held[event.player][event.button] = event.pressed;
+            if (event.pressed)
+            {
+                pressed[event.player][event.button] = true;
+            }
+        }
+        if (tick && tick->event_count < INPUT_TICK_MAX_EVENTS)
+        {
+            tick->events[tick->event_count++] = event;
+        }
+    }
+
+    *p1_input = held_to_input(events->held[PLAYER_1], pressed[PLAYER_1], events->move_x[PLAYER_1], peak_x[PLAYER_1]);
+    *p2_input = held_to_input(events->held[PLAYER_2], pressed[PLAYER_2], events->move_x[PLAYER_2], peak_x[PLAYER_2]);
+    if (tick)
+    {
+        tick->inputs[PLAYER_1] = *p1_input;
+        tick->inputs[PLAYER_2] = *p2_input;
+    }
+}
+
+// For level triggered sources (the arcade hardware) - pushes an edge for every button that changed
+// and the raw stick position whenever it moved
+void input_events_push_diff( InputRing *ring, PlayerId player, PlayerInput previous, PlayerInput current, uint64_t timestamp_ns )
+{
+    if (current.move_x != previous.move_x)
+    {
+        input_ring_push(ring, (InputEvent) { timestamp_ns, (uint8_t) player, INPUT_AXIS_MOVE_X, false, (float) current.move_x });
+    }
+
+    bool before[INPUT_BUTTON_COUNT], after[INPUT_BUTTON_COUNT];
+    decode_buttons(previous, before);
+    decode_buttons(current, after);
+
+    for (int button = 0; button < INPUT_BUTTON_COUNT; button++)
+    {
+        if (before[button] != after[button])
+        {
+            input_ring_push(ring, (InputEvent) { timestamp_ns, (uint8_t) player, (uint8_t) button, after[button], 0.0f });
+        }
+    }
+}
+
+static bool input_ring_peek( InputRing *ring, InputEvent *event )
+{
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail == head)
+    {
+        return false;
+    }
+    *event = ring->events[tail & (INPUT_RING_CAPACITY - 1)];
+    return true;
+}
+
+// Same priorities as the old keyboard code - left beats right and down beats up, and the keys beat the stick
+static PlayerInput held_to_input( bool held[INPUT_BUTTON_COUNT], bool pressed[INPUT_BUTTON_COUNT], double move_x, double peak_x )
+{
+    bool active[INPUT_BUTTON_COUNT];
+    for (int button = 0; button < INPUT_BUTTON_COUNT; button++)
+    {
+        active[button] = held[button] || pressed[button];
+    }
+
+    double stick = 0.0;
+    if (fabs(move_x) > MOVE_DEAD_ZONE)
+    {
+        stick = move_x;
+    }
+    else if (fabs(peak_x) > MOVE_DEAD_ZONE)
+    {
+        stick = peak_x;
+    }
+
+    PlayerInput input = {stick, JOYSTICK_MID, false, false};
+    if (active[INPUT_BUTTON_RIGHT])
+    {
+        input.move_x = 1.0;
+    }
+    if (active[INPUT_BUTTON_LEFT])
+    {
+        input.move_x = -1.0;
+    }
+    if (active[INPUT_BUTTON_UP])
+    {
+        input.joystick_pos = JOYSTICK_UP;
+    }
+    if (active[INPUT_BUTTON_DOWN])
+    {
+        input.joystick_pos = JOYSTICK_DOWN;
+    }
+    input.attack_pressed = active[INPUT_BUTTON_ATTACK];
+    input.jump_pressed = active[INPUT_BUTTON_JUMP];
+    return input;
+}
+
+// The stick goes through INPUT_AXIS_MOVE_X, so left/right are only ever keys
+static void decode_buttons( PlayerInput input, bool buttons[INPUT_BUTTON_COUNT] )
+{
+    buttons[INPUT_BUTTON_LEFT] = false;
+    buttons[INPUT_BUTTON_RIGHT] = false;
+    buttons[INPUT_BUTTON_UP] = input.joystick_pos == JOYSTICK_UP;
+    buttons[INPUT_BUTTON_DOWN] = input.joystick_pos == JOYSTICK_DOWN;
+    buttons[INPUT_BUTTON_ATTACK] = input.attack_pressed;
+    buttons[INPUT_BUTTON_JUMP] = input.jump_pressed;
+}
@@ -0,0 +1,68 @@
+#ifndef INPUT_EVENTS_H
+#define INPUT_EVENTS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "game_types.h"
+#include "input.h"
+
+/*
+ * Edge triggered inputs - every press and release with the time it happened, so taps that start
+ * and end between two ticks aren't lost. Producers push into single-producer/single-consumer
+ * lock-free rings (one per producer), the simulation drains them once per tick.
+*/
+
+// Must be a power of 2
+#define INPUT_RING_CAPACITY 256
+#define INPUT_TICK_MAX_EVENTS 32
+
+typedef enum {
+    INPUT_BUTTON_LEFT,
+    INPUT_BUTTON_RIGHT,
+    INPUT_BUTTON_UP,
+    INPUT_BUTTON_DOWN,
+    INPUT_BUTTON_ATTACK,
+    INPUT_BUTTON_JUMP,
+    INPUT_BUTTON_COUNT,
+    INPUT_AXIS_MOVE_X = INPUT_BUTTON_COUNT  // Analog stick moved - value has the raw position
+} InputButton;
+
+typedef struct InputEvent {
+    uint64_t timestamp_ns;  // clock_now_ns() time of the edge
+    uint8_t player;         // PlayerId
+    uint8_t button;         // InputButton
+    bool pressed;           // false for release
+    float value;            // INPUT_AXIS_MOVE_X only - raw stick position, -1.0 to 1.0
+} InputEvent;
+
+typedef struct InputRing {
+    InputEvent events[INPUT_RING_CAPACITY];
+    atomic_uint head;       // Next slot the producer writes
+    atomic_uint tail;       // Next slot the consumer reads
+    atomic_uint dropped;    // Events lost because the ring was full
+} InputRing;
+
+/* Everything one tick gets out of the rings */
+typedef struct InputTick {
+    PlayerInput inputs[2];  // Held at the end of the tick or pressed at any point during it
+    InputEvent events[INPUT_TICK_MAX_EVENTS];   // Every edge in the tick, oldest first
+    int event_count;
+} InputTick;
+
+typedef struct InputEvents {
+    InputRing keyboard;     // Produced on the thread that pumps SDL events
+    InputRing hardware;     // Produced by the arcade hardware sampler thread
+    bool held[2][INPUT_BUTTON_COUNT];   // Consumer side only
+    double move_x[2];                   // Consumer side only - last raw stick position
+} InputEvents;
+
+extern void input_ring_init( InputRing *ring );
+extern bool input_ring_push( InputRing *ring, InputEvent event );
+extern bool input_ring_pop( InputRing *ring, InputEvent *event );
+
+extern void input_events_init( InputEvents *events );
+extern void input_events_next_tick( InputEvents *events, uint64_t tick_end_ns, PlayerInput *p1_input, PlayerInput *p2_input, InputTick *tick );
+extern void input_events_push_diff( InputRing *ring, PlayerId player, PlayerInput previous, PlayerInput current, uint64_t timestamp_ns );
+
+#endif
@@ -0,0 +1,68 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_timer.h>
+#include "input_sampler.h"
+#include "input_events.h"
+#include "input.h"
+#include "clock.h"
+
+// 1kHz - a tap has to be held for at least this long to be seen
+#define SAMPLE_PERIOD_MS 1
+
+struct InputSampler {
+    SDL_Thread *thread;
+    InputRing *ring;
+    atomic_bool quit;
+};
+
+static int input_sampler_run( void *data );
+
+//NOTE: must be stopped with input_sampler_stop
+InputSampler input_sampler_start( InputRing *ring )
+{
+    InputSampler sampler = calloc(1, sizeof(struct InputSampler));
+    assert(sampler != NULL);
+    sampler->ring = ring;
+    atomic_init(&sampler->quit, false);
+
+    sampler->thread = SDL_CreateThread(input_sampler_run, "input sampler", sampler);
+    if (!sampler->thread)
+    {
+        fprintf(stderr, "Could not create input sampler thread: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    return sampler;
+}
+
+void input_sampler_stop( InputSampler sampler )
+{
+    atomic_store(&sampler->quit, true);
+    SDL_WaitThread(sampler->thread, NULL);
+    free(sampler);
+}
+
+static int input_sampler_run( void *data )
+{
+    InputSampler sampler = data;
+    PlayerInput previous[2] = {
+        {0.0, JOYSTICK_MID, false, false},
+        {0.0, JOYSTICK_MID, false, false}
+    };
+
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+    while (!atomic_load(&sampler->quit))
+    {
+        for (PlayerId player = PLAYER_1; player <= PLAYER_2; player++)
+        {
+            PlayerInput current = input_get(player);
+            input_events_push_diff(sampler->ring, player, previous[player], current, clock_now_ns());
+            previous[player] = current;
+        }
+        SDL_Delay(SAMPLE_PERIOD_MS);
+    }
+    return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef INPUT_SAMPLER_H
+#define INPUT_SAMPLER_H
+
+typedef struct InputRing InputRing;
+
+/*
+ * Polls the arcade hardware (input_get) on its own thread much faster than we tick,
+ * turning level changes into timestamped edges in the ring. The sampler is the ring's only producer.
+*/
+typedef struct InputSampler *InputSampler;
+
+extern InputSampler input_sampler_start( InputRing *ring );
+extern void input_sampler_stop( InputSampler sampler );
+
+#endif
@@ -0,0 +1,186 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "input_script.h"
+#include "input.h"
+
+#define MAX_LINE_LENGTH 128
+
+/* Random mode - each player holds an input for a random number of ticks like a human would */
+#define RANDOM_MIN_HOLD 4
+#define RANDOM_MAX_HOLD 40
+
+typedef struct {
+    uint32_t ticks;
+    PlayerInput inputs[2];
+} ScriptStep;
+
+struct InputScript {
+    ScriptStep *steps;
+    int step_count;
+    int current_step;
+    uint32_t ticks_left;  // Ticks left on the current step
+
+    bool random;
+    uint32_t rng_state;
+};
+
+static bool parse_keys( char const *keys, PlayerInput *input );
+static PlayerInput random_input( InputScript script );
+static uint32_t next_random( InputScript script );
+
+//NOTE: Must free with input_script_free - returns NULL if the file can't be read or parsed
+InputScript input_script_load( char const *path )
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        fprintf(stderr, "Could not open input script %s\n", path);
+        return NULL;
+    }
+
+    InputScript script = calloc(1, sizeof(struct InputScript));
+    assert(script != NULL);
+    int capacity = 0;
+
+    char line[MAX_LINE_LENGTH];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        line_no++;
+        char p1_keys[MAX_LINE_LENGTH], p2_keys[MAX_LINE_LENGTH];
+        unsigned ticks;
+
+        if (line[0] == '#' || strspn(line, " \t\r\n") == strlen(line))
+        {
+            continue;
+        }
+
+        ScriptStep step = { 0 };
+        if (sscanf(line, "%u %127s %127s", &ticks, p1_keys, p2_keys) != 3 || ticks == 0
+            || !parse_keys(p1_keys, &step.inputs[0]) || !parse_keys(p2_keys, &step.inputs[1]))
+        {
+            fprintf(stderr, "%s:%d: invalid script step\n", path, line_no);
+            fclose(file);
+            input_script_free(script);
+            return NULL;
+        }
+        step.ticks = ticks;
+
+        if (script->step_count == capacity)
+        {
+            capacity = (capacity == 0) ? 16 : capacity * 2;
+            script->steps = realloc(script->steps, capacity * sizeof(ScriptStep));
+            assert(script->steps != NULL);
+        }
+        script->steps[script->step_count++] = step;
+    }
+    fclose(file);
+
+    if (script->step_count == 0)
+    {
+        fprintf(stderr, "%s: input script is empty\n", path);
+        input_script_free(script);
+        return NULL;
+    }
+    script->ticks_left = script->steps[0].ticks;
+
+    return script;
+}
+
+// Same seed always gives the same sequence of inputs
+InputScript input_script_random( uint32_t seed )
+{
+    InputScript script = calloc(1, sizeof(struct InputScript));
+    assert(script != NULL);
+
+    script->random = true;
+    script->rng_state = (seed == 0) ? 1 : seed;
+
+    // Random mode uses a single step which gets rerolled once it runs out
+    script->steps = calloc(1, sizeof(ScriptStep));
+    assert(script->steps != NULL);
+    script->step_count = 1;
+
+    return script;
+}
+
+void input_script_next( InputScript script, PlayerInput *p1_input, PlayerInput *p2_input )
+{
+    if (script->ticks_left == 0)
+    {
+        if (script->random)
+        {
+            script->steps[0].inputs[0] = random_input(script);
+            script->steps[0].inputs[1] = random_input(script);
+            script->steps[0].ticks = RANDOM_MIN_HOLD + next_random(script) % (RANDOM_MAX_HOLD - RANDOM_MIN_HOLD);
+        }
+        else
+        {
+            script->current_step = (script->current_step + 1) % script->step_count;
+        }
+        script->ticks_left = script->steps[script->current_step].ticks;
+    }
+
+    *p1_input = script->steps[script->current_step].inputs[0];
+    *p2_input = script->steps[script->current_step].inputs[1];
+    script->ticks_left--;
+}
+
+void input_script_free( InputScript script )
+{
+    if (script)
+    {
+        free(script->steps);
+        free(script);
+    }
+}
+
+static bool parse_keys( char const *keys, PlayerInput *input )
+{
+    *input = (PlayerInput) {0.0, JOYSTICK_MID, false, false};
+    if (strcmp(keys, "-") == 0)
+    {
+        return true;
+    }
+
+    for (char const *key = keys; *key != '\0'; key++)
+    {
+        switch (*key)
+        {
+            case 'L': input->move_x = -1.0; break;
+            case 'R': input->move_x = 1.0; break;
+            case 'U': input->joystick_pos = JOYSTICK_UP; break;
+            case 'D': input->joystick_pos = JOYSTICK_DOWN; break;
+            case 'A': input->attack_pressed = true; break;
+            case 'J': input->jump_pressed = true; break;
+            default: return false;
+        }
+    }
+    return true;
+}
+
+static PlayerInput random_input( InputScript script )
+{
+    uint32_t r = next_random(script);
+    PlayerInput input = {
+        .move_x = (double) ((int) (r % 3) - 1),
+        .joystick_pos = (JoystickPos) ((r >> 2) % 3),
+        .attack_pressed = ((r >> 4) % 4) == 0,
+        .jump_pressed = ((r >> 6) % 6) == 0
+    };
+    return input;
+}
+
+// xorshift32 - fast and the same on every platform
+static uint32_t next_random( InputScript script )
+{
+    uint32_t x = script->rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    script->rng_state = x;
+    return x;
+}
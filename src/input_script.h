@@ -0,0 +1,22 @@
+#ifndef INPUT_SCRIPT_H
+#define INPUT_SCRIPT_H
+
+#include <stdint.h>
+
+typedef struct PlayerInput PlayerInput;
+
+/*
+ * Scripted input source for running matches without a keyboard or the arcade hardware.
+ * A script file has one step per line:   <ticks> <player1 keys> <player2 keys>
+ * where keys is any of L R U D A J (left, right, up, down, attack, jump) or - for nothing
+ * e.g. "30 RJ LA" holds right+jump for player 1 and left+attack for player 2 for 30 ticks.
+ * Lines starting with # are comments, the script loops once it reaches the end.
+*/
+typedef struct InputScript *InputScript;
+
+extern InputScript input_script_load( char const *path );
+extern InputScript input_script_random( uint32_t seed );
+extern void input_script_next( InputScript script, PlayerInput *p1_input, PlayerInput *p2_input );
+extern void input_script_free( InputScript script );
+
+#endif
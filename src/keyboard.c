@@ -3,57 +3,80 @@
 #include <SDL2/SDL.h>
 #include "keyboard.h"
 #include "input.h"
+#include "input_events.h"
+#include "clock.h"
 
-void set_player1_keyboard_input( PlayerInput *player, const uint8_t *keyboard_state ) {
-    if (keyboard_state[SDL_SCANCODE_W]) {
-        printf("1: W arrow key\n");
-        player->joystick_pos = JOYSTICK_UP;
-    }
-    if (keyboard_state[SDL_SCANCODE_S]) {
-        printf("1: S arrow key\n");
-        player->joystick_pos = JOYSTICK_DOWN;
-    }
-    if (keyboard_state[SDL_SCANCODE_D]) {
-        printf("1: D arrow key\n");
-        player->move_x = 1.0;
-    }
-    if (keyboard_state[SDL_SCANCODE_A]) {
-        printf("1: A arrow key\n");
-        player->move_x = -1.0;
-    }
-    if (keyboard_state[SDL_SCANCODE_6]) {
-        printf("1: attack (6)\n");
-        player->attack_pressed = true;
-    }
-    if (keyboard_state[SDL_SCANCODE_5]) {
-        printf("1: jump (5)\n");
-        player->jump_pressed = true;
-    }
+typedef struct {
+    SDL_Scancode scancode;
+    PlayerId player;
+    InputButton button;
+} KeyBinding;
+
+static const KeyBinding key_bindings[] = {
+    { SDL_SCANCODE_W, PLAYER_1, INPUT_BUTTON_UP },
+    { SDL_SCANCODE_S, PLAYER_1, INPUT_BUTTON_DOWN },
+    { SDL_SCANCODE_D, PLAYER_1, INPUT_BUTTON_RIGHT },
+    { SDL_SCANCODE_A, PLAYER_1, INPUT_BUTTON_LEFT },
+    { SDL_SCANCODE_6, PLAYER_1, INPUT_BUTTON_ATTACK },
+    { SDL_SCANCODE_5, PLAYER_1, INPUT_BUTTON_JUMP },
+
+    { SDL_SCANCODE_UP, PLAYER_2, INPUT_BUTTON_UP },
+    { SDL_SCANCODE_DOWN, PLAYER_2, INPUT_BUTTON_DOWN },
+    { SDL_SCANCODE_RIGHT, PLAYER_2, INPUT_BUTTON_RIGHT },
+    { SDL_SCANCODE_LEFT, PLAYER_2, INPUT_BUTTON_LEFT },
+    { SDL_SCANCODE_M, PLAYER_2, INPUT_BUTTON_ATTACK },
+    { SDL_SCANCODE_N, PLAYER_2, INPUT_BUTTON_JUMP },
+};
+
+static int keyboard_event_watch( void *data, SDL_Event *event );
+
+static InputRing *keyboard_ring = NULL;
+
+void keyboard_start_events( InputRing *ring )
+{
+    keyboard_ring = ring;
+    SDL_AddEventWatch(keyboard_event_watch, ring);
 }
 
-void set_player2_keyboard_input( PlayerInput *player, const uint8_t *keyboard_state ) {
-    if (keyboard_state[SDL_SCANCODE_UP]) {
-        printf("2: up arrow key\n");
-        player->joystick_pos = JOYSTICK_UP;
-    }
-    if (keyboard_state[SDL_SCANCODE_DOWN]) {
-        printf("2: down arrow key\n");
-        player->joystick_pos = JOYSTICK_DOWN;
-    }
-    if (keyboard_state[SDL_SCANCODE_RIGHT]) {
-        printf("2: right arrow key\n");
-        player->move_x = 1.0;
-    }
-    if (keyboard_state[SDL_SCANCODE_LEFT]) {
-        printf("2: left arrow key\n");
-        player->move_x = -1.0;
+void keyboard_stop_events( void )
+{
+    if (keyboard_ring)
+    {
+        SDL_DelEventWatch(keyboard_event_watch, keyboard_ring);
+        keyboard_ring = NULL;
     }
-    if (keyboard_state[SDL_SCANCODE_M]) {
-        printf("2: attack (M)\n");
-        player->attack_pressed = true;
+}
+
+/*
+ * Called by SDL as each event is queued (on the thread pumping events) - so this is the
+ * only producer for the keyboard ring.
+*/
+static int keyboard_event_watch( void *data, SDL_Event *event )
+{
+    InputRing *ring = data;
+    if ((event->type != SDL_KEYDOWN && event->type != SDL_KEYUP) || event->key.repeat)
+    {
+        return 0;
     }
-    if (keyboard_state[SDL_SCANCODE_N]) {
-        printf("2: jump (N)\n");
-        player->jump_pressed = true;
+
+    // SDL stamps events in ms when the OS delivered them - which may be well before this pump
+    uint64_t now_ns = clock_now_ns();
+    uint32_t age_ms = SDL_GetTicks() - event->key.timestamp;
+    uint64_t age_ns = (uint64_t) age_ms * 1000000ULL;
+    uint64_t timestamp_ns = (age_ns < now_ns) ? now_ns - age_ns : now_ns;
+
+    for (size_t i = 0; i < sizeof(key_bindings) / sizeof(key_bindings[0]); i++)
+    {
+        if (key_bindings[i].scancode == event->key.keysym.scancode)
+        {
+            InputEvent input_event = {
+                .timestamp_ns = timestamp_ns,
+                .player = key_bindings[i].player,
+                .button = key_bindings[i].button,
+                .pressed = event->type == SDL_KEYDOWN
+            };
+            input_ring_push(ring, input_event);
+        }
     }
+    return 0;
 }
@@ -1,11 +1,10 @@
 #ifndef KEYBOARD_H
 #define KEYBOARD_H
 
-#include <stdint.h>
+typedef struct InputRing InputRing;
 
-typedef struct PlayerInput PlayerInput;
-
-extern void set_player1_keyboard_input( PlayerInput * player, const uint8_t * keyboard_state );
-extern void set_player2_keyboard_input( PlayerInput * player, const uint8_t * keyboard_state );
+// Pushes a timestamped InputEvent into ring for every bound key press/release SDL sees
+extern void keyboard_start_events( InputRing *ring );
+extern void keyboard_stop_events( void );
 
 #endif
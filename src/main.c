@@ -1,111 +1,394 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <SDL2/SDL.h>
 #include "player.h"
 #include "input.h"
 #include "renderer.h"
-#include "combat.h"
+#include "match.h"
 #include "game_types.h"
 #include "timer.h"
+#include "clock.h"
+#include "clock_sdl.h"
 #include "keyboard.h"
+#include "input_events.h"
+#include "input_sampler.h"
+#include "trace.h"
+#include "sim_thread.h"
+#include "snapshot.h"
+#include "replay.h"
+#include "netplay.h"
+#include "aabb.h"
+#include "roster.h"
+#include "file_watch.h"
+#include "arena.h"
+#include "alloc_guard.h"
+#include "fighter_store.h"
 
 #define SCREEN_FPS 60
 #define SCREEN_TICKS_PER_FRAME (1000.0 / SCREEN_FPS)  //1 second
 
-#define DEATH_TIME 5.0
+// If a frame takes longer than this (e.g. window dragged, Pi hitches) we drop the extra time
+// rather than trying to catch up with hundreds of ticks
+#define MAX_FRAME_TIME 0.25
+
+// Trace is written here at exit or when F9 is pressed (only when built with make TRACE=1)
+#define TRACE_PATH "trace"
 
 bool using_keyboard = true;
 
-int main( void ) {
-    renderer_init();
+static void close_setup( Replay recording, Replay replay, FileWatch roster_watch );
+
+/*
+ * Usage: ./main [--threaded] [--software] [--fighters p1 p2] [--hot-reload] [--record file] [--replay file [--fast]]
+ *               [--netplay <1|2> <local port> <remote host> <remote port> [--input-delay ticks]]
+ * --threaded runs the simulation on its own thread so slow presents can't delay ticks - not with replays,
+ *            netplay or hot reload, which need the ticks on the main thread
+ * --software draws on the CPU across every core instead of the GPU (also on with LIBGL_ALWAYS_SOFTWARE)
+ * --fighters picks each player's fighter by name from the roster (default the first one for both) -
+ *            netplay opponents have to use the same ones, and a replay brings its own
+ * --hot-reload watches the roster and swaps rebuilt fighters in between ticks (edit assets/fighters/
+ *              then make roster) - a roster that fails validation is ignored and the old one kept
+ * --record writes every tick's inputs to a replay file (see replay.h)
+ * --replay plays a replay file back instead of reading the controls and quits at the first
+ *          tick that doesn't match the recording - --fast runs it as fast as possible
+ * --netplay plays the given fighter against another cabinet over UDP with rollback (see netplay.h),
+ *          --input-delay holds local inputs back a few ticks to make rollbacks rarer (default 2)
+*/
+int main( int argc, char **argv ) {
+    bool threaded = false;
+    bool software = false;
+    bool fast_replay = false;
+    char const *record_path = NULL;
+    char const *replay_path = NULL;
+    bool use_netplay = false;
+    NetplayConfig netplay_config = { .input_delay = 2 };
+    char const *fighter_names[2] = { NULL, NULL };
+    bool hot_reload = false;
+    for( int i = 1; i < argc; i++ ) {
+        if( strcmp(argv[i], "--threaded") == 0 ) {
+            threaded = true;
+        } else if( strcmp(argv[i], "--software") == 0 ) {
+            software = true;
+        } else if( strcmp(argv[i], "--fighters") == 0 && i + 2 < argc ) {
+            fighter_names[0] = argv[++i];
+            fighter_names[1] = argv[++i];
+        } else if( strcmp(argv[i], "--hot-reload") == 0 ) {
+            hot_reload = true;
+        } else if( strcmp(argv[i], "--record") == 0 && i + 1 < argc ) {
+            record_path = argv[++i];
+        } else if( strcmp(argv[i], "--replay") == 0 && i + 1 < argc ) {
+            replay_path = argv[++i];
+        } else if( strcmp(argv[i], "--fast") == 0 ) {
+            fast_replay = true;
+        } else if( strcmp(argv[i], "--netplay") == 0 && i + 4 < argc ) {
+            use_netplay = true;
+            netplay_config.local_player = (atoi(argv[i + 1]) == 2) ? PLAYER_2 : PLAYER_1;
+            netplay_config.local_port = (uint16_t) atoi(argv[i + 2]);
+            netplay_config.remote_host = argv[i + 3];
+            netplay_config.remote_port = (uint16_t) atoi(argv[i + 4]);
+            i += 4;
+        } else if( strcmp(argv[i], "--input-delay") == 0 && i + 1 < argc ) {
+            netplay_config.input_delay = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--threaded] [--software] [--fighters p1 p2] [--hot-reload] [--record file] [--replay file [--fast]] "
+                "[--netplay <1|2> <local port> <remote host> <remote port> [--input-delay ticks]]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Recording, playback, rollback and reloads all happen between ticks on this thread
+    if( threaded && (record_path || replay_path || use_netplay || hot_reload) ) {
+        fprintf(stderr, "--threaded can't be used with --record, --replay, --netplay or --hot-reload\n");
+        return EXIT_FAILURE;
+    }
+    // A reload changes how the same inputs play out, so nothing else could reproduce the match
+    if( hot_reload && (use_netplay || record_path || replay_path) ) {
+        fprintf(stderr, "--hot-reload can't be used with --netplay, --record or --replay\n");
+        return EXIT_FAILURE;
+    }
+    if( replay_path && fighter_names[0] ) {
+        fprintf(stderr, "--fighters can't be used with --replay - the replay says who played\n");
+        return EXIT_FAILURE;
+    }
+    // Netplay ticks are predictions until confirmed so there is nothing sensible to record yet
+    if( use_netplay && (record_path || replay_path) ) {
+        fprintf(stderr, "--netplay can't be used with --record or --replay\n");
+        return EXIT_FAILURE;
+    }
+    if( netplay_config.input_delay < 0 || netplay_config.input_delay > NETPLAY_MAX_INPUT_DELAY ) {
+        fprintf(stderr, "--input-delay must be 0 to %d ticks\n", NETPLAY_MAX_INPUT_DELAY);
+        return EXIT_FAILURE;
+    }
+
+    // Opened, watched and reloaded at the same path, wherever the game was started from
+    char const *roster_file = roster_path(ROSTER_PATH);
+    if( !roster_open(roster_file) ) {
+        return EXIT_FAILURE;
+    }
+    int characters[2] = { 0, 0 };
+    for( int i = 0; i < 2; i++ ) {
+        if( fighter_names[i] && (characters[i] = roster_find(fighter_names[i])) < 0 ) {
+            fprintf(stderr, "No fighter called %s in %s\n", fighter_names[i], roster_file);
+            roster_close();
+            return EXIT_FAILURE;
+        }
+    }
+
+    FileWatch roster_watch = NULL;
+    if( hot_reload && !(roster_watch = file_watch_start(roster_file)) ) {
+        roster_close();
+        return EXIT_FAILURE;
+    }
+
+    Replay recording = NULL;
+    Replay replay = NULL;
+    if( replay_path && !(replay = replay_open_read(replay_path)) ) {
+        file_watch_stop(roster_watch);
+        roster_close();
+        return EXIT_FAILURE;
+    }
+    if( replay ) {
+        characters[PLAYER_1] = replay_character(replay, PLAYER_1);
+        characters[PLAYER_2] = replay_character(replay, PLAYER_2);
+    }
+    if( record_path && !(recording = replay_open_write(record_path, REPLAY_DEFAULT_HASH_INTERVAL, characters[0], characters[1])) ) {
+        replay_close(replay);
+        file_watch_stop(roster_watch);
+        roster_close();
+        return EXIT_FAILURE;
+    }
+    bool fast_forward = replay && fast_replay;
+    int exit_code = 0;
+
+    renderer_init(software);
+    clock_use_sdl();
+    TRACE_THREAD("render");
+
+    // Boot screen while the assets stream in - the match starts as soon as the fighters can be drawn
+    // and the rest (background frames) keeps arriving during it
+    while( !renderer_fighters_loaded() ) {
+        if( SDL_event_handler() ) {
+            close_setup(recording, replay, roster_watch);
+            return EXIT_SUCCESS;
+        }
+        renderer_begin_frame();
+        renderer_draw_loading(renderer_load_assets());
+        renderer_end_frame();
+        SDL_Delay((uint32_t) SCREEN_TICKS_PER_FRAME);
+    }
+    // Combat's batched box tests use the widest SIMD the CPU has
+    aabb_use_cpu_features((AabbCpuFeatures) { .sse2 = SDL_HasSSE2(), .avx2 = SDL_HasAVX2(), .neon = SDL_HasNEON() });
     
-    // Using calloc in case forget to initialise everything
-    PlayerState player1 = calloc(1, sizeof(struct PlayerState));
-    assert(player1 != NULL);
-    PlayerState player2 = calloc(1, sizeof(struct PlayerState));
-    assert(player2 != NULL);
-    //TODO() hassam: should set up our PlayerState structs correctly
-    // Right now using playerstate not as a pointer to struct but just struct
-    player_init(player1, PLAYER_1); player_init(player2, PLAYER_2);
+    // The match and everything in it comes zeroed out of one arena allocated up front
+    Arena match_arena;
+    if( !arena_init(&match_arena, MATCH_ARENA_SIZE) ) {
+        close_setup(recording, replay, roster_watch);
+        return EXIT_FAILURE;
+    }
+    Match match = arena_alloc(&match_arena, sizeof(struct Match));
+    match_init(match, characters[0], characters[1]);
+    PlayerState player1 = &match->player1;
+    PlayerState player2 = &match->player2;
     
+    Netplay netplay = NULL;
+    if( use_netplay && !(netplay = netplay_start(match, &netplay_config)) ) {
+        arena_free(&match_arena);
+        close_setup(recording, replay, roster_watch);
+        return EXIT_FAILURE;
+    }
+
     // Set Player default height and width internally in renderer so sprites draw correctly
-    renderer_set_player_size(player1->hurtbox.height, player1->hurtbox.width);
+    renderer_set_player_size(FIGHTER_HURTBOX(player1).height, FIGHTER_HURTBOX(player1).width);
 
     PlayerInput p1_input, p2_input;
+
+    // Presses/releases are queued with timestamps as they happen and drained tick by tick
+    static InputEvents input_events;
+    input_events_init(&input_events);
+    InputSampler input_sampler = NULL;
+    if (using_keyboard) {
+        keyboard_start_events(&input_events.keyboard);
+    } else {
+        input_sampler = input_sampler_start(&input_events.hardware);
+    }
     
     // Getting FPS - measure how long the frame takes to run 
-    double fps;
-    fps=0;
-    fps=fps; // unused variable  warning remove TODO
+    double fps = 0;
 
-    Timer fps_timer = timer_create();
+    Timer fps_timer = TIMER_INIT;
     int counted_frames = 0;
-    timer_start(fps_timer);
+    timer_start(&fps_timer);
     
     // Used for capping FPS
-    Timer cap_timer = timer_create();
+    Timer cap_timer = TIMER_INIT;
 
     // Measuring dt
     double dt; // Measured in second
-    uint64_t current_frame_counter;
-    uint64_t prev_frame_counter = SDL_GetPerformanceCounter();
-    uint64_t ticks_per_second = SDL_GetPerformanceFrequency();
+    uint64_t current_frame_ns;
+    uint64_t prev_frame_ns = clock_now_ns();
+
+    // Fixed timestep - real time is banked here and spent in SIM_DT sized ticks
+    double accumulator = 0.0;
+
+    // In threaded mode the sim thread owns the match and we draw copies of its snapshots instead -
+    // with a store of their own, as the snapshots' slots belong to the sim thread
+    FighterStore draw_fighters;
+    _Alignas(double) unsigned char draw_fighter_memory[FIGHTER_STORE_SIZE(2)];
+    struct PlayerState draw_player1, draw_player2;
+    fighter_store_init(&draw_fighters, draw_fighter_memory, 2);
+    fighter_store_bind(&draw_fighters, 0, &draw_player1);
+    fighter_store_bind(&draw_fighters, 1, &draw_player2);
+    player_copy(&draw_player1, player1);
+    player_copy(&draw_player2, player2);
+    SimThread sim = threaded ? sim_thread_start(match, &input_events) : NULL;
     
-    Timer death_timer = timer_create();
-    bool player_died = false;
     bool quit = false;
+    bool dump_key_was_down = false;
+
+    // F5 saves the match and F8 puts it back - only in a plain local match, a restore would desync the
+    // other side in netplay, break a replay's verification and leave a gap in a recording
+    bool quick_save_enabled = !threaded && !netplay && !replay && !recording;
+    GameSnapshot quick_save;
+    bool have_quick_save = false;
+    bool save_key_was_down = false, load_key_was_down = false;
+
+    // Everything is set up - from here until the window closes nothing of ours should allocate (make ALLOC_GUARD=1)
+    ALLOC_GUARD_BEGIN("the match");
     
     // window open
     while( !quit ) {
         /* ------- GAME LOOP SETUP -------*/
 
         //Start/restart Cap timer - to see how long frame takes to run
-        timer_start(cap_timer);
+        timer_start(&cap_timer);
 
         //TODO() lawrence: Event handler function is here
-        quit = SDL_event_handler();
+        TRACE_ZONE(TRACE_INPUT) {
+            quit = SDL_event_handler();
+        }
+
+        bool dump_key_down = SDL_GetKeyboardState(NULL)[SDL_SCANCODE_F9];
+        if( dump_key_down && !dump_key_was_down ) {
+            TRACE_DUMP(TRACE_PATH);
+        }
+        dump_key_was_down = dump_key_down;
+
+        const uint8_t *keys = SDL_GetKeyboardState(NULL);
+        if( quick_save_enabled && keys[SDL_SCANCODE_F5] && !save_key_was_down ) {
+            game_snapshot_save(&quick_save, match, renderer_get_background_state());
+            have_quick_save = true;
+            printf("Saved match at tick %llu (hash %016llx)\n", (unsigned long long) match->tick,
+                (unsigned long long) game_snapshot_hash(&quick_save));
+        }
+        if( quick_save_enabled && keys[SDL_SCANCODE_F8] && !load_key_was_down && have_quick_save ) {
+            double background_state;
+            if( game_snapshot_restore(&quick_save, match, &background_state) ) {
+                renderer_set_background_state(background_state);
+            }
+        }
+        save_key_was_down = keys[SDL_SCANCODE_F5];
+        load_key_was_down = keys[SDL_SCANCODE_F8];
+
+        // Before this frame's ticks so every tick runs start to finish with one set of fighters
+        if( roster_watch && file_watch_changed(roster_watch) ) {
+            if( roster_reload(roster_file) ) {
+                player1->def = roster_fighter(player1->character);
+                player2->def = roster_fighter(player2->character);
+                printf("Reloaded %s\n", roster_file);
+            } else {
+                printf("Keeping the previous fighters\n");
+            }
+        }
         
         // Calculating Delta Time
-        current_frame_counter = SDL_GetPerformanceCounter();
-        dt = (double) (current_frame_counter - prev_frame_counter) / (double) ticks_per_second;
-        prev_frame_counter = current_frame_counter;
+        current_frame_ns = clock_now_ns();
+        dt = (double) (current_frame_ns - prev_frame_ns) / (double) NS_PER_SECOND;
+        prev_frame_ns = current_frame_ns;
+        if( dt > MAX_FRAME_TIME ) {
+            dt = MAX_FRAME_TIME;
+        }
+        if( !threaded ) {
+            accumulator += dt;
+        }
         
         // Calculating - the FPS according to our fps timer
-        double seconds_passed = timer_get_seconds(fps_timer);
+        double seconds_passed = timer_get_seconds(&fps_timer);
         
         // First frame can sometimes have a very high fps do need to correct it
         fps = (seconds_passed < 0.15) ? 1 : (double) counted_frames / seconds_passed;
-        
-        //printf("fps = %lf   deltatime = %lf\n", fps, dt);
+        TRACE_COUNTER(TRACE_FPS, fps);
 
 
         /* ------- GAME LOOP UPDATES ------- */
 
-        // input_get returns a PlayerInput struct for the corresponding player
-        if (!using_keyboard) {
-            p1_input = input_get(player1->id);
-            p2_input = input_get(player2->id);
+        double alpha;
+        bool match_over;
+        if( threaded ) {
+            SimSnapshot const *snapshot = sim_thread_latest(sim);
+
+            // Animation time belongs to the renderer so keep ours rather than the snapshot's
+            double p1_anim = draw_player1.time_in_anim, p2_anim = draw_player2.time_in_anim;
+            player_copy(&draw_player1, &snapshot->player1);
+            player_copy(&draw_player2, &snapshot->player2);
+            draw_player1.time_in_anim = p1_anim;
+            draw_player2.time_in_anim = p2_anim;
+
+            alpha = sim_thread_alpha(snapshot, clock_now_ns());
+            match_over = snapshot->is_over;
         } else {
-            p1_input = (PlayerInput) {0.0, JOYSTICK_MID, false, false};
-            p2_input = (PlayerInput) {0.0, JOYSTICK_MID, false, false};
-            const uint8_t *keyboard_input = SDL_GetKeyboardState(NULL);
+            // Run as many fixed ticks as the elapsed time allows - each gets the input edges that happened before it ended
+            // When fast forwarding a replay we instead tick until this frame's time is used up
+            // A netplay match can look over only because of a prediction, so it keeps ticking until that's confirmed
+            while( (!match->is_over || netplay) && !quit ) {
+                if( fast_forward ? timer_get_seconds(&cap_timer) * 1000 >= SCREEN_TICKS_PER_FRAME : accumulator < SIM_DT ) {
+                    break;
+                }
 
-            set_player1_keyboard_input(&p1_input, keyboard_input);
-            set_player2_keyboard_input(&p2_input, keyboard_input);
-        }
-        
-        player_update(player1, p1_input, dt);
-        player_update(player2, p2_input, dt);
+                if( replay ) {
+                    if( !replay_next_tick(replay, &p1_input, &p2_input) ) {
+                        printf("Replay finished at tick %llu\n", (unsigned long long) match->tick);
+                        quit = true;
+                        break;
+                    }
+                } else {
+                    uint64_t tick_end_ns = current_frame_ns - (uint64_t) ((accumulator - SIM_DT) * NS_PER_SECOND);
+                    TRACE_ZONE(TRACE_INPUT) {
+                        input_events_next_tick(&input_events, tick_end_ns, &p1_input, &p2_input, NULL);
+                    }
+                }
 
-        combat_update(player1, player2);
+                if( netplay ) {
+                    // A stall skips the tick - we are too far ahead and the other cabinet needs to catch up
+                    NetplayStatus status = netplay_advance(netplay, (netplay_config.local_player == PLAYER_1) ? p1_input : p2_input);
+                    if( status == NETPLAY_DESYNC ) {
+                        quit = true;
+                        exit_code = EXIT_FAILURE;
+                        break;
+                    }
+                } else {
+                    match_step(match, p1_input, p2_input);
+                }
 
-        if( !player_died && (player1->is_dead || player2->is_dead) )
-        {
-            timer_start(death_timer);
-            player_died = true;
+                if( recording ) {
+                    replay_record_tick(recording, p1_input, p2_input, match);
+                }
+                if( replay && replay_check_tick(replay, match) != REPLAY_OK ) {
+                    quit = true;
+                    exit_code = EXIT_FAILURE;
+                    break;
+                }
+                if( !fast_forward ) {
+                    accumulator -= SIM_DT;
+                }
+            }
+            // How far we are into the next tick - used to interpolate between the last two states
+            alpha = fast_forward ? 1.0 : accumulator / SIM_DT;
+            match_over = match->is_over && (!netplay || netplay_stats(netplay).confirmed_ticks >= match->tick);
         }
-        if( timer_get_seconds(death_timer) >= DEATH_TIME )
+        if( match_over )
         {
             quit = true;
             printf("game over");
@@ -116,11 +399,20 @@ int main( void ) {
 
         //TODO() lawrence: should also draw/render background
         // You wil probably have some internal frame for the background (if animated)
+        renderer_load_assets();
         renderer_begin_frame(); 
-        renderer_draw_background(dt);
-        renderer_draw_player(player1, dt);
-        renderer_draw_player(player2, dt);
-        renderer_end_frame();
+        TRACE_ZONE(TRACE_DRAW_BACKGROUND) {
+            renderer_draw_background(dt);
+        }
+        TRACE_ZONE(TRACE_DRAW_PLAYER) {
+            renderer_draw_player(threaded ? &draw_player1 : player1, alpha, dt);
+        }
+        TRACE_ZONE(TRACE_DRAW_PLAYER) {
+            renderer_draw_player(threaded ? &draw_player2 : player2, alpha, dt);
+        }
+        TRACE_ZONE(TRACE_END_FRAME) {
+            renderer_end_frame();
+        }
 
 
         /* ------- GAME LOOP Frame Capping ------- */
@@ -128,21 +420,44 @@ int main( void ) {
         counted_frames++;
 
         // Now we find how long our frame took - if too short then add a delay
-        double frame_ticks = timer_get_seconds(cap_timer) * 1000;
-        if( frame_ticks < SCREEN_TICKS_PER_FRAME ) {
+        double frame_ticks = timer_get_seconds(&cap_timer) * 1000;
+        if( frame_ticks < SCREEN_TICKS_PER_FRAME && !fast_forward ) {
             // SDL_Delay only takes in a uint32_t
-            SDL_Delay((uint32_t) (SCREEN_TICKS_PER_FRAME - frame_ticks));
+            TRACE_ZONE(TRACE_CAP_SLEEP) {
+                SDL_Delay((uint32_t) (SCREEN_TICKS_PER_FRAME - frame_ticks));
+            }
         }
     }
+    ALLOC_GUARD_END();
+
+    if( threaded ) {
+        sim_thread_stop(sim);
+    }
+    if( input_sampler ) {
+        input_sampler_stop(input_sampler);
+    }
+    keyboard_stop_events();
+    replay_close(recording);
+    replay_close(replay);
+    netplay_stop(netplay);
+    file_watch_stop(roster_watch);
+
+    TRACE_DUMP(TRACE_PATH);
 
     // Close/free anything here
-    free(player1);
-    free(player2);
-    timer_free(fps_timer);
-    timer_free(cap_timer);
-    timer_free(death_timer);
+    arena_free(&match_arena);
     renderer_clean();
+    roster_close();
 
-    return 0;
+    return exit_code;
     
 }
+
+// Everything opened before the match, for leaving before it starts
+static void close_setup( Replay recording, Replay replay, FileWatch roster_watch ) {
+    replay_close(recording);
+    replay_close(replay);
+    file_watch_stop(roster_watch);
+    renderer_clean();
+    roster_close();
+}
@@ -0,0 +1,70 @@
+#include <stdbool.h>
+#include "match.h"
+#include "player.h"
+#include "combat.h"
+#include "input.h"
+#include "trace.h"
+#include "game_types.h"
+#include "fighter_store.h"
+
+#define DEATH_TIME 5.0
+
+// Characters are roster indices (roster.h)
+void match_init( Match match, int p1_character, int p2_character )
+{
+    fighter_store_init(&match->fighters, match->fighter_memory, 2);
+    fighter_store_bind(&match->fighters, 0, &match->player1);
+    fighter_store_bind(&match->fighters, 1, &match->player2);
+    player_init(&match->player1, PLAYER_1, p1_character);
+    player_init(&match->player2, PLAYER_2, p2_character);
+    projectile_pool_clear(&match->projectiles);
+    // So not even the first hit of the match has to grow combat's lists
+    combat_reserve(2);
+
+    match->tick = 0;
+    match->death_time = 0.0;
+    match->player_died = false;
+    match->is_over = false;
+}
+
+// Advances the match by exactly one SIM_DT tick
+void match_step( Match match, PlayerInput p1_input, PlayerInput p2_input )
+{
+    PlayerState player1 = &match->player1;
+    PlayerState player2 = &match->player2;
+
+    PlayerInput inputs[] = { p1_input, p2_input };
+    match_step_fighters(&match->fighters, inputs, &match->projectiles);
+
+    if( !match->player_died && (player_is_dead(player1) || player_is_dead(player2)) )
+    {
+        match->player_died = true;
+    }
+    if( match->player_died )
+    {
+        match->death_time += SIM_DT;
+    }
+    if( match->death_time >= DEATH_TIME )
+    {
+        match->is_over = true;
+    }
+
+    match->tick++;
+}
+
+// Moves every fighter in the store and every thrown sword one tick then resolves the hits between all
+// of them - no match rules (death timer etc). inputs and projectile owners are store slots.
+void match_step_fighters( FighterStore *fighters, PlayerInput const *inputs, ProjectilePool *projectiles )
+{
+    TRACE_ZONE(TRACE_PLAYER_UPDATE) {
+        player_update_batch(fighters, inputs, SIM_DT);
+    }
+
+    projectile_pool_update(projectiles, fighters, SIM_DT);
+
+    TRACE_ZONE(TRACE_COMBAT_UPDATE) {
+        combat_update(fighters, projectiles);
+    }
+
+    projectile_pool_pick_up(projectiles, fighters);
+}
@@ -0,0 +1,35 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "game_types.h"
+#include "projectile.h"
+#include "fighter_store.h"
+
+// Room for a Match and whatever a front end keeps alongside it in its match arena (arena.h)
+#define MATCH_ARENA_SIZE (64 * 1024)
+
+typedef struct PlayerInput PlayerInput;
+
+/*
+ * Everything the simulation needs to step a single match - no SDL in here. The fighters store points
+ * into the match itself, so a Match must stay where match_init put it (never copy one with =).
+*/
+typedef struct Match {
+    struct PlayerState player1;     // Slot 0 of fighters
+    struct PlayerState player2;     // Slot 1
+    FighterStore fighters;
+    _Alignas(double) unsigned char fighter_memory[FIGHTER_STORE_SIZE(2)];
+    ProjectilePool projectiles;     // Thrown swords - owner 0 is player 1, 1 is player 2
+    uint64_t tick;        // Number of SIM_DT ticks simulated so far
+    double death_time;    // Simulation time since a player died
+    bool player_died;
+    bool is_over;
+} *Match;
+
+extern void match_init( Match match, int p1_character, int p2_character );
+extern void match_step( Match match, PlayerInput p1_input, PlayerInput p2_input );
+extern void match_step_fighters( FighterStore *fighters, PlayerInput const *inputs, ProjectilePool *projectiles );
+
+#endif
@@ -0,0 +1,425 @@
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "netplay.h"
+#include "input.h"
+#include "match.h"
+#include "snapshot.h"
+#include "game_types.h"
+
+#define NETPLAY_MAGIC 0x5054454eu    // "NETP"
+
+// Inputs kept per side - must cover everything the peer might still not have (see send_packet)
+#define INPUT_RING 64
+#define STATE_RING NETPLAY_MAX_ROLLBACK
+#define HASH_RING 8
+
+#define PACKED_INPUT_SIZE (sizeof(double) + sizeof(uint8_t))
+#define PACKET_HEADER_SIZE (sizeof(uint32_t) + 5 * sizeof(uint64_t) + sizeof(uint8_t))
+#define MAX_PACKET_SIZE (PACKET_HEADER_SIZE + INPUT_RING * PACKED_INPUT_SIZE)
+
+// Sent a few times on stop so the peer gets our last inputs even if one is lost
+#define GOODBYE_PACKETS 5
+
+#define NO_ROLLBACK UINT64_MAX
+
+#define PACK(cursor, value) (memcpy((cursor), &(value), sizeof(value)), (cursor) += sizeof(value))
+#define UNPACK(cursor, value) (memcpy(&(value), (cursor), sizeof(value)), (cursor) += sizeof(value))
+
+typedef struct {
+    uint64_t tick;      // Ticks simulated when hashed, 0 for an empty slot
+    uint64_t hash;
+} TickHash;
+
+struct Netplay {
+    Match match;
+    PlayerId local_player;
+    int socket;
+    struct sockaddr_in remote;
+
+    // Local inputs for ticks before local_input_end - the first input_delay of them are neutral
+    PlayerInput local_inputs[INPUT_RING];
+    uint64_t local_input_end;
+    uint64_t remote_ack;            // The peer has our inputs for every tick before this
+
+    // Confirmed remote inputs for ticks before remote_input_end
+    PlayerInput remote_inputs[INPUT_RING];
+    uint64_t remote_input_end;
+    PlayerInput used_remote[INPUT_RING];    // Remote input each simulated tick actually used
+    uint64_t rollback_from;                 // First tick simulated with a wrong prediction
+
+    GameSnapshot states[STATE_RING];        // Match as it was before each of the last ticks
+    uint64_t next_hash_tick;
+    TickHash local_hashes[HASH_RING];
+    TickHash remote_hashes[HASH_RING];
+    TickHash last_local_hash;               // Sent with every packet until a newer one replaces it
+    uint64_t last_checked_tick;
+    bool desynced;
+
+    NetplayStats stats;
+};
+
+static void simulate_tick( Netplay netplay );
+static void rollback( Netplay netplay );
+static void receive_packets( Netplay netplay );
+static void send_packet( Netplay netplay );
+static void record_hashes( Netplay netplay );
+static void check_hash( Netplay netplay, uint64_t tick );
+static PlayerInput remote_input_for( Netplay netplay, uint64_t tick );
+static bool input_equal( PlayerInput a, PlayerInput b );
+static PlayerInput neutral_input( void );
+
+//NOTE: must be stopped with netplay_stop - returns NULL if the socket can't be set up
+Netplay netplay_start( Match match, NetplayConfig const *config )
+{
+    assert(config->input_delay >= 0 && config->input_delay <= NETPLAY_MAX_INPUT_DELAY);
+
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_DGRAM };
+    struct addrinfo *address;
+    char port[8];
+    snprintf(port, sizeof(port), "%u", config->remote_port);
+    if (getaddrinfo(config->remote_host, port, &hints, &address) != 0)
+    {
+        fprintf(stderr, "Could not resolve %s\n", config->remote_host);
+        return NULL;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in local = { .sin_family = AF_INET, .sin_port = htons(config->local_port), .sin_addr.s_addr = htonl(INADDR_ANY) };
+    if (sock < 0 || bind(sock, (struct sockaddr *) &local, sizeof(local)) != 0 || fcntl(sock, F_SETFL, O_NONBLOCK) != 0)
+    {
+        fprintf(stderr, "Could not open UDP port %u: %s\n", config->local_port, strerror(errno));
+        if (sock >= 0)
+        {
+            close(sock);
+        }
+        freeaddrinfo(address);
+        return NULL;
+    }
+
+    Netplay netplay = calloc(1, sizeof(struct Netplay));
+    assert(netplay != NULL);
+    netplay->match = match;
+    netplay->local_player = config->local_player;
+    netplay->socket = sock;
+    memcpy(&netplay->remote, address->ai_addr, sizeof(netplay->remote));
+    freeaddrinfo(address);
+
+    // The delay is just the first few ticks having no input from us
+    for (int i = 0; i < config->input_delay; i++)
+    {
+        netplay->local_inputs[i] = neutral_input();
+    }
+    netplay->local_input_end = config->input_delay;
+    netplay->rollback_from = NO_ROLLBACK;
+    netplay->next_hash_tick = match->tick + NETPLAY_HASH_INTERVAL;
+    return netplay;
+}
+
+/*
+ * Call once per tick in place of match_step with this cabinet's input.
+ * On NETPLAY_STALLED nothing was simulated and the input was dropped - the caller just carries on.
+*/
+NetplayStatus netplay_advance( Netplay netplay, PlayerInput local_input )
+{
+    receive_packets(netplay);
+    rollback(netplay);
+    if (netplay->desynced)
+    {
+        return NETPLAY_DESYNC;
+    }
+
+    // Every predicted tick needs a saved state to roll back to, so we can't get further ahead than that
+    if (netplay->match->tick >= netplay->remote_input_end + NETPLAY_MAX_ROLLBACK)
+    {
+        netplay->stats.stalls++;
+        send_packet(netplay);
+        return NETPLAY_STALLED;
+    }
+
+    netplay->local_inputs[netplay->local_input_end % INPUT_RING] = local_input;
+    netplay->local_input_end++;
+
+    simulate_tick(netplay);
+    record_hashes(netplay);
+    send_packet(netplay);
+
+    return netplay->desynced ? NETPLAY_DESYNC : NETPLAY_OK;
+}
+
+// Takes in remote inputs (rolling back if needed) and keeps our acks flowing without ticking
+NetplayStatus netplay_poll( Netplay netplay )
+{
+    receive_packets(netplay);
+    rollback(netplay);
+    record_hashes(netplay);
+    send_packet(netplay);
+    return netplay->desynced ? NETPLAY_DESYNC : NETPLAY_OK;
+}
+
+NetplayStats netplay_stats( Netplay netplay )
+{
+    NetplayStats stats = netplay->stats;
+    stats.confirmed_ticks = netplay->remote_input_end;
+    return stats;
+}
+
+void netplay_stop( Netplay netplay )
+{
+    if (netplay)
+    {
+        for (int i = 0; i < GOODBYE_PACKETS; i++)
+        {
+            send_packet(netplay);
+        }
+        close(netplay->socket);
+        free(netplay);
+    }
+}
+
+// Saves the state then steps the match's next tick with whatever remote input we have or predict
+static void simulate_tick( Netplay netplay )
+{
+    Match match = netplay->match;
+    uint64_t tick = match->tick;
+    assert(tick < netplay->local_input_end);
+
+    game_snapshot_save(&netplay->states[tick % STATE_RING], match, 0.0);
+
+    PlayerInput local = netplay->local_inputs[tick % INPUT_RING];
+    PlayerInput remote = remote_input_for(netplay, tick);
+    netplay->used_remote[tick % INPUT_RING] = remote;
+
+    if (netplay->local_player == PLAYER_1)
+    {
+        match_step(match, local, remote);
+    }
+    else
+    {
+        match_step(match, remote, local);
+    }
+}
+
+// Goes back to the first mispredicted tick and simulates forward again with the inputs we know now
+static void rollback( Netplay netplay )
+{
+    if (netplay->rollback_from == NO_ROLLBACK)
+    {
+        return;
+    }
+
+    Match match = netplay->match;
+    uint64_t target = match->tick;
+    assert(target - netplay->rollback_from <= STATE_RING);
+
+    // Animation time is the renderer's - rolling it back would make sprites stutter
+    double p1_anim = match->player1.time_in_anim, p2_anim = match->player2.time_in_anim;
+
+    double background_state;
+    bool restored = game_snapshot_restore(&netplay->states[netplay->rollback_from % STATE_RING], match, &background_state);
+    assert(restored && match->tick == netplay->rollback_from);
+    (void) restored;
+
+    while (match->tick < target)
+    {
+        simulate_tick(netplay);
+    }
+    match->player1.time_in_anim = p1_anim;
+    match->player2.time_in_anim = p2_anim;
+
+    netplay->stats.rollbacks++;
+    netplay->stats.resimulated_ticks += target - netplay->rollback_from;
+    netplay->rollback_from = NO_ROLLBACK;
+}
+
+static void receive_packets( Netplay netplay )
+{
+    unsigned char packet[MAX_PACKET_SIZE];
+    struct sockaddr_in from;
+    socklen_t from_size = sizeof(from);
+    ssize_t size;
+
+    while ((size = recvfrom(netplay->socket, packet, sizeof(packet), 0, (struct sockaddr *) &from, &from_size)) > 0)
+    {
+        from_size = sizeof(from);
+        if (from.sin_addr.s_addr != netplay->remote.sin_addr.s_addr || from.sin_port != netplay->remote.sin_port
+            || (size_t) size < PACKET_HEADER_SIZE)
+        {
+            continue;
+        }
+
+        unsigned char const *cursor = packet;
+        uint32_t magic;
+        uint64_t peer_tick, ack, input_start, hash_tick, hash;
+        uint8_t input_count;
+        UNPACK(cursor, magic);
+        UNPACK(cursor, peer_tick);
+        UNPACK(cursor, ack);
+        UNPACK(cursor, hash_tick);
+        UNPACK(cursor, hash);
+        UNPACK(cursor, input_start);
+        UNPACK(cursor, input_count);
+        if (magic != NETPLAY_MAGIC || (size_t) size != PACKET_HEADER_SIZE + input_count * PACKED_INPUT_SIZE)
+        {
+            continue;
+        }
+        netplay->stats.packets_received++;
+
+        if (peer_tick > netplay->stats.peer_tick)
+        {
+            netplay->stats.peer_tick = peer_tick;
+        }
+        if (ack > netplay->remote_ack)
+        {
+            netplay->remote_ack = ack;
+        }
+
+        for (uint64_t tick = input_start; tick < input_start + input_count; tick++)
+        {
+            PlayerInput input;
+            uint8_t buttons;
+            UNPACK(cursor, input.move_x);
+            UNPACK(cursor, buttons);
+            input_unpack_buttons(&input, buttons);
+
+            // Only take them in order - anything after a gap comes again in a later packet
+            if (tick != netplay->remote_input_end)
+            {
+                continue;
+            }
+            netplay->remote_inputs[tick % INPUT_RING] = input;
+            netplay->remote_input_end++;
+
+            bool already_simulated = tick < netplay->match->tick;
+            if (already_simulated && !input_equal(input, netplay->used_remote[tick % INPUT_RING]) && tick < netplay->rollback_from)
+            {
+                netplay->rollback_from = tick;
+            }
+        }
+
+        if (hash_tick > netplay->last_checked_tick)
+        {
+            TickHash *slot = &netplay->remote_hashes[(hash_tick / NETPLAY_HASH_INTERVAL) % HASH_RING];
+            slot->tick = hash_tick;
+            slot->hash = hash;
+            check_hash(netplay, hash_tick);
+        }
+    }
+}
+
+/*
+ * Packet: magic, our tick, ack (remote inputs we have), latest confirmed hash tick + hash, first input
+ * tick, input count, then each input as move_x + packed buttons.
+ * We resend everything the peer hasn't acked - it can never be more than INPUT_RING behind as
+ * both sides stall after NETPLAY_MAX_ROLLBACK predicted ticks.
+*/
+static void send_packet( Netplay netplay )
+{
+    uint64_t start = netplay->remote_ack;
+    if (netplay->local_input_end - start > INPUT_RING)
+    {
+        start = netplay->local_input_end - INPUT_RING;
+    }
+    uint8_t input_count = (uint8_t) (netplay->local_input_end - start);
+
+    unsigned char packet[MAX_PACKET_SIZE];
+    unsigned char *cursor = packet;
+    uint32_t magic = NETPLAY_MAGIC;
+    PACK(cursor, magic);
+    PACK(cursor, netplay->match->tick);
+    PACK(cursor, netplay->remote_input_end);
+    PACK(cursor, netplay->last_local_hash.tick);
+    PACK(cursor, netplay->last_local_hash.hash);
+    PACK(cursor, start);
+    PACK(cursor, input_count);
+    for (uint64_t tick = start; tick < netplay->local_input_end; tick++)
+    {
+        PlayerInput input = netplay->local_inputs[tick % INPUT_RING];
+        uint8_t buttons = input_pack_buttons(input);
+        PACK(cursor, input.move_x);
+        PACK(cursor, buttons);
+    }
+
+    // A full socket buffer is just another lost packet
+    if (sendto(netplay->socket, packet, cursor - packet, 0, (struct sockaddr *) &netplay->remote, sizeof(netplay->remote)) > 0)
+    {
+        netplay->stats.packets_sent++;
+    }
+}
+
+// Hashes every NETPLAY_HASH_INTERVAL'th state once all the inputs leading to it are confirmed
+static void record_hashes( Netplay netplay )
+{
+    Match match = netplay->match;
+    uint64_t final_ticks = (netplay->remote_input_end < match->tick) ? netplay->remote_input_end : match->tick;
+
+    while (netplay->next_hash_tick <= final_ticks)
+    {
+        uint64_t tick = netplay->next_hash_tick;
+        // The state after `tick` ticks is either the match itself or the one saved before simulating the next tick
+        uint64_t hash = (tick == match->tick) ? match_hash(match) : game_snapshot_hash(&netplay->states[tick % STATE_RING]);
+
+        TickHash *slot = &netplay->local_hashes[(tick / NETPLAY_HASH_INTERVAL) % HASH_RING];
+        slot->tick = tick;
+        slot->hash = hash;
+        netplay->last_local_hash = *slot;
+        check_hash(netplay, tick);
+
+        netplay->next_hash_tick += NETPLAY_HASH_INTERVAL;
+    }
+}
+
+static void check_hash( Netplay netplay, uint64_t tick )
+{
+    TickHash const *local = &netplay->local_hashes[(tick / NETPLAY_HASH_INTERVAL) % HASH_RING];
+    TickHash const *remote = &netplay->remote_hashes[(tick / NETPLAY_HASH_INTERVAL) % HASH_RING];
+    if (local->tick != tick || remote->tick != tick || tick <= netplay->last_checked_tick)
+    {
+        return;
+    }
+
+    netplay->stats.hashes_checked++;
+    if (local->hash != remote->hash)
+    {
+        fprintf(stderr, "Netplay desync at tick %llu: local hash %016llx, remote %016llx\n",
+            (unsigned long long) tick, (unsigned long long) local->hash, (unsigned long long) remote->hash);
+        netplay->desynced = true;
+    }
+    // The peer keeps sending the same hash until it has a newer one - only compare it once
+    netplay->last_checked_tick = tick;
+}
+
+// The confirmed input if we have it, otherwise predict the remote player is still doing what they last did
+static PlayerInput remote_input_for( Netplay netplay, uint64_t tick )
+{
+    if (tick < netplay->remote_input_end)
+    {
+        return netplay->remote_inputs[tick % INPUT_RING];
+    }
+    if (netplay->remote_input_end == 0)
+    {
+        return neutral_input();
+    }
+    return netplay->remote_inputs[(netplay->remote_input_end - 1) % INPUT_RING];
+}
+
+static bool input_equal( PlayerInput a, PlayerInput b )
+{
+    return a.move_x == b.move_x && input_pack_buttons(a) == input_pack_buttons(b);
+}
+
+static PlayerInput neutral_input( void )
+{
+    PlayerInput input = { .move_x = 0.0, .joystick_pos = JOYSTICK_MID, .attack_pressed = false, .jump_pressed = false };
+    return input;
+}
@@ -0,0 +1,64 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "game_types.h"
+
+typedef struct PlayerInput PlayerInput;
+typedef struct Match *Match;
+
+/*
+ * Rollback netplay between two cabinets over UDP.
+ * Each side simulates straight away with its own input and a prediction of the remote one (the last
+ * remote input it received, held). Local inputs are sent every tick - every packet carries all the
+ * inputs the peer hasn't acknowledged yet so lost or reordered packets don't matter. When a remote
+ * input turns out different from the prediction the match is restored from the GameSnapshot saved
+ * before that tick and the ticks since are simulated again.
+ * Once a tick's inputs are confirmed on both sides its state is final, so every NETPLAY_HASH_INTERVAL
+ * ticks the match_hash is exchanged and compared to catch desyncs.
+ *
+ * Usage:
+ *   Netplay netplay = netplay_start(match, &config);
+ *   every tick:  netplay_advance(netplay, local_input)  (instead of match_step)
+ *   netplay_stop(netplay);
+*/
+
+#define NETPLAY_MAX_ROLLBACK 16     // Ticks we may run ahead of the last confirmed remote input before stalling
+#define NETPLAY_MAX_INPUT_DELAY 8
+#define NETPLAY_HASH_INTERVAL 30
+
+typedef enum {
+    NETPLAY_OK,         // Ticked (possibly after rolling back)
+    NETPLAY_STALLED,    // Too far ahead of the remote side - the tick and its input were not used
+    NETPLAY_DESYNC      // The two sides reached different states for the same confirmed tick
+} NetplayStatus;
+
+typedef struct NetplayConfig {
+    PlayerId local_player;      // Which fighter this cabinet controls
+    uint16_t local_port;
+    char const *remote_host;    // Address or host name of the other cabinet
+    uint16_t remote_port;
+    int input_delay;            // Ticks local inputs are held back - more delay, fewer rollbacks
+} NetplayConfig;
+
+typedef struct NetplayStats {
+    uint64_t confirmed_ticks;   // Remote inputs are known for every tick before this
+    uint64_t peer_tick;         // Last tick the peer told us it reached
+    uint64_t rollbacks;
+    uint64_t resimulated_ticks;
+    uint64_t stalls;
+    uint64_t packets_sent;
+    uint64_t packets_received;
+    uint64_t hashes_checked;
+} NetplayStats;
+
+typedef struct Netplay *Netplay;
+
+extern Netplay netplay_start( Match match, NetplayConfig const *config );
+extern NetplayStatus netplay_advance( Netplay netplay, PlayerInput local_input );
+extern NetplayStatus netplay_poll( Netplay netplay );
+extern NetplayStats netplay_stats( Netplay netplay );
+extern void netplay_stop( Netplay netplay );
+
+#endif
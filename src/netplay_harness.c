@@ -0,0 +1,323 @@
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "netplay.h"
+#include "match.h"
+#include "input.h"
+#include "input_script.h"
+#include "combat.h"
+#include "snapshot.h"
+#include "roster.h"
+#include "game_types.h"
+
+/*
+ * Netplay loopback test - two netplay sessions in one process talking over real UDP sockets on
+ * 127.0.0.1 through a relay that adds latency, jitter (which also reorders packets) and loss.
+ * Each side plays random inputs for its own fighter. Time is simulated in 1ms steps so a long
+ * match runs in a moment. At the end both sides must have reached the same state as a plain
+ * match_step run of the same inputs, and no hash exchange may have reported a desync.
+ * Usage: ./netplay_harness [-t ticks] [-l latency ms] [-j jitter ms] [-p loss %] [-d delay ticks] [-r seed] [-P port]
+*/
+
+#define DEFAULT_TICKS 7200          // One minute of play
+#define DEFAULT_PORT 47000          // Uses this and the next three ports
+#define RELAY_QUEUE_SIZE 4096
+#define RELAY_PACKET_SIZE 1024
+#define DRAIN_TIME_MS 5000          // How long the sides get to confirm the last ticks once done
+
+typedef struct {
+    uint64_t deliver_ms;
+    size_t size;
+    unsigned char data[RELAY_PACKET_SIZE];
+} DelayedPacket;
+
+/* One direction of the fake network - reads what one side sends and passes it on to the other */
+typedef struct {
+    int in_socket;          // The sender's remote address
+    int out_socket;         // The receiver's remote address, so replies come back the other way
+    struct sockaddr_in destination;
+    DelayedPacket queue[RELAY_QUEUE_SIZE];
+    int count;
+    uint64_t dropped;
+} RelayLink;
+
+typedef struct {
+    unsigned latency_ms;
+    unsigned jitter_ms;
+    unsigned loss_percent;
+    uint32_t random;
+} LinkSettings;
+
+typedef struct {
+    Match match;
+    Netplay netplay;
+    InputScript script;
+    PlayerId player;
+    PlayerInput pending;    // Kept when the session stalls so the same input goes in next tick
+    bool have_pending;
+    bool desynced;
+} Peer;
+
+static int open_socket( uint16_t port );
+static struct sockaddr_in loopback_address( uint16_t port );
+static void relay_pump( RelayLink *link, LinkSettings *settings, uint64_t now_ms );
+static void peer_tick( Peer *peer );
+static PlayerInput script_input( InputScript script, PlayerId player );
+static uint32_t next_random( uint32_t *state );
+static void usage( char const *program );
+
+int main( int argc, char **argv )
+{
+    uint64_t total_ticks = DEFAULT_TICKS;
+    LinkSettings settings = { .latency_ms = 40, .jitter_ms = 15, .loss_percent = 5, .random = 1 };
+    int input_delay = 2;
+    uint32_t seed = 1;
+    uint16_t port = DEFAULT_PORT;
+    combat_verbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        char const *value = argv[i + 1];
+        if (strcmp(argv[i], "-t") == 0)         total_ticks = strtoull(value, NULL, 10);
+        else if (strcmp(argv[i], "-l") == 0)    settings.latency_ms = (unsigned) strtoul(value, NULL, 10);
+        else if (strcmp(argv[i], "-j") == 0)    settings.jitter_ms = (unsigned) strtoul(value, NULL, 10);
+        else if (strcmp(argv[i], "-p") == 0)    settings.loss_percent = (unsigned) strtoul(value, NULL, 10);
+        else if (strcmp(argv[i], "-d") == 0)    input_delay = atoi(value);
+        else if (strcmp(argv[i], "-r") == 0)    seed = (uint32_t) strtoul(value, NULL, 10);
+        else if (strcmp(argv[i], "-P") == 0)    port = (uint16_t) strtoul(value, NULL, 10);
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        i++;
+    }
+    if (input_delay < 0 || input_delay > NETPLAY_MAX_INPUT_DELAY)
+    {
+        fprintf(stderr, "Input delay must be 0 to %d ticks\n", NETPLAY_MAX_INPUT_DELAY);
+        return EXIT_FAILURE;
+    }
+    settings.random = seed * 2654435761u + 1;
+    // Both sides play the roster's first fighter
+    if (!roster_open(roster_path(ROSTER_PATH)))
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Side A is on port, side B on port + 1 - each talks to its own end of the relay
+    uint16_t port_a = port, port_b = port + 1, relay_a = port + 2, relay_b = port + 3;
+    int relay_a_socket = open_socket(relay_a);
+    int relay_b_socket = open_socket(relay_b);
+    static RelayLink a_to_b, b_to_a;
+    a_to_b = (RelayLink) { .in_socket = relay_a_socket, .out_socket = relay_b_socket, .destination = loopback_address(port_b) };
+    b_to_a = (RelayLink) { .in_socket = relay_b_socket, .out_socket = relay_a_socket, .destination = loopback_address(port_a) };
+
+    Peer peers[2];
+    for (int i = 0; i < 2; i++)
+    {
+        Peer *peer = &peers[i];
+        *peer = (Peer) { .player = (i == 0) ? PLAYER_1 : PLAYER_2, .script = input_script_random(seed + i) };
+        peer->match = calloc(1, sizeof(struct Match));
+        assert(peer->match != NULL);
+        match_init(peer->match, 0, 0);
+
+        NetplayConfig config = {
+            .local_player = peer->player,
+            .local_port = (i == 0) ? port_a : port_b,
+            .remote_host = "127.0.0.1",
+            .remote_port = (i == 0) ? relay_a : relay_b,
+            .input_delay = input_delay
+        };
+        peer->netplay = netplay_start(peer->match, &config);
+        if (!peer->netplay)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Both sides tick at SIM_TICK_RATE on the simulated clock, B half a tick after A
+    uint64_t deadline_ms = UINT64_MAX;
+    for (uint64_t now_ms = 0; now_ms < deadline_ms; now_ms++)
+    {
+        relay_pump(&a_to_b, &settings, now_ms);
+        relay_pump(&b_to_a, &settings, now_ms);
+
+        bool all_done = true;
+        for (int i = 0; i < 2; i++)
+        {
+            Peer *peer = &peers[i];
+            uint64_t ticks_due = (now_ms * SIM_TICK_RATE + i * 500) / 1000;
+            if (peer->match->tick < total_ticks && peer->match->tick < ticks_due)
+            {
+                peer_tick(peer);
+            }
+            else if (peer->match->tick >= total_ticks)
+            {
+                peer->desynced |= netplay_poll(peer->netplay) == NETPLAY_DESYNC;
+            }
+            all_done &= peer->match->tick >= total_ticks && netplay_stats(peer->netplay).confirmed_ticks >= total_ticks;
+        }
+        if (all_done)
+        {
+            break;
+        }
+        if (deadline_ms == UINT64_MAX && peers[0].match->tick >= total_ticks && peers[1].match->tick >= total_ticks)
+        {
+            deadline_ms = now_ms + DRAIN_TIME_MS;
+        }
+    }
+
+    // What the match should have been - each side's inputs land input_delay ticks after they were read
+    Match reference = calloc(1, sizeof(struct Match));
+    assert(reference != NULL);
+    match_init(reference, 0, 0);
+    InputScript scripts[2] = { input_script_random(seed), input_script_random(seed + 1) };
+    PlayerInput neutral = { .move_x = 0.0, .joystick_pos = JOYSTICK_MID };
+    for (uint64_t tick = 0; tick < total_ticks; tick++)
+    {
+        bool delayed = tick < (uint64_t) input_delay;
+        PlayerInput p1 = delayed ? neutral : script_input(scripts[0], PLAYER_1);
+        PlayerInput p2 = delayed ? neutral : script_input(scripts[1], PLAYER_2);
+        match_step(reference, p1, p2);
+    }
+    uint64_t expected = match_hash(reference);
+
+    bool passed = true;
+    printf("link:           %u ms latency, +-%u ms jitter, %u%% loss, %d ticks input delay\n",
+        settings.latency_ms, settings.jitter_ms, settings.loss_percent, input_delay);
+    printf("dropped:        %llu packets a->b, %llu b->a\n", (unsigned long long) a_to_b.dropped, (unsigned long long) b_to_a.dropped);
+    for (int i = 0; i < 2; i++)
+    {
+        Peer *peer = &peers[i];
+        NetplayStats stats = netplay_stats(peer->netplay);
+        uint64_t hash = match_hash(peer->match);
+        bool ok = !peer->desynced && stats.confirmed_ticks >= total_ticks && hash == expected;
+        passed &= ok;
+        printf("side %c:         tick %llu confirmed %llu, %llu rollbacks (%llu ticks resimulated), %llu stalls, "
+            "%llu/%llu packets sent/received, %llu hashes checked - %s\n",
+            'A' + i, (unsigned long long) peer->match->tick, (unsigned long long) stats.confirmed_ticks,
+            (unsigned long long) stats.rollbacks, (unsigned long long) stats.resimulated_ticks, (unsigned long long) stats.stalls,
+            (unsigned long long) stats.packets_sent, (unsigned long long) stats.packets_received,
+            (unsigned long long) stats.hashes_checked, ok ? "ok" : (peer->desynced ? "DESYNC" : "WRONG STATE"));
+    }
+    printf("result:         %s\n", passed ? "PASS" : "FAIL");
+
+    for (int i = 0; i < 2; i++)
+    {
+        netplay_stop(peers[i].netplay);
+        input_script_free(peers[i].script);
+        input_script_free(scripts[i]);
+        free(peers[i].match);
+    }
+    free(reference);
+    close(relay_a_socket);
+    close(relay_b_socket);
+    roster_close();
+
+    return passed ? 0 : EXIT_FAILURE;
+}
+
+static void peer_tick( Peer *peer )
+{
+    if (!peer->have_pending)
+    {
+        peer->pending = script_input(peer->script, peer->player);
+        peer->have_pending = true;
+    }
+
+    NetplayStatus status = netplay_advance(peer->netplay, peer->pending);
+    if (status == NETPLAY_OK)
+    {
+        peer->have_pending = false;
+    }
+    peer->desynced |= status == NETPLAY_DESYNC;
+}
+
+// Each side only plays its own fighter from its script
+static PlayerInput script_input( InputScript script, PlayerId player )
+{
+    PlayerInput p1, p2;
+    input_script_next(script, &p1, &p2);
+    return (player == PLAYER_1) ? p1 : p2;
+}
+
+// Queues everything waiting on the link's socket and sends on whatever is due
+static void relay_pump( RelayLink *link, LinkSettings *settings, uint64_t now_ms )
+{
+    DelayedPacket incoming;
+    ssize_t size;
+    while ((size = recv(link->in_socket, incoming.data, sizeof(incoming.data), 0)) > 0)
+    {
+        if (next_random(&settings->random) % 100 < settings->loss_percent || link->count == RELAY_QUEUE_SIZE)
+        {
+            link->dropped++;
+            continue;
+        }
+        int64_t jitter = settings->jitter_ms ? (int64_t) (next_random(&settings->random) % (2 * settings->jitter_ms + 1)) - settings->jitter_ms : 0;
+        int64_t delay = (int64_t) settings->latency_ms + jitter;
+        incoming.deliver_ms = now_ms + (delay > 0 ? delay : 0);
+        incoming.size = (size_t) size;
+        link->queue[link->count++] = incoming;
+    }
+
+    // Unordered - jitter is allowed to swap packets around
+    for (int i = 0; i < link->count; )
+    {
+        DelayedPacket *packet = &link->queue[i];
+        if (packet->deliver_ms > now_ms)
+        {
+            i++;
+            continue;
+        }
+        sendto(link->out_socket, packet->data, packet->size, 0, (struct sockaddr *) &link->destination, sizeof(link->destination));
+        *packet = link->queue[--link->count];
+    }
+}
+
+static int open_socket( uint16_t port )
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in address = loopback_address(port);
+    if (sock < 0 || bind(sock, (struct sockaddr *) &address, sizeof(address)) != 0 || fcntl(sock, F_SETFL, O_NONBLOCK) != 0)
+    {
+        fprintf(stderr, "Could not open UDP port %u: %s\n", port, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return sock;
+}
+
+static struct sockaddr_in loopback_address( uint16_t port )
+{
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    return address;
+}
+
+// xorshift32 - same generator the random input scripts use
+static uint32_t next_random( uint32_t *state )
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void usage( char const *program )
+{
+    fprintf(stderr, "Usage: %s [-t ticks] [-l latency ms] [-j jitter ms] [-p loss %%] [-d delay ticks] [-r seed] [-P port]\n", program);
+}
@@ -0,0 +1,175 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "pack.h"
+
+#define PATH_SIZE 4096
+
+// Only one pack is open at a time - map is NULL for an embedded pack, which is never unmapped
+static struct {
+    unsigned char const *data;
+    size_t size;
+    void *map;
+} pack;
+
+static bool check_pack( unsigned char const *data, size_t size, char const *name );
+
+/*
+ * Path to something in the repository, found from where the executable is (it lives in src/) rather
+ * than the working directory, so the game starts from anywhere. Falls back to ../ when the
+ * executable can't be found. Returns a static buffer.
+*/
+char const *pack_path( char const *relative )
+{
+    static char path[PATH_SIZE];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    char *slash = NULL;
+    if (length > 0)
+    {
+        path[length] = '\0';
+        slash = strrchr(path, '/');
+    }
+    if (!slash || snprintf(slash, sizeof(path) - (size_t) (slash - path), "/../%s", relative)
+                      >= (int) (sizeof(path) - (size_t) (slash - path)))
+    {
+        snprintf(path, sizeof(path), "../%s", relative);
+    }
+    return path;
+}
+
+bool pack_open( char const *path )
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror(path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(PackHeader))
+    {
+        fprintf(stderr, "%s is too small to be an asset pack\n", path);
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file alive on its own
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        perror(path);
+        return false;
+    }
+    if (!check_pack(map, (size_t) info.st_size, path))
+    {
+        munmap(map, (size_t) info.st_size);
+        return false;
+    }
+    pack_close();
+    pack.data = map;
+    pack.size = (size_t) info.st_size;
+    pack.map = map;
+    return true;
+}
+
+// For a pack linked into the executable (EMBED_ASSETS) - name is only for error messages
+bool pack_open_memory( void const *data, size_t size, char const *name )
+{
+    if (size < sizeof(PackHeader))
+    {
+        fprintf(stderr, "%s is too small to be an asset pack\n", name);
+        return false;
+    }
+    if (!check_pack(data, size, name))
+    {
+        return false;
+    }
+    pack_close();
+    pack.data = data;
+    pack.size = size;
+    return true;
+}
+
+void pack_close( void )
+{
+    if (pack.map)
+    {
+        munmap(pack.map, pack.size);
+    }
+    pack.data = NULL;
+    pack.size = 0;
+    pack.map = NULL;
+}
+
+// NULL if the open pack has nothing by that name
+PackEntry const *pack_find( char const *name )
+{
+    if (!pack.data)
+    {
+        return NULL;
+    }
+    PackHeader const *header = (PackHeader const *) pack.data;
+    PackEntry const *entries = (PackEntry const *) (header + 1);
+    for (int i = 0; i < header->entry_count; i++)
+    {
+        if (strncmp(entries[i].name, name, PACK_NAME_SIZE) == 0)
+        {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+void const *pack_data( PackEntry const *entry )
+{
+    return pack.data + entry->offset;
+}
+
+// Checks the header and every entry's bounds once so nothing reading the pack has to
+static bool check_pack( unsigned char const *data, size_t size, char const *name )
+{
+    PackHeader const *header = (PackHeader const *) data;
+    char const *problem = NULL;
+    if (header->magic != PACK_MAGIC)
+    {
+        problem = "not an asset pack";
+    }
+    else if (header->version != PACK_VERSION)
+    {
+        problem = "asset pack version doesn't match this build - rebuild it with make assets";
+    }
+    else if (header->size != size)
+    {
+        problem = "asset pack is truncated";
+    }
+    else if (header->entry_count > PACK_MAX_ENTRIES
+             || sizeof(PackHeader) + header->entry_count * sizeof(PackEntry) > size)
+    {
+        problem = "bad entry count";
+    }
+    if (problem)
+    {
+        fprintf(stderr, "%s: %s\n", name, problem);
+        return false;
+    }
+
+    PackEntry const *entries = (PackEntry const *) (header + 1);
+    for (int i = 0; i < header->entry_count; i++)
+    {
+        PackEntry const *entry = &entries[i];
+        bool fits = entry->offset % PACK_ALIGNMENT == 0 && entry->offset <= size && entry->size <= size - entry->offset;
+        bool image_fits = entry->kind != PACK_IMAGE
+            || ((uint64_t) entry->pitch * entry->height <= entry->size && entry->pitch >= entry->width * 4);
+        if (!fits || !image_fits || memchr(entry->name, '\0', PACK_NAME_SIZE) == NULL)
+        {
+            fprintf(stderr, "%s: entry %d is corrupt\n", name, i);
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Everything the renderer loads at startup, built by assetc (make assets) into one file: images
+ * already decoded into the pixel format the renderer's textures use, and data files (the sprite
+ * atlas table) as they are. The pack is mmapped and images go straight to SDL_UpdateTexture - no
+ * PNG decoding, no surfaces, no conversions. make EMBED_ASSETS=1 links the pack into main instead.
+ *
+ * File layout (native byte order - make rebuilds it with the game):
+ *   PackHeader
+ *   PackEntry[entry_count]
+ *   entry contents, each PACK_ALIGNMENT aligned
+ *
+ * Usage:
+ *   pack_open(pack_path("assets/game.pack"));    // Or pack_open_memory() for an embedded pack
+ *   PackEntry const *sprites = pack_find("sprites");
+ *   SDL_UpdateTexture(texture, NULL, pack_data(sprites), sprites->pitch);
+ *   pack_close() once nothing points into the pack
+*/
+
+#define PACK_PATH "assets/game.pack"    // From the repository root - see pack_path
+
+#define PACK_MAGIC 0x4b434150u          // "PACK"
+#define PACK_VERSION 1
+#define PACK_MAX_ENTRIES 16
+#define PACK_NAME_SIZE 24
+#define PACK_ALIGNMENT 64
+
+typedef enum {
+    PACK_IMAGE,     // width * height 4 byte pixels in format, rows pitch bytes apart
+    PACK_DATA
+} PackKind;
+
+typedef struct {
+    char name[PACK_NAME_SIZE];
+    uint32_t kind;          // PackKind
+    uint32_t format;        // SDL_PixelFormatEnum for images
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch;
+    uint32_t offset;        // From the start of the pack
+    uint32_t size;          // Bytes
+    uint32_t padding;
+} PackEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entry_count;
+    uint32_t size;          // Whole file
+    uint32_t padding;
+} PackHeader;
+
+extern char const *pack_path( char const *relative );
+extern bool pack_open( char const *path );
+extern bool pack_open_memory( void const *data, size_t size, char const *name );
+extern void pack_close( void );
+extern PackEntry const *pack_find( char const *name );
+extern void const *pack_data( PackEntry const *entry );
+
+#endif
@@ -1,9 +1,13 @@
+#include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "player.h"
 #include "game_types.h"
 #include "input.h"
 #include "sword.h"
+#include "animation.h"
+#include "roster.h"
+#include "fighter_store.h"
 
 //TODO() Hassam: Temp remove this later - just here for compilation purpose
 // instead we should be passing in the spawn position for our players in player_init 
@@ -11,435 +15,703 @@
 #define SCREEN_SIZE_X 1280 
 #define SCREEN_SIZE_Y 720 
 
-/* Main player constants */  
-#define JUMP_SPEED 35.0
-#define PLAYER_WIDTH 50.0 
-#define PLAYER_HEIGHT 150.0 
-#define PLAYER_SPEED 450.0
-#define CROUCHED_HEIGHT (PLAYER_HEIGHT / 2.0)
-
-/* Dive kick constants */
-#define DIVE_KICK_HITBOX_WIDTH 40.0
-#define DIVE_KICK_HITBOX_HEIGHT 30.0
-#define DIVE_KICK_HITBOX_XOFFSET 40.0
-#define DIVE_KICK_HITBOX_YOFFSET -20.0
-
-#define DIVE_KICK_HORIZONTAL_VEL 700.0
-#define DIVE_KICK_VERTICAL_VEL 600.0
-#define DIVE_KICK_STUN_TIME 1.2
-#define DIVE_KICK_X_IMPACT 20.0
-#define DIVE_KICK_Y_IMPACT (JUMP_SPEED * 0.75)
-#define DIVE_KICK_RECOVERY_TIME 0.6
-
-/* Game physics constants */
-#define GRAVITY 90.0   
+// Everything else about how a fighter moves comes from its FighterDef (roster.h)
 #define GROUND_LEVEL (SCREEN_SIZE_Y)
 
-/* Internal player constants */
-#define JUMP_DELAY 0.1
-#define STANCE_DELAY 0.2
+/* ------- STATE MACHINE ------- */
+
+// Everything that can move a fighter from one state to another
+typedef enum {
+    EVENT_JUMP,
+    EVENT_ATTACK,
+    EVENT_ATTACK_OVER,
+    EVENT_THROW,
+    EVENT_CROUCH,
+    EVENT_STAND,
+    EVENT_DIVE_KICK,
+    EVENT_LANDED,
+    EVENT_RECOVERED,        // stunned_duration ran out (stuns, recoveries and throws)
+    EVENT_KNOCKED,          // Hit by a dive kick
+    EVENT_KICK_CONNECTED,
+    EVENT_KILLED,
+    EVENT_COUNT
+} FighterEvent;
+
+// How the physics moves a fighter - each FighterState has one
+typedef enum {
+    PHYSICS_GROUNDED,   // Walls only
+    PHYSICS_FALLING,    // Gravity until it lands
+    PHYSICS_DIVING      // Straight line until it lands
+} PhysicsMode;
+
+// What player_update_attachments does with the sword
+typedef enum {
+    SWORD_GUARD,    // Follows the fighter, blocks while standing still
+    SWORD_SWING,    // Follows the fighter, hitbox from the attack frames
+    SWORD_LOWERED,  // Follows the fighter, no hitbox
+    SWORD_LEFT      // Stays where it was until the fighter recovers - or gone, if thrown
+} SwordHold;
+
+// Which of the fighter's heights the hurtbox takes
+typedef enum {
+    HURTBOX_KEEP,           // Whatever height the fighter had
+    HURTBOX_STANDING,
+    HURTBOX_CROUCHED
+} HurtboxSize;
+
+typedef void (*StateUpdateFn)( PlayerState player, PlayerInput input );
+typedef void (*StateChangeFn)( PlayerState player );
+typedef int (*AnimRowFn)( PlayerState player );
+
+typedef struct {
+    char const *name;
+    PhysicsMode physics;
+    SwordHold sword;
+    HurtboxSize hurtbox;
+    int anim_row;           // Used when row_fn is NULL
+    AnimRowFn row_fn;       // For rows that depend on velocity or stance
+    StateUpdateFn update;   // NULL when the fighter can't act
+    StateChangeFn enter;
+    StateChangeFn exit;
+} StateInfo;
+
+static void idle_update( PlayerState player, PlayerInput input );
+static void crouch_update( PlayerState player, PlayerInput input );
+static void attack_update( PlayerState player, PlayerInput input );
+static void jump_update( PlayerState player, PlayerInput input );
+static void dive_kick_update( PlayerState player, PlayerInput input );
+
+static void attack_enter( PlayerState player );
+static void dive_kick_enter( PlayerState player );
+static void dive_kick_exit( PlayerState player );
+static void stunned_enter( PlayerState player );
+static void recover_enter( PlayerState player );
+static void landed_enter( PlayerState player );
+static void dead_enter( PlayerState player );
+static void throw_enter( PlayerState player );
+
+static int standing_row( PlayerState player );
+static int attack_row( PlayerState player );
+static int airborne_row( PlayerState player );
+static int kick_row( PlayerState player );
+static int death_row( PlayerState player );
+
+static StateInfo const states[STATE_COUNT] = {
+    [STATE_IDLE] =           { "idle",           PHYSICS_GROUNDED, SWORD_GUARD,   HURTBOX_STANDING,0,           standing_row, idle_update,      NULL,            NULL },
+    [STATE_CROUCH] =         { "crouch",         PHYSICS_GROUNDED, SWORD_LOWERED, HURTBOX_CROUCHED, CROUCH_ROW,  NULL,         crouch_update,    NULL,            NULL },
+    [STATE_ATTACK] =         { "attack",         PHYSICS_GROUNDED, SWORD_SWING,   HURTBOX_STANDING,0,           attack_row,   attack_update,    attack_enter,    NULL },
+    [STATE_JUMP] =           { "jump",           PHYSICS_FALLING,  SWORD_GUARD,   HURTBOX_STANDING,0,           airborne_row, jump_update,      NULL,            NULL },
+    [STATE_DIVE_KICK] =      { "dive_kick",      PHYSICS_DIVING,   SWORD_GUARD,   HURTBOX_STANDING,0,           kick_row,     dive_kick_update, dive_kick_enter, dive_kick_exit },
+    [STATE_STUNNED] =        { "stunned",        PHYSICS_FALLING,  SWORD_LEFT,    HURTBOX_STANDING,0,           airborne_row, NULL,             stunned_enter,   NULL },
+    [STATE_STUNNED_LANDED] = { "stunned_landed", PHYSICS_GROUNDED, SWORD_LEFT,    HURTBOX_STANDING,STUNNED_ROW, NULL,         NULL,             landed_enter,    NULL },
+    [STATE_RECOVER] =        { "recover",        PHYSICS_FALLING,  SWORD_LEFT,    HURTBOX_STANDING,0,           airborne_row, NULL,             recover_enter,   NULL },
+    [STATE_RECOVER_LANDED] = { "recover_landed", PHYSICS_GROUNDED, SWORD_LEFT,    HURTBOX_STANDING,0,           standing_row, NULL,             landed_enter,    NULL },
+    [STATE_DEAD_FALLING] =   { "dead_falling",   PHYSICS_FALLING,  SWORD_LOWERED, HURTBOX_KEEP,    0,           death_row,    NULL,             dead_enter,      NULL },
+    [STATE_DEAD] =           { "dead",           PHYSICS_GROUNDED, SWORD_LOWERED, HURTBOX_KEEP,    0,           death_row,    NULL,             dead_enter,      NULL },
+    [STATE_THROW] =          { "throw",          PHYSICS_GROUNDED, SWORD_LEFT,    HURTBOX_STANDING,THROW_ROW,   NULL,         NULL,             throw_enter,     NULL },
+};
+
+// Stored one up so the zeroed entries mean the event is ignored in that state
+#define TO(state) ((state) + 1)
+
+static unsigned char const transitions[STATE_COUNT][EVENT_COUNT] = {
+    [STATE_IDLE] = {
+        [EVENT_JUMP] = TO(STATE_JUMP), [EVENT_ATTACK] = TO(STATE_ATTACK), [EVENT_CROUCH] = TO(STATE_CROUCH),
+        [EVENT_THROW] = TO(STATE_THROW),
+        [EVENT_KNOCKED] = TO(STATE_STUNNED), [EVENT_KILLED] = TO(STATE_DEAD)
+    },
+    [STATE_CROUCH] = {
+        [EVENT_STAND] = TO(STATE_IDLE),
+        [EVENT_KNOCKED] = TO(STATE_STUNNED), [EVENT_KILLED] = TO(STATE_DEAD)
+    },
+    [STATE_ATTACK] = {
+        [EVENT_ATTACK_OVER] = TO(STATE_IDLE),
+        [EVENT_KNOCKED] = TO(STATE_STUNNED), [EVENT_KILLED] = TO(STATE_DEAD)
+    },
+    [STATE_JUMP] = {
+        [EVENT_DIVE_KICK] = TO(STATE_DIVE_KICK), [EVENT_LANDED] = TO(STATE_IDLE),
+        [EVENT_KNOCKED] = TO(STATE_STUNNED), [EVENT_KILLED] = TO(STATE_DEAD_FALLING)
+    },
+    [STATE_DIVE_KICK] = {
+        [EVENT_LANDED] = TO(STATE_IDLE), [EVENT_KICK_CONNECTED] = TO(STATE_RECOVER),
+        [EVENT_KNOCKED] = TO(STATE_STUNNED), [EVENT_KILLED] = TO(STATE_DEAD_FALLING)
+    },
+    [STATE_STUNNED] = {
+        [EVENT_LANDED] = TO(STATE_STUNNED_LANDED), [EVENT_RECOVERED] = TO(STATE_JUMP),
+        [EVENT_KNOCKED] = TO(STATE_STUNNED), [EVENT_KILLED] = TO(STATE_DEAD_FALLING)
+    },
+    [STATE_STUNNED_LANDED] = {
+        [EVENT_RECOVERED] = TO(STATE_IDLE),
+        [EVENT_KNOCKED] = TO(STATE_STUNNED), [EVENT_KILLED] = TO(STATE_DEAD)
+    },
+    [STATE_RECOVER] = {
+        [EVENT_LANDED] = TO(STATE_RECOVER_LANDED), [EVENT_RECOVERED] = TO(STATE_JUMP),
+        [EVENT_KNOCKED] = TO(STATE_STUNNED), [EVENT_KILLED] = TO(STATE_DEAD_FALLING)
+    },
+    [STATE_RECOVER_LANDED] = {
+        [EVENT_RECOVERED] = TO(STATE_IDLE),
+        [EVENT_KNOCKED] = TO(STATE_STUNNED), [EVENT_KILLED] = TO(STATE_DEAD)
+    },
+    [STATE_DEAD_FALLING] = {
+        [EVENT_LANDED] = TO(STATE_DEAD)
+    },
+    [STATE_DEAD] = { 0 },
+    [STATE_THROW] = {
+        [EVENT_RECOVERED] = TO(STATE_IDLE),
+        [EVENT_KNOCKED] = TO(STATE_STUNNED), [EVENT_KILLED] = TO(STATE_DEAD)
+    },
+};
 
-static void player_update_state( PlayerState player, PlayerInput input, double dt );
-static void set_jump_state( PlayerState player, PlayerInput input, double dt );
-static void set_attack_state( PlayerState player, PlayerInput input, double dt );
 static void set_hurtbox_size( PlayerState player );
-static void player_simulate_physics( PlayerState player, double dt );
-static void player_begin_dive_kick( PlayerState player );
-
-static bool handle_ground_collision( PlayerState player );
-static void set_player_hurtbox_to_ground( PlayerState player );
-static void handle_wall_collision( PlayerState player );
+static void player_update_controls( PlayerState player, PlayerInput input, double dt );
+static void simulate_physics( FighterStore *store, int first, int last, double dt );
+static void player_land( PlayerState player );
 
 static void set_player_hitbox( PlayerState player );
 static void set_player_hurtbox( PlayerState player );
+static void walk( PlayerState player, PlayerInput input );
 static void update_stance( PlayerState player, JoystickPos movement ); 
 static void adjust_orientation( PlayerState player );
 
-static void set_stunned(PlayerState player, double stun_time);
+static void change_state( PlayerState player, FighterEvent event );
+static void update_anim_row( PlayerState player );
 
 static void internals_init( PlayerState player );
 static void internals_update( PlayerState player, double dt ); 
 
-// Must free the internals
-void player_init( PlayerState player, PlayerId id ) 
+// character is a roster index - the roster has to stay open for as long as the player is used
+void player_init( PlayerState player, PlayerId id, int character ) 
 {
+    FighterDef const *def = roster_fighter(character);
+    assert(def != NULL);
+
     player->id = id; 
+    player->character = character;
+    player->def = def;
+    FIGHTER_STATE(player) = STATE_IDLE;
     player->time_in_anim = 0;
-    player->pos.x = id == PLAYER_1 ? PLAYER_WIDTH / 2.0 : SCREEN_SIZE_X - PLAYER_WIDTH / 2.0;
-    player->pos.y = GROUND_LEVEL - PLAYER_HEIGHT / 2.0;
+    FIGHTER_POS(player).x = id == PLAYER_1 ? def->width / 2.0 : SCREEN_SIZE_X - def->width / 2.0;
+    FIGHTER_POS(player).y = GROUND_LEVEL - def->height / 2.0;
+    FIGHTER_PREV_POS(player) = FIGHTER_POS(player);
 
-    player->vel.x = 0.0;
-    player->vel.y = 0.0;
+    FIGHTER_VEL(player).x = 0.0;
+    FIGHTER_VEL(player).y = 0.0;
     player->stance = MIDDLE;
     // player->is_armed = true;
-    player->is_jumping = false;
-    player->is_attacking = false;
-    player->is_dead = false;
     player->is_right_facing = id == PLAYER_1;
-    player->in_stunned_state = false;
-    player->is_crouching = false;
     
     player->hitbox.width = 0.0;
     player->hitbox.height = 0.0;
     set_player_hitbox(player);
     player->hitbox.enabled = false;
 
-    player->hurtbox.width = PLAYER_WIDTH;
-    player->hurtbox.height = PLAYER_HEIGHT;
+    FIGHTER_HURTBOX(player).width = def->width;
+    FIGHTER_HURTBOX(player).height = def->height;
     set_player_hurtbox(player);
-    player->hurtbox.enabled = true;
+    FIGHTER_HURTBOX(player).enabled = true;
     
     player->sword = sword_init(player);
     
     internals_init(player);
+    update_anim_row(player);
 }
 
 static void internals_init( PlayerState player ) {
     player->internal.jump_delay = 0.0;
     player->internal.stance_delay = 0.0;
-    player->internal.is_stunned = false;
     player->internal.stunned_duration = 0.0;
 }
 
+// Everything about src, hot fields included, into dest - which keeps its own store slot
+void player_copy( PlayerState dest, struct PlayerState const *src )
+{
+    FighterStore *store = dest->store;
+    int slot = dest->slot;
+    *dest = *src;
+    dest->store = store;
+    dest->slot = slot;
+
+    FIGHTER_POS(dest) = FIGHTER_POS(src);
+    FIGHTER_PREV_POS(dest) = FIGHTER_PREV_POS(src);
+    FIGHTER_VEL(dest) = FIGHTER_VEL(src);
+    FIGHTER_HURTBOX(dest) = FIGHTER_HURTBOX(src);
+    FIGHTER_STATE(dest) = FIGHTER_STATE(src);
+}
+
 void player_set_death_state( PlayerState player )
 {
-    player->is_dead = true;
-    //Purposefully don't set y velocity and is_jumping so if killed in mid air dies and falls
-    player->vel.x = 0;
-    player->is_attacking = false;
+    change_state(player, EVENT_KILLED);
+}
+
+bool player_is_dead( PlayerState player )
+{
+    return FIGHTER_STATE(player) == STATE_DEAD || FIGHTER_STATE(player) == STATE_DEAD_FALLING;
+}
 
-    player->hurtbox.enabled = false;
-    player->sword.hitbox.enabled = false;
+char const *player_state_name( FighterState state )
+{
+    return (state < STATE_COUNT) ? states[state].name : "unknown";
 }
 
+// dt is the fixed simulation tick (SIM_DT) - never the render frame time
 void player_update( PlayerState player, PlayerInput input, double dt ) 
 {
-    internals_update(player, dt);
+    player_update_controls(player, input, dt);
 
-    if( !player->is_dead && !player->internal.is_stunned )
+    simulate_physics(player->store, player->slot, player->slot + 1, dt);
+    if (player->store->landed[player->slot])
     {
-        player_update_state(player, input, dt);
+        player_land(player);
     }
 
-    set_hurtbox_size(player);
+    player_update_attachments(player);
+}
+
+/*
+ * player_update for every fighter bound to store, a step at a time - controls for each, the physics
+ * for all of them in one loop down the store's arrays, then landings and attachments for each.
+ * Fighters don't look at each other until combat, so this is the same as player_update on each.
+*/
+void player_update_batch( FighterStore *store, PlayerInput const *inputs, double dt )
+{
+    for (int i = 0; i < store->count; i++)
+    {
+        player_update_controls(store->players[i], inputs[i], dt);
+    }
 
-    player_simulate_physics(player, dt);
+    simulate_physics(store, 0, store->count, dt);
 
-    // TODO() If sword not thrown and check armed aswell 
-    if (!player->internal.is_stunned) {
-        move_sword_to_player(&player->sword, player->pos, player->is_right_facing, player->stance);
-        sword_update_attack_hitbox( player );
+    for (int i = 0; i < store->count; i++)
+    {
+        PlayerState player = store->players[i];
+        if (store->landed[i])
+        {
+            player_land(player);
+        }
+        player_update_attachments(player);
     }
 }
 
-static void player_update_state( PlayerState player, PlayerInput input, double dt ) 
+// Everything in player_update before the physics - timers, input handling and the hurtbox size
+static void player_update_controls( PlayerState player, PlayerInput input, double dt )
 {
-    // Sets initial jumping velocity - checks if allowed to jump etc 
-    // simulate_physics handles the jumping effect
-    
-    set_jump_state(player, input, dt);
-    
-    set_attack_state(player, input, dt);
+    // Remember where we were so the renderer can interpolate between ticks
+    FIGHTER_PREV_POS(player) = FIGHTER_POS(player);
 
-    // TODO() depends if running or not will have field in player for that
-    if (player->is_attacking && player->is_jumping)
+    internals_update(player, dt);
+
+    StateInfo const *info = &states[FIGHTER_STATE(player)];
+    if (info->update)
     {
-        //Dive kick - x and y velocity unchanged
+        bool attacking = FIGHTER_STATE(player) == STATE_ATTACK || FIGHTER_STATE(player) == STATE_DIVE_KICK;
+        sword_update_internal_state(&player->sword, attacking, dt);
+
+        info->update(player, input);
+
+        // Adjusts according to velocity
+        adjust_orientation(player); 
+        if (FIGHTER_STATE(player) == STATE_CROUCH)
+        {
+            FIGHTER_VEL(player).x = 0.0;
+        }
     }
-    else if (player->is_attacking) 
+
+    set_hurtbox_size(player);
+}
+
+// Everything in player_update after the physics - boxes and sword follow the new position
+void player_update_attachments( PlayerState player )
+{
+    set_player_hurtbox(player);
+    set_player_hitbox(player);
+
+    // A thrown sword is moved by the projectile pool until it's picked up
+    SwordHold hold = states[FIGHTER_STATE(player)].sword;
+    if (hold != SWORD_LEFT && !player->sword.thrown) {
+        move_sword_to_player(&player->sword, FIGHTER_POS(player), player->is_right_facing, player->stance);
+        switch (hold)
+        {
+            case SWORD_SWING:
+                sword_update_attack_hitbox(player);
+                break;
+            case SWORD_GUARD:
+                sword_update_guard_hitbox(player);
+                break;
+            default:
+                player->sword.hitbox.enabled = false;
+                break;
+        }
+    }
+
+    update_anim_row(player);
+}
+
+/*
+ * Looks the event up in the transition table and, if it leads anywhere, runs the old state's exit
+ * and the new state's enter. A state can transition to itself (knocked again while stunned) and
+ * runs both handlers when it does.
+*/
+static void change_state( PlayerState player, FighterEvent event )
+{
+    int next = transitions[FIGHTER_STATE(player)][event];
+    if (next == 0)
     {
-        //Sword attack / melee punch
-        player->vel.x = 0.0;
+        return;
     }
-    else
+    StateInfo const *from = &states[FIGHTER_STATE(player)];
+    if (from->exit)
     {
-        // Not attacking
-        if (!player->is_jumping)
-        {
-            update_stance(player, input.joystick_pos);
-        }
-        // If crouching we set velocity here just for changing orientation
-        player->vel.x = input.move_x * PLAYER_SPEED * dt;
+        from->exit(player);
     }
-    
-    // Adjusts according to velocity
-    adjust_orientation(player); 
-    if (player->is_crouching)
+    FIGHTER_STATE(player) = (FighterState) (next - 1);
+    StateInfo const *to = &states[FIGHTER_STATE(player)];
+    if (to->enter)
     {
-        player->vel.x = 0.0;
+        to->enter(player);
     }
+    update_anim_row(player);
+}
 
+static void update_anim_row( PlayerState player )
+{
+    StateInfo const *info = &states[FIGHTER_STATE(player)];
+    player->anim_row = info->row_fn ? info->row_fn(player) : info->anim_row;
 }
 
-static void set_hurtbox_size( PlayerState player )
+/* ------- STATE UPDATES ------- */
+
+static void idle_update( PlayerState player, PlayerInput input )
 {
-    double previous_lowest = player->hurtbox.top_left.y + player->hurtbox.height;
-    //TODO() upate pos accordingly
-    if (player->is_crouching)
+    // Sets initial jumping velocity - simulate_physics handles the jumping effect
+    if (player->internal.jump_delay <= 0.0 && input.jump_pressed)
     {
-        // Crouching can only occur from idle state
-        player->hurtbox.width = PLAYER_WIDTH;
-        player->hurtbox.height = CROUCHED_HEIGHT;
+        FIGHTER_VEL(player).y = -player->def->jump_speed;
+        change_state(player, EVENT_JUMP);
+        // Attack pressed on the same tick goes straight into a dive kick
+        jump_update(player, input);
+        return;
     }
-    //TODO() have case for stunned - shouldnt set player_hurtbox_to_ground tho
-    else
+
+    if (sword_can_attack(&player->sword) && input.attack_pressed && !player->sword.thrown)
     {
-        // In General if hitbox growing - likely for hitbox to phase into ground 
-        // dont necessarily want to always force to ground - so call handle_ground_collision
-        player->hurtbox.width = PLAYER_WIDTH;
-        player->hurtbox.height = PLAYER_HEIGHT;
+        // Attacking with the joystick held up in the high guard throws the sword instead
+        bool throwing = player->stance == HIGH && input.joystick_pos == JOYSTICK_UP;
+        change_state(player, throwing ? EVENT_THROW : EVENT_ATTACK);
+        return;
     }
-    player->pos.y = previous_lowest - player->hurtbox.height / 2.0;
-    // simulate_physics will set the player hurtbox location to snap on to new pos aswell
+
+    walk(player, input);
 }
 
-static void set_jump_state( PlayerState player, PlayerInput input, double dt ) 
+static void crouch_update( PlayerState player, PlayerInput input )
 {
-    bool already_jumping = player->is_jumping;
-    
-    if( !already_jumping && player->internal.jump_delay <= 0.0 && !player->is_attacking  && !player->is_crouching ) 
+    walk(player, input);
+}
+
+static void attack_update( PlayerState player, PlayerInput input )
+{
+    if (sword_check_attack_over(player))
     {
-        player->is_jumping = input.jump_pressed;
-        // If started jumping basically
-        // TODO() do we need to check grounded?
-        if (player->is_jumping) 
-        {
-            player->vel.y = -JUMP_SPEED;
-        }
+        change_state(player, EVENT_ATTACK_OVER);
+        walk(player, input);
+        return;
+    }
+    //Sword attack / melee punch
+    FIGHTER_VEL(player).x = 0.0;
+}
+
+static void jump_update( PlayerState player, PlayerInput input )
+{
+    if (input.attack_pressed)
+    {
+        change_state(player, EVENT_DIVE_KICK);
+        return;
     }
+    FIGHTER_VEL(player).x = input.move_x * player->def->speed;
 }
 
-static void set_attack_state( PlayerState player, PlayerInput input, double dt )
+static void dive_kick_update( PlayerState player, PlayerInput input )
 {
-    sword_update_internal_state(&player->sword, player->is_attacking, dt);
+    //Dive kick - x and y velocity unchanged
+}
+
+// On the ground and free to move
+static void walk( PlayerState player, PlayerInput input )
+{
+    update_stance(player, input.joystick_pos);
+    // If crouching we set velocity here just for changing orientation
+    FIGHTER_VEL(player).x = input.move_x * player->def->speed;
+}
+
+/* ------- ENTER/EXIT ------- */
+
+static void attack_enter( PlayerState player )
+{
+    sword_begin_melee_attack(&player->sword, player->stance);
+    FIGHTER_VEL(player).x = 0.0;
+}
+
+static void dive_kick_enter( PlayerState player )
+{
+    double scale_factor = (player->is_right_facing) ? 1.0 : -1.0;
+
+    FIGHTER_VEL(player).x = player->def->dive_kick_x_speed * scale_factor;
+    FIGHTER_VEL(player).y = player->def->dive_kick_y_speed;
     
-    //Beginning sword attack
-    if (!player->is_attacking && sword_can_attack(&player->sword) && !player->is_jumping && !player->is_crouching)
+    player->hitbox.enabled = true;
+    player->hitbox.width = player->def->dive_kick_width;
+    player->hitbox.height = player->def->dive_kick_height;
+    // Hitbox top_left set later
+}
+
+static void dive_kick_exit( PlayerState player )
+{
+    player->hitbox.enabled = false;
+}
+
+static void stunned_enter( PlayerState player )
+{
+    //TODO() change hitbox to dramatically shrink
+    player->internal.stunned_duration = player->def->dive_kick_stun_time;
+    if (!player->sword.thrown)
     {
-        player->is_attacking = input.attack_pressed;
-        if (player->is_attacking)
-        {
-            sword_begin_melee_attack(&player->sword, player->stance);
-        }
+        player->sword.hitbox.enabled = false;
     }
-    // Dive kick
-    else if (!player->is_attacking && player->is_jumping && input.attack_pressed)
+}
+
+static void recover_enter( PlayerState player )
+{
+    double scale_factor = (player->is_right_facing) ? 1.0 : -1.0;
+
+    // TODO() remove magig numbers
+    FIGHTER_VEL(player).x = -scale_factor * player->def->dive_kick_x_impact * 0.25;
+    //Gravity should make them fall
+    FIGHTER_VEL(player).y = -player->def->dive_kick_y_impact * 0.5;
+
+    player->internal.stunned_duration = player->def->dive_kick_recovery_time;
+}
+
+// If is stunned and land on floor - dont move
+static void landed_enter( PlayerState player )
+{
+    FIGHTER_VEL(player).x = 0.0;
+}
+
+static void dead_enter( PlayerState player )
+{
+    //Purposefully don't touch y velocity so if killed in mid air dies and falls
+    FIGHTER_VEL(player).x = 0;
+
+    FIGHTER_HURTBOX(player).enabled = false;
+    // A sword already thrown keeps flying
+    if (!player->sword.thrown)
     {
-        player_begin_dive_kick(player);
+        player->sword.hitbox.enabled = false;
     }
-    // Check attacking but not dive_kick
-    else if (player->is_attacking && !player->is_jumping) {
-        player->is_attacking = !sword_check_attack_over(&player->sword, player->stance);
+}
+
+// The sword leaves the hand now - projectile_pool_update launches it later this tick
+static void throw_enter( PlayerState player )
+{
+    FIGHTER_VEL(player).x = 0.0;
+    player->sword.thrown = true;
+    player->sword.internal.launching = true;
+    player->sword.hitbox.enabled = false;
+    player->internal.stunned_duration = player->def->throw_time;
+}
+
+/* ------- ANIMATION ROWS ------- */
+
+static int standing_row( PlayerState player )
+{
+    static int const idle_rows[] = { [LOW] = IDLE_LOW_ROW, [MIDDLE] = IDLE_MIDDLE_ROW, [HIGH] = IDLE_HIGH_ROW };
+    if (player->sword.thrown)
+    {
+        return (FIGHTER_VEL(player).x != 0.0) ? RUN_DISARMED_ROW : IDLE_DISARMED_ROW;
     }
+    return (FIGHTER_VEL(player).x != 0.0) ? RUN_ROW : idle_rows[player->stance];
+}
+
+static int attack_row( PlayerState player )
+{
+    static int const attack_rows[] = { [LOW] = LOW_ATTACK_ROW, [MIDDLE] = MIDDLE_ATTACK_ROW, [HIGH] = HIGH_ATTACK_ROW };
+    return attack_rows[player->stance];
 }
 
-static void player_simulate_physics( PlayerState player, double dt ) 
+static int airborne_row( PlayerState player )
 {
-    // Normal jumps and movement should have gravity so dt taken into account with velocity
-    // Whereas when dive kicking fixed fall speed and horizontal speed so dt must be taken into account when updating position
-    if( !(player->is_attacking && player->is_jumping) )
+    if (player->sword.thrown)
     {
-        player->pos.x += player->vel.x;
-        player->pos.y += player->vel.y;
+        return (FIGHTER_VEL(player).y < 0.0) ? JUMP_DISARMED_ROW : FALL_DISARMED_ROW;
     }
-    else {
-    // Dive kicking
-        player->pos.x += player->vel.x * dt;
-        player->pos.y += player->vel.y * dt;
+    return (FIGHTER_VEL(player).y < 0.0) ? JUMP_ROW : FALL_ROW;
+}
+
+static int kick_row( PlayerState player )
+{
+    return (player->sword.thrown) ? KICK_DISARMED_ROW : KICK_ROW;
+}
+
+static int death_row( PlayerState player )
+{
+    return (player->sword.thrown) ? DEATH_DISARMED_ROW : DEATH_ROW;
+}
+
+/* ------- PHYSICS ------- */
+
+static void set_hurtbox_size( PlayerState player )
+{
+    HurtboxSize size = states[FIGHTER_STATE(player)].hurtbox;
+    if (size == HURTBOX_KEEP)
+    {
+        return;
     }
-    
-    // Move hitbox according to new pos
-    set_player_hurtbox(player); 
+    double height = (size == HURTBOX_CROUCHED) ? player->def->crouched_height : player->def->height;
+    double previous_lowest = FIGHTER_HURTBOX(player).top_left.y + FIGHTER_HURTBOX(player).height;
+    // In General if hitbox growing - likely for hitbox to phase into ground 
+    // dont necessarily want to always force to ground - so leave it to simulate_physics
+    FIGHTER_HURTBOX(player).width = player->def->width;
+    FIGHTER_HURTBOX(player).height = height;
+    FIGHTER_POS(player).y = previous_lowest - FIGHTER_HURTBOX(player).height / 2.0;
+    // simulate_physics will set the player hurtbox location to snap on to new pos aswell
+}
 
-    handle_wall_collision(player);
-   
-    if( player->is_jumping) {
-        if( !player->is_attacking ) 
+/*
+ * Moves slots [first, last) of store - walls, gravity and the ground, no state changes. Fighters that
+ * touched the ground get landed set and the caller runs player_land on them, so this loop only
+ * reads and writes the store's arrays (and each fighter's gravity).
+*/
+static void simulate_physics( FighterStore *store, int first, int last, double dt )
+{
+    for (int i = first; i < last; i++)
+    {
+        Vector_2D pos = store->pos[i];
+        Vector_2D vel = store->vel[i];
+        Box hurtbox = store->hurtbox[i];
+
+        // Velocity is always in px/s - dive kicks just don't get gravity applied below
+        pos.x += vel.x * dt;
+        pos.y += vel.y * dt;
+        // Hurtbox follows the new pos
+        hurtbox.top_left = (Vector_2D) { pos.x - hurtbox.width / 2.0, pos.y - hurtbox.height / 2.0 };
+
+        //TODO() make players bounce of wall -> have player_stasis which is bool if true -> user does not control user velocity
+        if (hurtbox.top_left.x < 0)
+        {
+            vel.x = 0;
+            pos.x = hurtbox.width / 2.0;
+        }
+        else if (hurtbox.top_left.x + hurtbox.width > SCREEN_SIZE_X)
+        {
+            vel.x = 0;
+            pos.x = SCREEN_SIZE_X - hurtbox.width / 2.0;
+        }
+
+        PhysicsMode mode = states[store->state[i]].physics;
+        if (mode == PHYSICS_FALLING)
         {
             // Downward acceleration due to gravity - if not dive kicking
-            player->vel.y += GRAVITY * dt;
+            vel.y += store->players[i]->def->gravity * dt;
         }
-        
-        bool clamped = handle_ground_collision(player);
-        if (clamped) 
+        // Bottom of the hurtbox (highest y) reaching the ground while moving down
+        bool landed = mode != PHYSICS_GROUNDED && hurtbox.top_left.y + hurtbox.height >= GROUND_LEVEL && vel.y > 0;
+        if (landed)
         {
-            player->is_jumping = false;
-            player->internal.jump_delay = JUMP_DELAY;
-            
-            // In case dive kicking
-            player->is_attacking = false;
-            player->hitbox.enabled = false;
-
-            // If is stunned and land on floor - dont move
-            if (player->internal.is_stunned)
-            {
-                player->vel.x = 0.0;
-            }
+            vel.y = 0;
+            pos.y = GROUND_LEVEL - hurtbox.height / 2.0;
         }
+
+        store->pos[i] = pos;
+        store->vel[i] = vel;
+        store->hurtbox[i] = hurtbox;
+        store->landed[i] = landed;
     }
-    
-    set_player_hurtbox(player);
-    set_player_hitbox(player);
+}
+
+// Touched the ground this tick (simulate_physics) - pos and vel.y are already clamped
+static void player_land( PlayerState player )
+{
+    player->internal.jump_delay = player->def->jump_delay;
+    change_state(player, EVENT_LANDED);
 }
 
  // Update player hurtbox based on current (central) pos
 static void set_player_hurtbox( PlayerState player ) 
 { 
-    player->hurtbox.top_left = (Vector_2D){player->pos.x - player->hurtbox.width / 2.0, player->pos.y - player->hurtbox.height / 2.0};
+    FIGHTER_HURTBOX(player).top_left = (Vector_2D){FIGHTER_POS(player).x - FIGHTER_HURTBOX(player).width / 2.0, FIGHTER_POS(player).y - FIGHTER_HURTBOX(player).height / 2.0};
     // Width and height of hurtbox unchanged here
 }
 
 
 static void set_player_hitbox( PlayerState player ) {
-    if( player->is_attacking && player->is_jumping )
-    // Divekick
+    if( FIGHTER_STATE(player) == STATE_DIVE_KICK )
     {
         double scale_factor = (player->is_right_facing) ? 1.0 : -1.0;
-        double center_x = player->hurtbox.top_left.x + player->hurtbox.width / 2.0;        
+        double center_x = FIGHTER_HURTBOX(player).top_left.x + FIGHTER_HURTBOX(player).width / 2.0;        
 
-        player->hitbox.top_left.x = center_x - player->hitbox.width / 2.0 + scale_factor * DIVE_KICK_HITBOX_XOFFSET;
+        player->hitbox.top_left.x = center_x - player->hitbox.width / 2.0 + scale_factor * player->def->dive_kick_x_offset;
 
-        player->hitbox.top_left.y = player->hurtbox.top_left.y + player->hurtbox.height + DIVE_KICK_HITBOX_YOFFSET;
+        player->hitbox.top_left.y = FIGHTER_HURTBOX(player).top_left.y + FIGHTER_HURTBOX(player).height + player->def->dive_kick_y_offset;
     }
 }
 
 
 static void update_stance( PlayerState player, JoystickPos stance_change )
 {
-    //bool previously_crouching = player->is_crouching;
-    //player->is_crouching = false;
-
     if (player->internal.stance_delay <= 0.0)
     {
-        player->is_crouching = false;
+        FighterEvent event = EVENT_STAND;
         if( stance_change == JOYSTICK_UP ) 
         {
-            // TODO() if high already and holding joystick up - get ready to throw sword?
+            // Already high and holding up - attacking throws the sword (idle_update)
             player->stance = (player->stance == LOW) ? MIDDLE : HIGH;
-            player->internal.stance_delay = STANCE_DELAY;
+            player->internal.stance_delay = player->def->stance_delay;
         } 
         else if( stance_change == JOYSTICK_DOWN )
         {
-            // TODO() perhaps if already lowest and holding low we crouch?
+            // Already lowest and holding low - crouch
             if (player->stance == LOW) {
-                player->is_crouching = true;
+                event = EVENT_CROUCH;
             }   
             player->stance = (player->stance == HIGH) ? MIDDLE : LOW;
-            player->internal.stance_delay = STANCE_DELAY;
+            player->internal.stance_delay = player->def->stance_delay;
         }
+        change_state(player, event);
     }
 }
 
-static void player_begin_dive_kick( PlayerState player )
-{
-    double scale_factor = (player->is_right_facing) ? 1.0 : -1.0;
-
-    player->is_attacking = true;
-    player->vel.x = DIVE_KICK_HORIZONTAL_VEL * scale_factor;
-    player->vel.y = DIVE_KICK_VERTICAL_VEL;
-    
-    player->hitbox.enabled = true;
-    player->hitbox.width = DIVE_KICK_HITBOX_WIDTH;
-    player->hitbox.height = DIVE_KICK_HITBOX_HEIGHT;
-    // Hitbox top_left set later
-}
-
 void player_end_dive_kick( PlayerState player )
 {
-    double scale_factor = (player->is_right_facing) ? 1.0 : -1.0;
-
-    player->is_attacking = false;
-    // TODO() remove magig numbers
-    player->vel.x = -scale_factor * DIVE_KICK_X_IMPACT * 0.25;
-    //Gravity should make them fall
-    player->vel.y = -DIVE_KICK_Y_IMPACT * 0.5;
-
-    player->internal.is_stunned = true;
-    player->internal.stunned_duration = DIVE_KICK_RECOVERY_TIME;
-
-    player->hitbox.enabled = false;
-
+    change_state(player, EVENT_KICK_CONNECTED);
 }
 
 void player_receive_dive_kick( PlayerState receiver, PlayerState attacker )
 {
-    set_stunned(receiver, DIVE_KICK_STUN_TIME);
+    change_state(receiver, EVENT_KNOCKED);
    
     double scale_factor = (attacker->is_right_facing) ? 1.0 : -1.0;
 
-    receiver->vel.x = DIVE_KICK_X_IMPACT * scale_factor;
-    receiver->vel.y = -DIVE_KICK_Y_IMPACT;
+    // How hard the kick lands is up to whoever threw it
+    FIGHTER_VEL(receiver).x = attacker->def->dive_kick_x_impact * scale_factor;
+    FIGHTER_VEL(receiver).y = -attacker->def->dive_kick_y_impact;
     
     //TODO() probably not needed but should not matter
     set_hurtbox_size(receiver);
-}
-
-static void set_stunned( PlayerState player, double stun_time )
-{
-    //TODO() change hitbox to dramatically shrink
-
-    player->in_stunned_state = true;
-    player->internal.is_stunned = true;
-    player->internal.stunned_duration = stun_time;
-    player->is_jumping = true;
-    player->is_attacking = false;
-    player->hitbox.enabled = false;
-    player->sword.hitbox.enabled = false;
-}
-
-static void set_unstunned( PlayerState player )
-{
-    //TODO() grow hitbox as necessary
-    player->in_stunned_state = false;
-    player->internal.is_stunned = false;
+    update_anim_row(receiver);
 }
 
 static void adjust_orientation( PlayerState player ) 
 {
-    if (player->vel.x > 0 && !player->is_right_facing) 
+    if (FIGHTER_VEL(player).x > 0 && !player->is_right_facing) 
     {
         player->is_right_facing = true;
     } 
-    else if (player->vel.x < 0 && player->is_right_facing) 
+    else if (FIGHTER_VEL(player).x < 0 && player->is_right_facing) 
     {
         player->is_right_facing = false;
     }
 }
 
-// Returns true if clamped position - false if no need
-static bool handle_ground_collision( PlayerState player ) 
-{   
-    // Checking if bottom left of player touching ground (note bottom will have highest y value)
-    if( player->hurtbox.top_left.y + player->hurtbox.height >= GROUND_LEVEL && player->vel.y > 0 )
-    {
-        player->vel.y = 0;
-        set_player_hurtbox_to_ground(player);
-        return true;
-    }
-    return false;
-}
-
-static void set_player_hurtbox_to_ground( PlayerState player )
-{
-    player->pos.y = GROUND_LEVEL - player->hurtbox.height / 2.0;
-}
-
-static void handle_wall_collision( PlayerState player ) 
-{
-    //TODO() make players bounce of wall -> have player_stasis which is bool if true -> user does not control user velocity
-
-    if( player->hurtbox.top_left.x < 0 )
-    {
-        player->vel.x = 0;
-        player->pos.x = player->hurtbox.width / 2.0;
-    }
-    else if( player->hurtbox.top_left.x + player->hurtbox.width > SCREEN_SIZE_X )
-    {
-        player->vel.x = 0;
-        player->pos.x = SCREEN_SIZE_X - player->hurtbox.width / 2.0;
-    }
-}
-
 static void update_delay( double *delay, double dt )
 {
     if( *delay > 0.0 ) 
@@ -461,7 +733,7 @@ static void internals_update( PlayerState player, double dt )
 
     if (player->internal.stunned_duration <= 0.0)
     {
-        set_unstunned(player);
+        change_state(player, EVENT_RECOVERED);
     }
 }
 
@@ -478,9 +750,9 @@ void print_player( PlayerState player )
     printf("ID: %d\n", player->id);
     printf("Time_in_anim #: %f\n", player->time_in_anim );
     printf("Position: ");
-    print_vector_2d(player->pos);
+    print_vector_2d(FIGHTER_POS(player));
     printf("\nVelocity: ");
-    print_vector_2d(player->vel);
+    print_vector_2d(FIGHTER_VEL(player));
     printf("\nStance: ");
     switch (player->stance) 
     {
@@ -489,13 +761,12 @@ void print_player( PlayerState player )
         case HIGH: printf("HIGH\n"); break;
         default: printf("UNKNOWN\n"); break;
     }
-    printf("Is Jumping: %s\n", player->is_jumping ? "Yes" : "No");
-    printf("Is Attacking: %s\n", player->is_attacking ? "Yes" : "No");
+    printf("State: %s\n", player_state_name(FIGHTER_STATE(player)));
     printf("Facing Right: %s\n", player->is_right_facing ? "Yes" : "No");
 
     printf("Hurtbox Top Left: ");
-    print_vector_2d(player->hurtbox.top_left);
-    printf("\nHurtbox Size: %.2f x %.2f\n", player->hurtbox.width, player->hurtbox.height);
+    print_vector_2d(FIGHTER_HURTBOX(player).top_left);
+    printf("\nHurtbox Size: %.2f x %.2f\n", FIGHTER_HURTBOX(player).width, FIGHTER_HURTBOX(player).height);
 
     printf("Sword Center: ");
     print_vector_2d(player->sword.pos);
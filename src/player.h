@@ -4,10 +4,17 @@
 #include "game_types.h"
 
 typedef struct PlayerInput PlayerInput;
+typedef struct FighterStore FighterStore;
 
-extern void player_init( PlayerState player, PlayerId id );
+// player must be bound to a FighterStore slot first (fighter_store_bind)
+extern void player_init( PlayerState player, PlayerId id, int character );
 extern void player_update( PlayerState player, PlayerInput input, double dt );
+extern void player_update_batch( FighterStore *store, PlayerInput const *inputs, double dt );
+extern void player_update_attachments( PlayerState player );
+extern void player_copy( PlayerState dest, struct PlayerState const *src );
 extern void player_set_death_state( PlayerState player );
+extern bool player_is_dead( PlayerState player );
+extern char const *player_state_name( FighterState state );
 extern void player_receive_dive_kick( PlayerState receiver, PlayerState attacker );
 extern void player_end_dive_kick( PlayerState player );
 extern void print_vector_2d( Vector_2D v );
@@ -0,0 +1,166 @@
+#include <stdbool.h>
+#include "projectile.h"
+#include "player.h"
+#include "combat.h"
+#include "sword.h"
+#include "roster.h"
+#include "game_types.h"
+#include "fighter_store.h"
+
+#define GROUND_LEVEL (SCREEN_SIZE_Y)
+
+static void launch( ProjectilePool *pool, PlayerState fighter, int owner );
+static void release( ProjectilePool *pool, int index );
+
+void projectile_pool_clear( ProjectilePool *pool )
+{
+    pool->count = 0;
+}
+
+/*
+ * Moves every projectile one tick, launches this tick's throws and writes each one back into its
+ * owner's Sword. Flying and falling swords get the same steps as the fighters' physics (move,
+ * walls, gravity, ground) - a wall takes the danger out of a throw and it drops where it hit.
+*/
+void projectile_pool_update( ProjectilePool *pool, FighterStore *fighters, double dt )
+{
+    for (int i = 0; i < pool->count; i++)
+    {
+        pool->prev_x[i] = pool->pos_x[i];
+        pool->prev_y[i] = pool->pos_y[i];
+        if (pool->flags[i] & PROJECTILE_GROUNDED)
+        {
+            continue;
+        }
+
+        double x = pool->pos_x[i] + pool->vel_x[i] * dt;
+        double y = pool->pos_y[i] + pool->vel_y[i] * dt;
+
+        double left_wall = pool->half_width[i];
+        double right_wall = SCREEN_SIZE_X - pool->half_width[i];
+        if (x < left_wall || x > right_wall)
+        {
+            x = (x < left_wall) ? left_wall : right_wall;
+            pool->vel_x[i] = 0.0;
+            pool->flags[i] &= ~PROJECTILE_FLYING;
+        }
+
+        pool->vel_y[i] += pool->gravity[i] * dt;
+
+        double ground = GROUND_LEVEL - pool->half_height[i];
+        if (y >= ground && pool->vel_y[i] > 0.0)
+        {
+            y = ground;
+            pool->vel_x[i] = 0.0;
+            pool->vel_y[i] = 0.0;
+            pool->flags[i] = PROJECTILE_GROUNDED;
+        }
+
+        pool->pos_x[i] = x;
+        pool->pos_y[i] = y;
+    }
+
+    for (int i = 0; i < fighters->count; i++)
+    {
+        if (fighters->players[i]->sword.internal.launching)
+        {
+            launch(pool, fighters->players[i], i);
+        }
+    }
+
+    for (int i = 0; i < pool->count; i++)
+    {
+        Sword *sword = &fighters->players[pool->owner[i]]->sword;
+        sword->pos = (Vector_2D) { pool->pos_x[i], pool->pos_y[i] };
+        sword->hitbox = projectile_box(pool, i);
+    }
+}
+
+// Grounded swords go back to their owners if they're standing on them - one check per projectile
+void projectile_pool_pick_up( ProjectilePool *pool, FighterStore *fighters )
+{
+    // Backwards, so the one moved into a released slot has already been checked
+    for (int i = pool->count - 1; i >= 0; i--)
+    {
+        PlayerState owner = fighters->players[pool->owner[i]];
+        if ((pool->flags[i] & PROJECTILE_GROUNDED) && !player_is_dead(owner)
+            && box_collision(fighters->hurtbox[pool->owner[i]], projectile_box(pool, i)))
+        {
+            owner->sword = sword_init(owner);
+            release(pool, i);
+        }
+    }
+}
+
+// Hit someone - it stops dead and falls, harmless from here on
+void projectile_pool_drop( ProjectilePool *pool, int index )
+{
+    pool->flags[index] &= ~PROJECTILE_FLYING;
+    pool->vel_x[index] = 0.0;
+}
+
+// For fighters reset with player_init while their sword is out (crowd respawns)
+void projectile_pool_release_owner( ProjectilePool *pool, int owner )
+{
+    for (int i = pool->count - 1; i >= 0; i--)
+    {
+        if (pool->owner[i] == owner)
+        {
+            release(pool, i);
+        }
+    }
+}
+
+Box projectile_box( ProjectilePool const *pool, int index )
+{
+    return (Box) {
+        .top_left = { pool->pos_x[index] - pool->half_width[index], pool->pos_y[index] - pool->half_height[index] },
+        .width = pool->half_width[index] * 2.0,
+        .height = pool->half_height[index] * 2.0,
+        .enabled = true
+    };
+}
+
+// Leaves the hand where the sword is held - a full pool means the sword never left it
+static void launch( ProjectilePool *pool, PlayerState fighter, int owner )
+{
+    Sword *sword = &fighter->sword;
+    sword->internal.launching = false;
+    if (pool->count == PROJECTILE_POOL_CAPACITY)
+    {
+        sword->thrown = false;
+        return;
+    }
+
+    FighterDef const *def = fighter->def;
+    double scale_factor = (fighter->is_right_facing) ? 1.0 : -1.0;
+    int i = pool->count++;
+    pool->pos_x[i] = FIGHTER_POS(fighter).x + scale_factor * def->sword_length / 2.0;
+    pool->pos_y[i] = FIGHTER_POS(fighter).y;
+    pool->prev_x[i] = pool->pos_x[i];
+    pool->prev_y[i] = pool->pos_y[i];
+    pool->vel_x[i] = scale_factor * def->throw_speed;
+    pool->vel_y[i] = -def->throw_lift;
+    pool->gravity[i] = def->throw_gravity;
+    pool->half_width[i] = def->sword_length / 2.0;
+    pool->half_height[i] = def->sword_width / 2.0;
+    pool->flags[i] = PROJECTILE_FLYING;
+    pool->owner[i] = owner;
+}
+
+// Last one fills the gap so [0, count) stays packed
+static void release( ProjectilePool *pool, int index )
+{
+    int last = --pool->count;
+    pool->pos_x[index] = pool->pos_x[last];
+    pool->pos_y[index] = pool->pos_y[last];
+    pool->prev_x[index] = pool->prev_x[last];
+    pool->prev_y[index] = pool->prev_y[last];
+    pool->vel_x[index] = pool->vel_x[last];
+    pool->vel_y[index] = pool->vel_y[last];
+    pool->gravity[index] = pool->gravity[last];
+    pool->half_width[index] = pool->half_width[last];
+    pool->half_height[index] = pool->half_height[last];
+    pool->flags[index] = pool->flags[last];
+    pool->owner[index] = pool->owner[last];
+}
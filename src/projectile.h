@@ -0,0 +1,55 @@
+#ifndef PROJECTILE_H
+#define PROJECTILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "game_types.h"
+
+/*
+ * Thrown swords. Every live projectile sits in one fixed size pool, one array per field and packed
+ * into [0, count) so projectile_pool_update integrates them all in one straight loop - a throw takes
+ * the next slot and a pickup moves the last one into the gap, so nothing is allocated or searched
+ * for per throw. When the pool is full the throw fizzles and the fighter keeps their sword.
+ *
+ * A projectile belongs to the fighter who threw it (owner, its slot in the FighterStore the match
+ * steps) and is written back into that fighter's Sword every tick, so the renderer, render
+ * snapshots and everything else that reads a Sword see it where it is. Only the owner can pick it up.
+ *
+ * Usage (match_step_fighters does this):
+ *   player_update_batch(&fighters, inputs, SIM_DT);   // A throw sets sword.internal.launching
+ *   projectile_pool_update(&pool, &fighters, SIM_DT);
+ *   combat_update(&fighters, &pool);
+ *   projectile_pool_pick_up(&pool, &fighters);
+*/
+
+// 1v1 needs 2 - a crowd throwing more than this at once has to wait
+#define PROJECTILE_POOL_CAPACITY 32
+
+#define PROJECTILE_FLYING   (1u << 0)   // Kills anything it touches - cleared when it hits a wall or a fighter
+#define PROJECTILE_GROUNDED (1u << 1)   // Lying on the ground waiting for its owner
+
+typedef struct FighterStore FighterStore;
+
+typedef struct ProjectilePool {
+    double pos_x[PROJECTILE_POOL_CAPACITY];     // Center of the sword
+    double pos_y[PROJECTILE_POOL_CAPACITY];
+    double prev_x[PROJECTILE_POOL_CAPACITY];    // Center at the previous tick (swept combat)
+    double prev_y[PROJECTILE_POOL_CAPACITY];
+    double vel_x[PROJECTILE_POOL_CAPACITY];
+    double vel_y[PROJECTILE_POOL_CAPACITY];
+    double gravity[PROJECTILE_POOL_CAPACITY];
+    double half_width[PROJECTILE_POOL_CAPACITY];
+    double half_height[PROJECTILE_POOL_CAPACITY];
+    uint32_t flags[PROJECTILE_POOL_CAPACITY];   // PROJECTILE_* bits
+    int owner[PROJECTILE_POOL_CAPACITY];
+    int count;
+} ProjectilePool;
+
+extern void projectile_pool_clear( ProjectilePool *pool );
+extern void projectile_pool_update( ProjectilePool *pool, FighterStore *fighters, double dt );
+extern void projectile_pool_pick_up( ProjectilePool *pool, FighterStore *fighters );
+extern void projectile_pool_drop( ProjectilePool *pool, int index );
+extern void projectile_pool_release_owner( ProjectilePool *pool, int owner );
+extern Box projectile_box( ProjectilePool const *pool, int index );
+
+#endif
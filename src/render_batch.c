@@ -0,0 +1,190 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "render_batch.h"
+
+// Quads are bucketed by layer then texture - one SDL_RenderGeometry per non empty bucket
+#define KEY_COUNT (LAYER_COUNT * RENDER_BATCH_MAX_TEXTURES)
+
+typedef struct {
+    SDL_Texture *texture;
+    float width;            // Pixels - UVs are fractions of these
+    float height;
+} TextureInfo;
+
+static TextureInfo textures[RENDER_BATCH_MAX_TEXTURES];    // [0] is the no texture entry
+static SoftImage images[RENDER_BATCH_MAX_TEXTURES];        // Same slots, software rendering only
+static int texture_count = 1;
+static bool software;
+
+static SDL_Renderer *target;
+static RenderQuad quads[RENDER_BATCH_MAX_QUADS];           // In the order they were added
+static int quad_count;
+
+static RenderQuad sorted[RENDER_BATCH_MAX_QUADS];
+static SDL_Vertex vertices[RENDER_BATCH_MAX_QUADS * 4];
+static int indices[RENDER_BATCH_MAX_QUADS * 6];             // Same for every bucket - two triangles per quad
+
+static int add_slot( void );
+static void push_quad( RenderQuad quad, RenderLayer layer );
+static void quad_vertices( RenderQuad const *quad, SDL_Vertex *vertex );
+
+RenderTexture render_batch_add_texture( SDL_Texture *texture )
+{
+    int width, height;
+    if (SDL_QueryTexture(texture, NULL, NULL, &width, &height) < 0)
+    {
+        fprintf(stderr, "Can't batch texture: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    int slot = add_slot();
+    textures[slot] = (TextureInfo) { texture, (float) width, (float) height };
+    return slot;
+}
+
+// Pixels the software renderer reads in place - they have to outlive the batch's use of them
+RenderTexture render_batch_add_image( SoftImage image )
+{
+    int slot = add_slot();
+    images[slot] = image;
+    textures[slot] = (TextureInfo) { NULL, (float) image.width, (float) image.height };
+    return slot;
+}
+
+// Every flush after this is drawn by soft_raster instead of the SDL renderer
+void render_batch_use_software( bool use_software )
+{
+    software = use_software;
+}
+
+// Before the textures are destroyed
+void render_batch_clear_textures( void )
+{
+    texture_count = 1;
+    quad_count = 0;
+}
+
+void render_batch_begin( SDL_Renderer *renderer )
+{
+    target = renderer;
+    quad_count = 0;
+
+    if (indices[5] == 0)
+    {
+        for (int i = 0; i < RENDER_BATCH_MAX_QUADS; i++)
+        {
+            int const corners[6] = { 0, 1, 2, 2, 1, 3 };
+            for (int c = 0; c < 6; c++)
+            {
+                indices[i * 6 + c] = i * 4 + corners[c];
+            }
+        }
+    }
+}
+
+// source is in texture pixels - flipped sprites just read it right to left
+void render_batch_sprite( RenderLayer layer, RenderTexture texture, SDL_Rect const *source,
+                          SDL_FRect const *destination, bool flip )
+{
+    SDL_Color white = { 255, 255, 255, 255 };
+    push_quad((RenderQuad) { *destination, *source, white, texture, flip, 0 }, layer);
+}
+
+void render_batch_rect( RenderLayer layer, SDL_FRect const *rect, SDL_Color color )
+{
+    push_quad((RenderQuad) { *rect, { 0, 0, 0, 0 }, color, 0, false, 0 }, layer);
+}
+
+/*
+ * Counting sort by key into sorted - stable, so each bucket keeps the order its quads were added in -
+ * then one draw call per bucket, or the whole lot to the software renderer back to front.
+*/
+void render_batch_flush( void )
+{
+    int first[KEY_COUNT + 1] = { 0 };
+    for (int q = 0; q < quad_count; q++)
+    {
+        first[quads[q].key + 1]++;
+    }
+    for (int k = 0; k < KEY_COUNT; k++)
+    {
+        first[k + 1] += first[k];
+    }
+
+    int next[KEY_COUNT];
+    memcpy(next, first, sizeof(next));
+    for (int q = 0; q < quad_count; q++)
+    {
+        sorted[next[quads[q].key]++] = quads[q];
+    }
+
+    if (software)
+    {
+        soft_raster_draw(sorted, quad_count, images);
+        quad_count = 0;
+        return;
+    }
+
+    for (int q = 0; q < quad_count; q++)
+    {
+        quad_vertices(&sorted[q], &vertices[q * 4]);
+    }
+    for (int k = 0; k < KEY_COUNT; k++)
+    {
+        int count = first[k + 1] - first[k];
+        if (count > 0)
+        {
+            SDL_Texture *texture = textures[k % RENDER_BATCH_MAX_TEXTURES].texture;
+            SDL_RenderGeometry(target, texture, &vertices[first[k] * 4], count * 4, indices, count * 6);
+        }
+    }
+    quad_count = 0;
+}
+
+// Exits if there's no room - the table is only meant for the handful of sheets the game loads
+static int add_slot( void )
+{
+    if (texture_count == RENDER_BATCH_MAX_TEXTURES)
+    {
+        fprintf(stderr, "Can't batch texture: too many\n");
+        exit(EXIT_FAILURE);
+    }
+    return texture_count++;
+}
+
+// A full batch is drawn there and then - anything added after it can end up under it
+static void push_quad( RenderQuad quad, RenderLayer layer )
+{
+    if (quad_count == RENDER_BATCH_MAX_QUADS)
+    {
+        render_batch_flush();
+    }
+    quad.key = (uint8_t) (layer * RENDER_BATCH_MAX_TEXTURES + quad.texture);
+    quads[quad_count++] = quad;
+}
+
+// UVs are fractions of the texture - flipping swaps the left and right ones
+static void quad_vertices( RenderQuad const *quad, SDL_Vertex *vertex )
+{
+    TextureInfo const *info = &textures[quad->texture];
+    float u0 = 0.0f, v0 = 0.0f, u1 = 0.0f, v1 = 0.0f;
+    if (quad->texture != 0)
+    {
+        float left = quad->source.x / info->width;
+        float right = (quad->source.x + quad->source.w) / info->width;
+        u0 = quad->flip ? right : left;
+        u1 = quad->flip ? left : right;
+        v0 = quad->source.y / info->height;
+        v1 = (quad->source.y + quad->source.h) / info->height;
+    }
+    SDL_FRect const *rect = &quad->destination;
+    float left = rect->x, right = rect->x + rect->w;
+    float top = rect->y, bottom = rect->y + rect->h;
+    vertex[0] = (SDL_Vertex) { { left, top }, quad->color, { u0, v0 } };
+    vertex[1] = (SDL_Vertex) { { right, top }, quad->color, { u1, v0 } };
+    vertex[2] = (SDL_Vertex) { { left, bottom }, quad->color, { u0, v1 } };
+    vertex[3] = (SDL_Vertex) { { right, bottom }, quad->color, { u1, v1 } };
+}
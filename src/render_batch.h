@@ -0,0 +1,59 @@
+#ifndef RENDER_BATCH_H
+#define RENDER_BATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include "soft_raster.h"
+
+/*
+ * Frame's worth of quads, submitted with one SDL_RenderGeometry per layer and texture instead of a
+ * draw call (and colour change) per rectangle. Layers are drawn in order and quads within a layer
+ * in the order they were added, grouped by texture - so a layer should only hold things that don't
+ * overlap or don't care which one ends up on top. Flipping swaps the quad's u coordinates.
+ * Fixed size, so adding quads never allocates - a full batch is flushed early.
+ * With render_batch_use_software the flush goes to the CPU renderer (soft_raster.h) instead, reading
+ * textures added with render_batch_add_image.
+ *
+ * Usage:
+ *   RenderTexture sheet = render_batch_add_texture(texture);   // Once at startup
+ *   render_batch_begin(renderer);
+ *   render_batch_sprite(LAYER_FIGHTERS, sheet, &source, &destination, flip);
+ *   render_batch_rect(LAYER_DEBUG_BOXES, &rect, (SDL_Color) { 255, 0, 0, 255 });
+ *   render_batch_flush();    // Then SDL_RenderPresent
+*/
+
+#define RENDER_BATCH_MAX_QUADS 1024
+#define RENDER_BATCH_MAX_TEXTURES 8
+
+// Back to front
+typedef enum {
+    LAYER_BACKGROUND,
+    LAYER_DEBUG_BOXES,      // Hurtboxes and dive kick hitboxes
+    LAYER_FIGHTERS,
+    LAYER_SWORDS,
+    LAYER_COUNT
+} RenderLayer;
+
+typedef int RenderTexture;      // 0 is no texture - plain coloured quads
+
+typedef struct RenderQuad {
+    SDL_FRect destination;
+    SDL_Rect source;        // Texture pixels
+    SDL_Color color;        // Plain quads only - textured ones are drawn as they are
+    RenderTexture texture;
+    bool flip;
+    uint8_t key;            // Layer and texture - what the flush sorts by
+} RenderQuad;
+
+extern RenderTexture render_batch_add_texture( SDL_Texture *texture );
+extern RenderTexture render_batch_add_image( SoftImage image );
+extern void render_batch_use_software( bool software );
+extern void render_batch_clear_textures( void );
+extern void render_batch_begin( SDL_Renderer *renderer );
+extern void render_batch_sprite( RenderLayer layer, RenderTexture texture, SDL_Rect const *source,
+                                 SDL_FRect const *destination, bool flip );
+extern void render_batch_rect( RenderLayer layer, SDL_FRect const *rect, SDL_Color color );
+extern void render_batch_flush( void );
+
+#endif
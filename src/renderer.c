@@ -2,58 +2,32 @@
 #include <assert.h>
 #include <stdio.h>
 #include <SDL2/SDL.h>
-#include <SDL_image.h>
 #include "renderer.h"
 #include "game_types.h"
-#include "sword.h"
+#include "animation.h"
+#include "render_batch.h"
+#include "atlas.h"
+#include "pack.h"
+#include "asset_loader.h"
+#include "clock.h"
+#include "soft_raster.h"
+#include "fighter_store.h"
 
 #define BACKGROUND_FRAMES 11
 #define TIME_PER_BACKGROUND 0.1
-#define DEFAULT_TIME_PER_FRAME 0.1
-#define DEATH_TIME_PER_FRAME 0.4
-#define NO_ROWS 20
-#define MAX_COLS 9
-#define CROUCH_ROW 0
-#define KICK_ROW 1
-#define KICK_DISARMED_ROW 2
-#define HIGH_ATTACK_ROW 3
-#define MIDDLE_ATTACK_ROW 4
-#define LOW_ATTACK_ROW 5
-#define DEATH_ROW 6
-#define DEATH_DISARMED_ROW 7
-#define FALL_ROW 8
-#define FALL_DISARMED_ROW 9
-#define IDLE_LOW_ROW 10
-#define IDLE_DISARMED_ROW 11
-#define IDLE_HIGH_ROW 12
-#define IDLE_MIDDLE_ROW 13
-#define JUMP_ROW 14
-#define JUMP_DISARMED_ROW 15
-#define RUN_ROW 16
-#define RUN_DISARMED_ROW 17
-#define STUNNED_ROW 18
-#define THROW_ROW 19
-#define FRAMES_CROUCH 1
-#define FRAMES_STUN 6
-#define FRAMES_THROW 5
-#define FRAMES_ATTACK 4
-#define FRAMES_DEATH 9
-#define FRAMES_JUMP 2
-#define FRAMES_IDLE 6
-#define FRAMES_FALL 2
-#define FRAMES_RUN 8
-#define FRAMES_KICK 2
 #define SPRITE_WIDTH_SCALE 8
 #define SPRITE_HEIGHT_SCALE 2
-#define SPRITE_TOP_PADDING 0
-#define SPRITE_SIDE_PADDING 0
 #define RIGHT_OFFSET 10
 #define LEFT_OFFSET -10
 #define TOP_OFFSET 30
+#define UPLOAD_BUDGET_NS 2000000ULL     // Texture uploads per frame, once the first one is done
+#define LOADING_BAR_WIDTH 480.0f
+#define LOADING_BAR_HEIGHT 16.0f
 
 typedef struct {
     SDL_Window *window;
     SDL_Renderer *renderer;
+    bool software;          // Drawn on the CPU by soft_raster - no GPU textures at all
 } Game;
 
 Game game = {
@@ -64,23 +38,64 @@ Game game = {
 typedef struct {
     SDL_Rect rect;
     SDL_Texture *spritesheet_image;
+    RenderTexture batch_texture;
 } Spritesheet;
 
-static Spritesheet player_sprite;
+// Part of a texture waiting for its pixels - one per asset loader region, in the same order
+typedef struct {
+    Spritesheet *sheet;
+    PackEntry const *image;
+    SDL_Rect rect;
+    bool uploaded;
+} Upload;
+
+// Everything is drawn through the frame's render batch (render_batch.h)
+static SDL_Color const HURTBOX_COLOUR = { 255, 0, 0, 255 };
+static SDL_Color const HITBOX_COLOUR = { 0, 255, 0, 255 };
+static SDL_Color const LOADING_TRACK_COLOUR = { 64, 64, 64, 255 };
+static SDL_Color const LOADING_BAR_COLOUR = { 255, 255, 255, 255 };
+
+static Spritesheet player_sprite;      // Packed fighter frames, cut up by player_atlas
+static Atlas player_atlas;
 static Spritesheet background;
 static double background_state = 0;
 
-static void renderer_draw_player_hitbox( PlayerState player );
-static void renderer_draw_sword( PlayerState player );
-static Spritesheet create_spritesheet( char const *path, int rows, int columns );
-static void draw_sprite( Spritesheet spritesheet, SDL_Rect *position, int row, int column, bool flip );
-static int state_select( PlayerState player );
-static void update_player_frame( PlayerState player, double dt );
+/*
+ * Textures are created empty at startup and filled in as the asset loader gets their part of the pack
+ * into memory - the fighter sprites first, then the background a frame at a time. The pack stays
+ * mapped until renderer_clean.
+*/
+static struct {
+    AssetLoader loader;
+    Upload uploads[1 + BACKGROUND_FRAMES];
+    int count;
+    int uploaded;
+    size_t bytes;
+    size_t uploaded_bytes;
+} loading;
+
+static void renderer_draw_player_hitbox( PlayerState player, Vector_2D offset );
+static void renderer_draw_sword( PlayerState player, Vector_2D offset );
+static void open_pack( void );
+static Spritesheet create_spritesheet( char const *name, int rows, int columns );
+static void queue_upload( Spritesheet *sheet, char const *name, SDL_Rect rect );
+static void upload( Upload *queued );
+static void draw_sprite( Spritesheet spritesheet, Atlas const *atlas, SDL_Rect *position, int row, int column, bool flip );
+
+#ifdef EMBED_ASSETS
+extern unsigned char const pack_embedded[];        // pack_embed.S
+extern unsigned char const pack_embedded_end[];
+#endif
 
 static double PLAYER_NORMAL_HEIGHT;
 static double PLAYER_NORMAL_WIDTH;
 
-void renderer_init( void ) 
+/*
+ * Usage: renderer_init(software)
+ * software draws every frame on the CPU (soft_raster.h) and only hands SDL the finished frame - for
+ * machines without a usable GPU. Setting LIBGL_ALWAYS_SOFTWARE turns it on too
+*/
+void renderer_init( bool software ) 
 {
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO ) < 0)
     {
@@ -91,18 +106,45 @@ void renderer_init( void )
     game.window = SDL_CreateWindow("Extension group project", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_SIZE_X, SCREEN_SIZE_Y, SDL_WINDOW_SHOWN);
     assert(game.window != NULL);
     
-    game.renderer = SDL_CreateRenderer(game.window, -1, SDL_RENDERER_ACCELERATED);
+    game.software = software || SDL_getenv("LIBGL_ALWAYS_SOFTWARE") != NULL;
+    game.renderer = SDL_CreateRenderer(game.window, -1, game.software ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED);
+    if (!game.renderer || (game.software && !soft_raster_start(game.renderer, SCREEN_SIZE_X, SCREEN_SIZE_Y)))
+    {
+        fprintf(stderr, "Could not create renderer: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    render_batch_use_software(game.software);
     SDL_RenderClear(game.renderer);
     
-    IMG_InitFlags imgFlags = IMG_INIT_PNG;
-    if(!(IMG_Init( imgFlags ) & imgFlags))
+    // Only the atlas table is read here - every texture is filled in by renderer_load_assets
+    open_pack();
+    PackEntry const *atlas = pack_find("atlas");
+    if (!atlas || !atlas_read(&player_atlas, pack_data(atlas), atlas->size, "atlas in the asset pack"))
     {
-        printf("SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
+        exit(EXIT_FAILURE);
     }
+    player_sprite = create_spritesheet("sprites", 1, 1);
+    background = create_spritesheet("background", 1, BACKGROUND_FRAMES);
 
-    player_sprite = create_spritesheet("../assets/spritesheet.png", NO_ROWS, MAX_COLS);
-
-    background = create_spritesheet("../assets/background.png", 1, BACKGROUND_FRAMES);
+    queue_upload(&player_sprite, "sprites", player_sprite.rect);
+    for (int frame = 0; frame < BACKGROUND_FRAMES; frame++)
+    {
+        SDL_Rect rect = background.rect;
+        rect.x = frame * rect.w;
+        queue_upload(&background, "background", rect);
+    }
+    AssetRegion regions[1 + BACKGROUND_FRAMES];
+    for (int i = 0; i < loading.count; i++)
+    {
+        Upload const *queued = &loading.uploads[i];
+        regions[i] = (AssetRegion) {
+            .data = (unsigned char const *) pack_data(queued->image) + (size_t) queued->rect.y * queued->image->pitch + (size_t) queued->rect.x * 4,
+            .row_size = (size_t) queued->rect.w * 4,
+            .pitch = queued->image->pitch,
+            .rows = queued->rect.h
+        };
+    }
+    loading.loader = asset_loader_start(regions, loading.count, SDL_GetCPUCount());
     
     SDL_UpdateWindowSurface(game.window);
 }
@@ -113,40 +155,101 @@ void renderer_set_player_size( double height, double width )
     PLAYER_NORMAL_WIDTH = width;
 }
 
+/*
+ * Usage: progress = renderer_load_assets()
+ * Uploads whatever the asset loader has ready, for up to UPLOAD_BUDGET_NS, and returns how much of
+ * the pack (0 to 1) is on the GPU - call every frame before drawing, it does nothing once done
+*/
+double renderer_load_assets( void )
+{
+    uint64_t start_ns = clock_now_ns();
+    for (int i = 0; i < loading.count && loading.uploaded < loading.count; i++)
+    {
+        Upload *queued = &loading.uploads[i];
+        if (queued->uploaded || !asset_loader_ready(loading.loader, i))
+        {
+            continue;
+        }
+        if (clock_now_ns() - start_ns > UPLOAD_BUDGET_NS)
+        {
+            break;
+        }
+        upload(queued);
+    }
+    return (loading.bytes > 0) ? (double) loading.uploaded_bytes / (double) loading.bytes : 1.0;
+}
+
+// The match can start once the fighters can be drawn - the background may still be streaming in
+bool renderer_fighters_loaded( void )
+{
+    return loading.uploads[0].uploaded;
+}
+
+// Boot screen - a bar across the middle of the screen filled to progress
+void renderer_draw_loading( double progress )
+{
+    SDL_FRect track = {
+        (SCREEN_SIZE_X - LOADING_BAR_WIDTH) / 2.0f,
+        (SCREEN_SIZE_Y - LOADING_BAR_HEIGHT) / 2.0f,
+        LOADING_BAR_WIDTH,
+        LOADING_BAR_HEIGHT
+    };
+    SDL_FRect bar = track;
+    bar.w = (float) (LOADING_BAR_WIDTH * progress);
+    render_batch_rect(LAYER_BACKGROUND, &track, LOADING_TRACK_COLOUR);
+    render_batch_rect(LAYER_FIGHTERS, &bar, LOADING_BAR_COLOUR);
+}
+
 void renderer_begin_frame( void )
 {
-    SDL_SetRenderDrawColor(game.renderer, 0, 0, 0, 255);
-    SDL_RenderClear(game.renderer);
+    if (game.software)
+    {
+        soft_raster_clear();
+    }
+    else
+    {
+        SDL_SetRenderDrawColor(game.renderer, 0, 0, 0, 255);
+        SDL_RenderClear(game.renderer);
+    }
+    render_batch_begin(game.renderer);
 }
 
-void renderer_draw_player( PlayerState player, double dt )
+/*
+ * Usage: renderer_draw_player(player, alpha, dt)
+ * alpha is how far (0 to 1) we are between the previous and current simulation tick,
+ * everything attached to the player is drawn offset to the interpolated position
+*/
+void renderer_draw_player( PlayerState player, double alpha, double dt )
 {
-    SDL_Rect hurtbox_rect = {
-        player->hurtbox.top_left.x,
-        player->hurtbox.top_left.y,
-        player->hurtbox.width,
-        player->hurtbox.height
+    Vector_2D offset = {
+        (FIGHTER_PREV_POS(player).x - FIGHTER_POS(player).x) * (1.0 - alpha),
+        (FIGHTER_PREV_POS(player).y - FIGHTER_POS(player).y) * (1.0 - alpha)
+    };
+
+    SDL_FRect hurtbox_rect = {
+        FIGHTER_HURTBOX(player).top_left.x + offset.x,
+        FIGHTER_HURTBOX(player).top_left.y + offset.y,
+        FIGHTER_HURTBOX(player).width,
+        FIGHTER_HURTBOX(player).height
     };
-    SDL_SetRenderDrawColor(game.renderer, 255, 0, 0, 255);
-    SDL_RenderFillRect(game.renderer, &hurtbox_rect);
+    render_batch_rect(LAYER_DEBUG_BOXES, &hurtbox_rect, HURTBOX_COLOUR);
     
-    renderer_draw_player_hitbox(player);   
+    renderer_draw_player_hitbox(player, offset);   
 
-    update_player_frame(player, dt);
+    animation_update_frame(player, dt);
     SDL_Rect sprite_rect = {   
-            player->pos.x, 
-            player->pos.y, 
+            FIGHTER_POS(player).x + offset.x, 
+            FIGHTER_POS(player).y + offset.y, 
             PLAYER_NORMAL_WIDTH,
             PLAYER_NORMAL_HEIGHT
         };
 
-    // Only non-kick attacks have special animations
-    int current_frame = (player->is_attacking && !player->is_jumping) ? sword_get_frame(player) : player->time_in_anim / ((player->is_dead) ? DEATH_TIME_PER_FRAME : DEFAULT_TIME_PER_FRAME);
-    draw_sprite(player_sprite, &sprite_rect, state_select(player), current_frame , !player->is_right_facing);
+    draw_sprite(player_sprite, &player_atlas, &sprite_rect, player->anim_row, animation_current_frame(player), !player->is_right_facing);
     
     //TODO() we check here and in function??
     if( player->sword.hitbox.enabled ) {
-        renderer_draw_sword(player);
+        // A thrown sword doesn't move with its owner - drawn where the sim last put it
+        renderer_draw_sword(player, player->sword.thrown ? (Vector_2D) { 0.0, 0.0 } : offset);
     }
 }
 
@@ -166,169 +269,56 @@ bool SDL_event_handler( void )
     return quit;
 }
 
-static void update_player_frame( PlayerState player, double dt )
-{
-    int max_frames = 0;
-    bool no_loop = false;
-    double time_per_frame = DEFAULT_TIME_PER_FRAME;
-    switch (state_select(player))
-    {
-        case JUMP_ROW:
-        case JUMP_DISARMED_ROW:
-            max_frames = FRAMES_JUMP;
-            break;
-        case FALL_ROW:
-        case FALL_DISARMED_ROW:
-            max_frames = FRAMES_FALL;
-            break;
-        case RUN_ROW:
-        case RUN_DISARMED_ROW:
-            max_frames = FRAMES_RUN;
-            break;
-        case IDLE_MIDDLE_ROW:
-        case IDLE_HIGH_ROW:
-        case IDLE_LOW_ROW:
-        case IDLE_DISARMED_ROW:
-            max_frames = FRAMES_IDLE;
-            break;
-        case HIGH_ATTACK_ROW:
-        case MIDDLE_ATTACK_ROW:
-        case LOW_ATTACK_ROW:
-            max_frames = FRAMES_ATTACK;
-            no_loop = true;
-            break;
-        case DEATH_ROW:
-        case DEATH_DISARMED_ROW:
-            max_frames = FRAMES_DEATH;
-            no_loop = true;
-            time_per_frame = DEATH_TIME_PER_FRAME;
-            break;
-        case CROUCH_ROW:
-            max_frames = FRAMES_CROUCH;
-            break;
-        case STUNNED_ROW:
-            max_frames = FRAMES_STUN;
-            break;
-        case THROW_ROW:
-            max_frames = FRAMES_THROW;
-            break;
-        case KICK_ROW:
-        case KICK_DISARMED_ROW:
-            printf("In kick state, frame %f\n", player->time_in_anim / time_per_frame);
-            max_frames = FRAMES_KICK;
-            break;
-        default:
-            fprintf(stderr, "Player is in invalid state!!\n");
-    }
-    assert(max_frames != 0);
-    player->time_in_anim += dt;
-    if ((player->time_in_anim / time_per_frame) >= max_frames)
-    {
-        if (no_loop)
-        {
-            player->time_in_anim -= dt; 
-        } else
-        {
-            player->time_in_anim = 0;
-        }
-    }
-}
-
-static int state_select( PlayerState player )
-{
-    if (player->is_dead)
-    {
-        return DEATH_ROW;
-    }
-    if (player->is_jumping)
-    {
-        if (player->is_attacking)
-        {
-            return KICK_ROW;
-        }
-        else if (player->vel.y < 0.0)
-        {
-            return JUMP_ROW;
-        }
-        else
-        {
-            return FALL_ROW;
-        }
-    }
-    if (player->in_stunned_state)
-    {
-        return STUNNED_ROW;
-    }
-    if (player->is_crouching)
-    {
-        return CROUCH_ROW;
-    }
-    if (player->vel.x != 0.0)
-    {
-        return RUN_ROW;
-    }
-    if (player->is_attacking)
-    {
-        switch (player->stance)
-        {
-            case HIGH:
-                return HIGH_ATTACK_ROW;
-            case MIDDLE:
-                return MIDDLE_ATTACK_ROW;
-            case LOW:
-                return LOW_ATTACK_ROW;
-        }
-    }
-    switch (player->stance)
-    {
-        case HIGH:
-            return IDLE_HIGH_ROW;
-        case MIDDLE:
-            return IDLE_MIDDLE_ROW;
-        case LOW:
-            return IDLE_LOW_ROW;
-        default:
-            fprintf(stderr, "Invalid stance");
-            return 0;
-    }
-}
-
-static void renderer_draw_player_hitbox( PlayerState player )
+static void renderer_draw_player_hitbox( PlayerState player, Vector_2D offset )
 {
     if (player->hitbox.enabled)
     {
-        SDL_Rect rect = { player->hitbox.top_left.x, 
-        player->hitbox.top_left.y,
+        SDL_FRect rect = { player->hitbox.top_left.x + offset.x, 
+        player->hitbox.top_left.y + offset.y,
         player->hitbox.width, player->hitbox.height
         };
-        //printf("Draw: x:%i, y: %i, w: %i, h, %i\n", rect.x, rect.y, rect.w, rect.h);
-        SDL_SetRenderDrawColor(game.renderer, 0, 255, 0, 255);
-        SDL_RenderFillRect(game.renderer, &rect);
+        render_batch_rect(LAYER_DEBUG_BOXES, &rect, HITBOX_COLOUR);
     }
 }
 
 
-static void renderer_draw_sword( PlayerState player )
+static void renderer_draw_sword( PlayerState player, Vector_2D offset )
 {
     if (player->sword.hitbox.enabled)
     {
-        SDL_Rect rect = { player->sword.hitbox.top_left.x, 
-        player->sword.hitbox.top_left.y,
+        SDL_FRect rect = { player->sword.hitbox.top_left.x + offset.x, 
+        player->sword.hitbox.top_left.y + offset.y,
         player->sword.hitbox.width, player->sword.hitbox.height
         };
-        //printf("Draw: x:%i, y: %i, w: %i, h, %i\n", rect.x, rect.y, rect.w, rect.h);
-        SDL_SetRenderDrawColor(game.renderer, 0, 255, 0, 255);
-        SDL_RenderFillRect(game.renderer, &rect);
+        render_batch_rect(LAYER_SWORDS, &rect, HITBOX_COLOUR);
     }
 }
 
 void renderer_end_frame( void )
 {
+    render_batch_flush();
+    if (game.software)
+    {
+        soft_raster_present();
+    }
     SDL_RenderPresent(game.renderer);
 }
 
 void renderer_clean( void )
 {
+    // Workers may still be reading the pack if we quit while loading
+    if (loading.loader)
+    {
+        asset_loader_stop(loading.loader);
+        loading.loader = NULL;
+    }
+    if (game.software)
+    {
+        soft_raster_stop();
+    }
+    pack_close();
+    render_batch_clear_textures();
+
     if (player_sprite.spritesheet_image) {
         SDL_DestroyTexture(player_sprite.spritesheet_image);
         player_sprite.spritesheet_image = NULL;
@@ -350,52 +340,115 @@ void renderer_clean( void )
     }
     SDL_GL_UnloadLibrary();
 
-    IMG_Quit();
     SDL_Quit();
 }
 
-static Spritesheet create_spritesheet( char const *path, int rows, int columns )
+static void open_pack( void )
+{
+#ifdef EMBED_ASSETS
+    bool opened = pack_open_memory(pack_embedded, (size_t) (pack_embedded_end - pack_embedded), "main");
+#else
+    bool opened = pack_open(pack_path(PACK_PATH));
+#endif
+    if (!opened)
+    {
+        fprintf(stderr, "No usable asset pack - build it with make assets\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Empty until renderer_load_assets uploads its pixels - already in the texture's format, so SDL only
+// converts them if this renderer can't take it
+static Spritesheet create_spritesheet( char const *name, int rows, int columns )
 {
-    SDL_Surface *surface = IMG_Load( path );
-    if (!surface)
+    PackEntry const *image = pack_find(name);
+    if (!image || image->kind != PACK_IMAGE)
     {
-        fprintf(stderr, "Failed surface load\n");
+        fprintf(stderr, "Asset pack has no %s image - rebuild it with make assets\n", name);
         exit(EXIT_FAILURE);
     }
 
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(game.renderer, surface);
+    // The software renderer reads the pack where it's mapped - the loader still gates what's drawn
+    if (game.software)
+    {
+        if (image->format != SDL_PIXELFORMAT_ARGB8888)
+        {
+            fprintf(stderr, "The software renderer needs %s in argb8888 - make assets PACK_FORMAT=argb8888\n", name);
+            exit(EXIT_FAILURE);
+        }
+        SoftImage pixels = { pack_data(image), image->width, image->height, image->pitch / 4 };
+        return (Spritesheet) {
+            .batch_texture = render_batch_add_image(pixels),
+            .rect = { .w = image->width / columns, .h = image->height / rows }
+        };
+    }
+
+    SDL_Texture *texture = SDL_CreateTexture(game.renderer, image->format, SDL_TEXTUREACCESS_STATIC, image->width, image->height);
     if (!texture)
     {
-        fprintf(stderr, "Failed texture load\n");
+        fprintf(stderr, "Failed texture load: %s\n", SDL_GetError());
         exit(EXIT_FAILURE);
     }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    SDL_RendererInfo info;
+    bool native = false;
+    for (Uint32 i = 0; SDL_GetRendererInfo(game.renderer, &info) == 0 && i < info.num_texture_formats; i++)
+    {
+        native = native || info.texture_formats[i] == image->format;
+    }
+    if (!native)
+    {
+        fprintf(stderr, "%s is converted on upload - make assets PACK_FORMAT=<argb8888|abgr8888> to match this renderer\n", name);
+    }
 
     Spritesheet new = {
         .spritesheet_image = texture,
+        .batch_texture = render_batch_add_texture(texture),
         .rect = {
-            .w = surface->w / columns,
-            .h = surface->h / rows,
+            .w = image->width / columns,
+            .h = image->height / rows,
         }
     };
-    SDL_FreeSurface(surface);
 
     return new;
 }
 
+static void queue_upload( Spritesheet *sheet, char const *name, SDL_Rect rect )
+{
+    assert(loading.count < (int) (sizeof(loading.uploads) / sizeof(loading.uploads[0])));
+    loading.uploads[loading.count++] = (Upload) { sheet, pack_find(name), rect, false };
+    loading.bytes += (size_t) rect.w * rect.h * 4;
+}
+
+static void upload( Upload *queued )
+{
+    PackEntry const *image = queued->image;
+    unsigned char const *pixels = (unsigned char const *) pack_data(image) + (size_t) queued->rect.y * image->pitch + (size_t) queued->rect.x * 4;
+    if (!game.software && SDL_UpdateTexture(queued->sheet->spritesheet_image, &queued->rect, pixels, image->pitch) != 0)
+    {
+        fprintf(stderr, "Failed texture load: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    queued->uploaded = true;
+    loading.uploaded++;
+    loading.uploaded_bytes += (size_t) queued->rect.w * queued->rect.h * 4;
+}
+
 /*
- * Usage: draw_sprite(spritesheet, position, player_state_row, frame, flip)
+ * Usage: draw_sprite(spritesheet, atlas, position, player_state_row, frame, flip)
  * Draws sprite at given rect (center) position and size, at given frame number, with
- * boolean at end telling whether to flip sprite
+ * boolean at end telling whether to flip sprite (its u coordinates are swapped, no RenderCopyEx).
+ * The whole cell is placed as it always was and only its trimmed pixels are drawn inside it
 */
-static void draw_sprite( Spritesheet spritesheet, SDL_Rect *position, int row, int column, bool flip )
+static void draw_sprite( Spritesheet spritesheet, Atlas const *atlas, SDL_Rect *position, int row, int column, bool flip )
 {
-    SDL_Rect sheet_rect = {
-        .w = spritesheet.rect.w - 2 * SPRITE_SIDE_PADDING,
-        .h = spritesheet.rect.h - 2 * SPRITE_TOP_PADDING,
-        .x = column * spritesheet.rect.w + SPRITE_SIDE_PADDING,
-        .y = row * spritesheet.rect.h + SPRITE_TOP_PADDING
-    };
-    
+    AtlasFrame const *frame = atlas_frame(atlas, row, column);
+    if (!frame)
+    {
+        return;     // Nothing in this cell
+    }
+
     SDL_Rect draw_rect = {
         .w = position->w * SPRITE_WIDTH_SCALE,
         .h = position->h * SPRITE_HEIGHT_SCALE,
@@ -403,7 +456,25 @@ static void draw_sprite( Spritesheet spritesheet, SDL_Rect *position, int row, i
         .y = position->y - (position->h * (SPRITE_HEIGHT_SCALE - 1.0 / 2.0) - TOP_OFFSET ) 
     };
 
-    SDL_RenderCopyEx(game.renderer, spritesheet.spritesheet_image, &sheet_rect, &draw_rect, 0, NULL, flip ? SDL_FLIP_HORIZONTAL : SDL_FLIP_NONE);
+    float scale_x = (float) draw_rect.w / atlas->header.cell_width;
+    float scale_y = (float) draw_rect.h / atlas->header.cell_height;
+    int offset_x = flip ? atlas->header.cell_width - frame->offset_x - frame->w : frame->offset_x;
+    SDL_FRect destination = {
+        draw_rect.x + offset_x * scale_x,
+        draw_rect.y + frame->offset_y * scale_y,
+        frame->w * scale_x,
+        frame->h * scale_y
+    };
+
+    // Baked mirror copies are read as they are instead of flipped
+    bool baked = flip && (atlas->header.flags & ATLAS_FLIPPED);
+    SDL_Rect sheet_rect = {
+        .x = baked ? frame->flipped_x : frame->x,
+        .y = baked ? frame->flipped_y : frame->y,
+        .w = frame->w,
+        .h = frame->h
+    };
+    render_batch_sprite(LAYER_FIGHTERS, spritesheet.batch_texture, &sheet_rect, &destination, flip && !baked);
 }
 
 static void render_background( Spritesheet spritesheet, int frame )
@@ -411,7 +482,19 @@ static void render_background( Spritesheet spritesheet, int frame )
     spritesheet.rect.x = spritesheet.rect.w * frame;
     spritesheet.rect.y = 0; // Frames are all horizontal
 
-    SDL_RenderCopy(game.renderer, spritesheet.spritesheet_image, &spritesheet.rect, NULL);
+    SDL_FRect screen = { 0.0f, 0.0f, SCREEN_SIZE_X, SCREEN_SIZE_Y };
+    render_batch_sprite(LAYER_BACKGROUND, spritesheet.batch_texture, &spritesheet.rect, &screen, false);
+}
+
+// Background animation is render state but still gets saved in game snapshots
+double renderer_get_background_state( void )
+{
+    return background_state;
+}
+
+void renderer_set_background_state( double state )
+{
+    background_state = state;
 }
 
 void renderer_draw_background( double dt )
@@ -421,5 +504,15 @@ void renderer_draw_background( double dt )
     {
         background_state = 0;
     }
-    render_background( background, (background_state / TIME_PER_BACKGROUND) );
+    // Frames still streaming in are stood in for by the nearest one before them that has arrived
+    int frame = background_state / TIME_PER_BACKGROUND;
+    for (int i = 0; i < BACKGROUND_FRAMES; i++)
+    {
+        int candidate = (frame - i + BACKGROUND_FRAMES) % BACKGROUND_FRAMES;
+        if (loading.uploads[1 + candidate].uploaded)
+        {
+            render_background(background, candidate);
+            break;
+        }
+    }
 }
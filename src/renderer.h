@@ -3,13 +3,18 @@
 
 #include "game_types.h"
 
-void renderer_init( void );
+void renderer_init( bool software );
 void renderer_set_player_size( double height, double width );
+double renderer_load_assets( void );
+bool renderer_fighters_loaded( void );
+void renderer_draw_loading( double progress );
 void renderer_begin_frame( void );
-void renderer_draw_player( PlayerState player, double dt );
+void renderer_draw_player( PlayerState player, double alpha, double dt );
 void renderer_end_frame( void );
 void renderer_clean( void );
 void renderer_draw_background( double dt );
+double renderer_get_background_state( void );
+void renderer_set_background_state( double state );
 bool SDL_event_handler( void );
 
 #endif
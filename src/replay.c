@@ -0,0 +1,231 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "replay.h"
+#include "input.h"
+#include "match.h"
+#include "snapshot.h"
+#include "roster.h"
+#include "game_types.h"
+
+// Set by the Makefile to the git commit - playback warns if it differs from the recording
+#ifndef BUILD_ID
+#define BUILD_ID "unknown"
+#endif
+
+#define REPLAY_MAGIC 0x50524641u     // "AFRP"
+#define REPLAY_VERSION 2
+#define BUILD_ID_LENGTH 32
+#define REPLAY_BUFFER_SIZE 4096
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t tick_rate;
+    uint32_t hash_interval;
+    uint16_t characters[2];     // Roster index of each player
+    uint64_t roster_hash;       // roster_hash() of the roster they were recorded with
+    char build_id[BUILD_ID_LENGTH];
+} ReplayHeader;
+
+struct Replay {
+    FILE *file;
+    bool writing;
+    uint32_t hash_interval;
+    int characters[2];
+    uint64_t tick;          // Ticks recorded/played so far
+    uint64_t mismatch_tick; // First tick whose hash didn't match, 0 while they all have
+    char buffer[REPLAY_BUFFER_SIZE];    // stdio's buffer - ours so the first tick recorded or read doesn't malloc one
+};
+
+static bool write_input( FILE *file, PlayerInput input );
+static bool read_input( FILE *file, PlayerInput *input );
+
+//NOTE: must be closed with replay_close - returns NULL if the file can't be created
+Replay replay_open_write( char const *path, uint32_t hash_interval, int p1_character, int p2_character )
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Could not create replay %s\n", path);
+        return NULL;
+    }
+    Replay replay = calloc(1, sizeof(struct Replay));
+    assert(replay != NULL);
+    setvbuf(file, replay->buffer, _IOFBF, sizeof(replay->buffer));
+
+    ReplayHeader header = {
+        .magic = REPLAY_MAGIC,
+        .version = REPLAY_VERSION,
+        .tick_rate = SIM_TICK_RATE,
+        .hash_interval = (hash_interval == 0) ? REPLAY_DEFAULT_HASH_INTERVAL : hash_interval,
+        .characters = { (uint16_t) p1_character, (uint16_t) p2_character },
+        .roster_hash = roster_hash()
+    };
+    strncpy(header.build_id, BUILD_ID, BUILD_ID_LENGTH - 1);
+    fwrite(&header, sizeof(header), 1, file);
+
+    replay->file = file;
+    replay->writing = true;
+    replay->hash_interval = header.hash_interval;
+    replay->characters[PLAYER_1] = p1_character;
+    replay->characters[PLAYER_2] = p2_character;
+    return replay;
+}
+
+// Call after match_step with the inputs that were given to it
+void replay_record_tick( Replay replay, PlayerInput p1_input, PlayerInput p2_input, Match match )
+{
+    write_input(replay->file, p1_input);
+    write_input(replay->file, p2_input);
+    replay->tick++;
+
+    if (replay->tick % replay->hash_interval == 0)
+    {
+        uint64_t hash = match_hash(match);
+        fwrite(&hash, sizeof(hash), 1, replay->file);
+    }
+}
+
+//NOTE: must be closed with replay_close - returns NULL if the file isn't a replay this build and roster can play
+Replay replay_open_read( char const *path )
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Could not open replay %s\n", path);
+        return NULL;
+    }
+    Replay replay = calloc(1, sizeof(struct Replay));
+    assert(replay != NULL);
+    setvbuf(file, replay->buffer, _IOFBF, sizeof(replay->buffer));
+
+    ReplayHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != REPLAY_MAGIC)
+    {
+        fprintf(stderr, "%s is not a replay file\n", path);
+        fclose(file);
+        free(replay);
+        return NULL;
+    }
+    if (header.version != REPLAY_VERSION)
+    {
+        fprintf(stderr, "%s is a version %u replay, this build plays version %d\n", path, header.version, REPLAY_VERSION);
+        fclose(file);
+        free(replay);
+        return NULL;
+    }
+    if (header.tick_rate != SIM_TICK_RATE || header.hash_interval == 0)
+    {
+        fprintf(stderr, "%s was recorded at %u ticks/s, this build runs at %d\n", path, header.tick_rate, SIM_TICK_RATE);
+        fclose(file);
+        free(replay);
+        return NULL;
+    }
+    // Other fighter data would play the same inputs out differently and only show up as a desync later
+    if (header.roster_hash != roster_hash() || header.characters[0] >= roster_count() || header.characters[1] >= roster_count())
+    {
+        fprintf(stderr, "%s was recorded with a different fighter roster (%016llx, this is %016llx) - "
+            "play it with the fighters.roster it was recorded with\n", path,
+            (unsigned long long) header.roster_hash, (unsigned long long) roster_hash());
+        fclose(file);
+        free(replay);
+        return NULL;
+    }
+    header.build_id[BUILD_ID_LENGTH - 1] = '\0';
+    if (strcmp(header.build_id, BUILD_ID) != 0)
+    {
+        fprintf(stderr, "Warning: %s was recorded by build %s, this is %s\n", path, header.build_id, BUILD_ID);
+    }
+
+    replay->file = file;
+    replay->writing = false;
+    replay->hash_interval = header.hash_interval;
+    replay->characters[PLAYER_1] = header.characters[0];
+    replay->characters[PLAYER_2] = header.characters[1];
+    return replay;
+}
+
+// Roster index of the fighter the player had in the recording
+int replay_character( Replay replay, PlayerId player )
+{
+    return replay->characters[player];
+}
+
+// Returns false once the recording runs out
+bool replay_next_tick( Replay replay, PlayerInput *p1_input, PlayerInput *p2_input )
+{
+    return read_input(replay->file, p1_input) && read_input(replay->file, p2_input);
+}
+
+/*
+ * Call after match_step with the inputs from replay_next_tick.
+ * Returns REPLAY_MISMATCH on the first tick whose recorded hash differs from the match.
+*/
+ReplayCheck replay_check_tick( Replay replay, Match match )
+{
+    replay->tick++;
+    if (replay->tick % replay->hash_interval != 0)
+    {
+        return REPLAY_OK;
+    }
+
+    uint64_t recorded;
+    if (fread(&recorded, sizeof(recorded), 1, replay->file) != 1)
+    {
+        fprintf(stderr, "Replay ended early at tick %llu\n", (unsigned long long) replay->tick);
+        return REPLAY_ERROR;
+    }
+    uint64_t actual = match_hash(match);
+    if (recorded != actual)
+    {
+        if (replay->mismatch_tick == 0)
+        {
+            replay->mismatch_tick = replay->tick;
+        }
+        fprintf(stderr, "Replay desync at tick %llu: recorded hash %016llx, got %016llx\n",
+            (unsigned long long) replay->tick, (unsigned long long) recorded, (unsigned long long) actual);
+        return REPLAY_MISMATCH;
+    }
+    return REPLAY_OK;
+}
+
+uint64_t replay_ticks( Replay replay )
+{
+    return replay->tick;
+}
+
+// The first tick replay_check_tick found out of step with the recording, 0 if none has been
+uint64_t replay_mismatch_tick( Replay replay )
+{
+    return replay->mismatch_tick;
+}
+
+void replay_close( Replay replay )
+{
+    if (replay)
+    {
+        fclose(replay->file);
+        free(replay);
+    }
+}
+
+static bool write_input( FILE *file, PlayerInput input )
+{
+    uint8_t buttons = input_pack_buttons(input);
+    return fwrite(&input.move_x, sizeof(input.move_x), 1, file) == 1 && fwrite(&buttons, sizeof(buttons), 1, file) == 1;
+}
+
+static bool read_input( FILE *file, PlayerInput *input )
+{
+    uint8_t buttons;
+    if (fread(&input->move_x, sizeof(input->move_x), 1, file) != 1 || fread(&buttons, sizeof(buttons), 1, file) != 1)
+    {
+        return false;
+    }
+    input_unpack_buttons(input, buttons);
+    return true;
+}
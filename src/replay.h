@@ -0,0 +1,44 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "game_types.h"
+
+typedef struct PlayerInput PlayerInput;
+typedef struct Match *Match;
+
+/*
+ * Replay files hold the PlayerInput pair fed to every match_step, plus a match_hash every
+ * hash_interval ticks so playback can tell exactly where it stopped matching the recording.
+ * The header names both fighters by roster index along with the roster_hash they were recorded
+ * with - playback takes its fighters from there and won't open a replay made with other fighter data.
+ * Format (host endianness): ReplayHeader, then per tick 2 x (double move_x, uint8_t buttons)
+ * with a uint64_t hash after every hash_interval'th tick.
+ *
+ * The roster (roster.h) must be open before a replay is opened either way.
+*/
+
+#define REPLAY_DEFAULT_HASH_INTERVAL 60
+
+typedef enum {
+    REPLAY_OK,          // Tick matched (or had no hash to check)
+    REPLAY_MISMATCH,    // State hash differs from the recording
+    REPLAY_ERROR        // File ended early or couldn't be read
+} ReplayCheck;
+
+typedef struct Replay *Replay;
+
+extern Replay replay_open_write( char const *path, uint32_t hash_interval, int p1_character, int p2_character );
+extern void replay_record_tick( Replay replay, PlayerInput p1_input, PlayerInput p2_input, Match match );
+
+extern Replay replay_open_read( char const *path );
+extern int replay_character( Replay replay, PlayerId player );
+extern bool replay_next_tick( Replay replay, PlayerInput *p1_input, PlayerInput *p2_input );
+extern ReplayCheck replay_check_tick( Replay replay, Match match );
+extern uint64_t replay_ticks( Replay replay );
+extern uint64_t replay_mismatch_tick( Replay replay );
+
+extern void replay_close( Replay replay );
+
+#endif
@@ -0,0 +1,304 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "roster.h"
+#include "game_types.h"
+
+#define PATH_SIZE 4096
+
+typedef struct {
+    unsigned char const *map;
+    size_t size;
+    RosterHeader const *header;
+    uint64_t hash;          // Of the whole file
+} RosterMapping;
+
+/*
+ * FighterDefs point straight into the mapped file, so a reload maps the new file into the other slot
+ * and leaves the one it replaces mapped until the reload after - anything still holding an old def
+ * (a render snapshot, the player about to be rebound) can finish with it.
+*/
+static struct {
+    RosterMapping slots[2];
+    int current;
+} roster;
+
+static bool map_roster( char const *path, RosterMapping *mapping );
+static void unmap_roster( RosterMapping *mapping );
+static bool check_fighter( FighterDef const *def, size_t space, char const *path );
+static uint64_t hash_bytes( unsigned char const *data, size_t size );
+
+#define CURRENT (&roster.slots[roster.current])
+
+/*
+ * Same as pack_path (the tools and headless builds don't link the pack) - found from the executable in
+ * src/ so every binary starts from anywhere, falling back to ../. Returns a static buffer.
+*/
+char const *roster_path( char const *relative )
+{
+    static char path[PATH_SIZE];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    char *slash = NULL;
+    if (length > 0)
+    {
+        path[length] = '\0';
+        slash = strrchr(path, '/');
+    }
+    if (!slash || snprintf(slash, sizeof(path) - (size_t) (slash - path), "/../%s", relative)
+                      >= (int) (sizeof(path) - (size_t) (slash - path)))
+    {
+        snprintf(path, sizeof(path), "../%s", relative);
+    }
+    return path;
+}
+
+bool roster_open( char const *path )
+{
+    RosterMapping mapping;
+    if (!map_roster(path, &mapping))
+    {
+        return false;
+    }
+    roster_close();
+    roster.slots[0] = mapping;
+    roster.current = 0;
+    return true;
+}
+
+/*
+ * Swaps in a new version of the open roster - call between ticks then point every player's def at
+ * roster_fighter(player->character) again. Fighters keep their indices, so the new roster has to
+ * start with the same fighters in the same order (adding more after them is fine). Returns false,
+ * with the old roster still in use, if the new file isn't valid.
+*/
+bool roster_reload( char const *path )
+{
+    RosterMapping mapping;
+    if (!map_roster(path, &mapping))
+    {
+        return false;
+    }
+    RosterHeader const *old = CURRENT->header;
+    if (old && mapping.header->fighter_count < old->fighter_count)
+    {
+        fprintf(stderr, "%s: fighters can't be removed without a restart\n", path);
+        unmap_roster(&mapping);
+        return false;
+    }
+    for (int i = 0; old && i < (int) old->fighter_count; i++)
+    {
+        char const *name = ((FighterDef const *) (CURRENT->map + old->fighters[i]))->name;
+        char const *new_name = ((FighterDef const *) (mapping.map + mapping.header->fighters[i]))->name;
+        if (strncmp(name, new_name, FIGHTER_NAME_SIZE) != 0)
+        {
+            fprintf(stderr, "%s: fighter %d is now %s instead of %s - fighters can't be reordered without a restart\n",
+                path, i, new_name, name);
+            unmap_roster(&mapping);
+            return false;
+        }
+    }
+    int spare = 1 - roster.current;
+    unmap_roster(&roster.slots[spare]);
+    roster.slots[spare] = mapping;
+    roster.current = spare;
+    return true;
+}
+
+void roster_close( void )
+{
+    unmap_roster(&roster.slots[0]);
+    unmap_roster(&roster.slots[1]);
+    roster.current = 0;
+}
+
+int roster_count( void )
+{
+    return CURRENT->header ? (int) CURRENT->header->fighter_count : 0;
+}
+
+FighterDef const *roster_fighter( int index )
+{
+    if (index < 0 || index >= roster_count())
+    {
+        return NULL;
+    }
+    return (FighterDef const *) (CURRENT->map + CURRENT->header->fighters[index]);
+}
+
+// Identifies the roster's exact contents - replays record it, since the same inputs only play out the
+// same with the same fighter data
+uint64_t roster_hash( void )
+{
+    return CURRENT->hash;
+}
+
+// -1 if there is no fighter by that name
+int roster_find( char const *name )
+{
+    for (int i = 0; i < roster_count(); i++)
+    {
+        if (strncmp(roster_fighter(i)->name, name, FIGHTER_NAME_SIZE) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Checks the header and offsets once so nothing reading a FighterDef has to - the data itself is used in place
+static bool map_roster( char const *path, RosterMapping *mapping )
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror(path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(RosterHeader))
+    {
+        fprintf(stderr, "%s is too small to be a roster\n", path);
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file alive on its own
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        perror(path);
+        return false;
+    }
+    *mapping = (RosterMapping) { map, (size_t) info.st_size, map };
+
+    RosterHeader const *header = map;
+    char const *problem = NULL;
+    if (header->magic != ROSTER_MAGIC)
+    {
+        problem = "not a roster file";
+    }
+    else if (header->version != ROSTER_VERSION)
+    {
+        problem = "roster version doesn't match this build - rebuild it with make";
+    }
+    else if (header->tick_rate != SIM_TICK_RATE)
+    {
+        problem = "roster was compiled for a different tick rate - make clean and rebuild";
+    }
+    else if (header->size != (size_t) info.st_size)
+    {
+        problem = "roster is truncated";
+    }
+    else if (header->fighter_count == 0 || header->fighter_count > ROSTER_MAX_FIGHTERS)
+    {
+        problem = "bad fighter count";
+    }
+    if (problem)
+    {
+        fprintf(stderr, "%s: %s\n", path, problem);
+        unmap_roster(mapping);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header->fighter_count; i++)
+    {
+        uint32_t offset = header->fighters[i];
+        if (offset < sizeof(RosterHeader) || offset % 8 != 0 || offset > header->size - sizeof(FighterDef)
+            || !check_fighter((FighterDef const *) ((unsigned char const *) map + offset), header->size - offset, path))
+        {
+            fprintf(stderr, "%s: fighter %u is corrupt\n", path, i);
+            unmap_roster(mapping);
+            return false;
+        }
+    }
+    mapping->hash = hash_bytes(mapping->map, mapping->size);
+    return true;
+}
+
+static void unmap_roster( RosterMapping *mapping )
+{
+    if (mapping->map)
+    {
+        munmap((void *) mapping->map, mapping->size);
+    }
+    *mapping = (RosterMapping) { 0 };
+}
+
+// Everything an index or a loop bound comes from, plus the tuning a hot reloaded typo could break the
+// game with - written as !(x > 0) so NaNs fail too
+static bool check_fighter( FighterDef const *def, size_t space, char const *path )
+{
+    if (def->size < sizeof(FighterDef) || def->size > space || memchr(def->name, '\0', FIGHTER_NAME_SIZE) == NULL)
+    {
+        return false;
+    }
+    char const *problem = NULL;
+    if (!(def->width > 0.0) || !(def->height > 0.0) || !(def->crouched_height > 0.0) || def->crouched_height > def->height)
+    {
+        problem = "needs a positive size, crouched no taller than standing";
+    }
+    else if (!(def->gravity > 0.0) || !(def->speed >= 0.0) || !(def->jump_speed >= 0.0)
+        || !(def->throw_gravity > 0.0) || !(def->throw_speed >= 0.0))
+    {
+        problem = "needs positive gravity and speeds";
+    }
+    else if (!(def->jump_delay >= 0.0) || !(def->stance_delay >= 0.0) || !(def->dive_kick_stun_time >= 0.0)
+        || !(def->dive_kick_recovery_time >= 0.0) || !(def->throw_time >= 0.0))
+    {
+        problem = "has a negative delay";
+    }
+    else if (!(def->dive_kick_width > 0.0) || !(def->dive_kick_height > 0.0) || !(def->sword_width > 0.0)
+        || !(def->sword_length > def->guard_angle_penalty) || !(def->guard_angle_penalty >= 0.0))
+    {
+        problem = "needs positive hitbox sizes, sword longer than its guard angle penalty";
+    }
+    if (problem)
+    {
+        fprintf(stderr, "%s: %s %s\n", path, def->name, problem);
+        return false;
+    }
+    for (int stance = 0; stance < FIGHTER_STANCES; stance++)
+    {
+        FighterAttack const *attack = &def->attacks[stance];
+        size_t table_size = (size_t) attack->ticks * 2 * sizeof(AttackTick);
+        if (attack->ticks <= 0 || attack->table % 8 != 0 || attack->table < sizeof(FighterDef)
+            || attack->table > def->size || table_size > def->size - attack->table)
+        {
+            return false;
+        }
+        AttackTick const *table = (AttackTick const *) ((unsigned char const *) def + attack->table);
+        for (int i = 0; i < attack->ticks * 2; i++)
+        {
+            if (table[i].frame < 0)
+            {
+                return false;
+            }
+        }
+    }
+    for (int row = 0; row < FIGHTER_ANIMATIONS; row++)
+    {
+        if (def->animations[row].frames <= 0 || !(def->animations[row].time_per_frame > 0.0))
+        {
+            fprintf(stderr, "%s: %s has no frames for animation row %d\n", path, def->name, row);
+            return false;
+        }
+    }
+    return true;
+}
+
+// FNV-1a - the file is a few KB and only hashed when it's mapped
+static uint64_t hash_bytes( unsigned char const *data, size_t size )
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,117 @@
+#ifndef ROSTER_H
+#define ROSTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "game_types.h"
+
+/*
+ * The fighters a build can play, compiled by fighterc from the text sources in assets/fighters/ into
+ * one file that is mmapped and used as is - no parsing, no allocations per fighter, and any number
+ * of PlayerStates can point at the same FighterDef.
+ *
+ * File layout (native byte order and struct layout - make rebuilds it with the game):
+ *   RosterHeader
+ *   FighterDef, then its AttackTick tables       for each fighter, 8 byte aligned
+ *
+ * Attack tables are flattened for one tick rate - indexed [tick][facing], facing 0 left, 1 right,
+ * hitbox x measured from the hurtbox edge the fighter faces and y from the hurtbox top.
+ *
+ * Usage:
+ *   roster_open(roster_path(ROSTER_PATH));
+ *   player_init(player, PLAYER_1, roster_find("swordsman"));   // Fighters are picked by roster index
+ *   roster_close() at exit, after the last PlayerState using it
+ *
+ * roster_reload swaps in a rebuilt file while the game runs (./main --hot-reload) - see roster.c.
+*/
+
+#define ROSTER_PATH "assets/fighters.roster"     // From the repository root - see roster_path
+
+#define ROSTER_MAGIC 0x52545352u    // "RSTR"
+#define ROSTER_VERSION 2
+#define ROSTER_MAX_FIGHTERS 16
+
+#define FIGHTER_NAME_SIZE 32
+#define FIGHTER_STANCES 3           // Indexed by Stance
+#define FIGHTER_ANIMATIONS 20       // Spritesheet rows (see animation.h)
+
+typedef struct {
+    int32_t frame;
+    int32_t padding;
+    Box hitbox;
+} AttackTick;
+
+typedef struct {
+    int32_t ticks;          // Attack is over once attack_ticks reaches this - also the table length
+    uint32_t table;         // Byte offset of its AttackTick[ticks][2] from the start of the FighterDef
+    double delay;           // Seconds before the next attack
+} FighterAttack;
+
+typedef struct {
+    int32_t frames;
+    int32_t loops;          // 0 holds the last frame
+    double time_per_frame;
+} FighterAnimation;
+
+typedef struct FighterDef {
+    char name[FIGHTER_NAME_SIZE];
+    uint32_t size;          // Bytes including the attack tables
+    uint32_t padding;
+
+    /* Movement - px, px/s, px/s^2 and s */
+    double width;
+    double height;
+    double crouched_height;
+    double speed;
+    double jump_speed;
+    double gravity;
+    double jump_delay;
+    double stance_delay;
+
+    /* Dive kick */
+    double dive_kick_width;
+    double dive_kick_height;
+    double dive_kick_x_offset;
+    double dive_kick_y_offset;
+    double dive_kick_x_speed;
+    double dive_kick_y_speed;
+    double dive_kick_stun_time;
+    double dive_kick_x_impact;
+    double dive_kick_y_impact;
+    double dive_kick_recovery_time;
+
+    /* Sword */
+    double sword_length;
+    double sword_width;
+    double guard_offsets[FIGHTER_STANCES];
+    double guard_angle_penalty;     // High and low guards are shorter by this
+
+    /* Sword throw */
+    double throw_speed;             // Horizontal px/s
+    double throw_lift;              // Upwards px/s
+    double throw_gravity;           // px/s^2 pulling the thrown sword down
+    double throw_time;              // Seconds the thrower can't act
+
+    FighterAttack attacks[FIGHTER_STANCES];
+    FighterAnimation animations[FIGHTER_ANIMATIONS];
+} FighterDef;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t tick_rate;     // Attack tables only fit builds with this SIM_TICK_RATE
+    uint32_t size;          // Whole file
+    uint32_t fighter_count;
+    uint32_t fighters[ROSTER_MAX_FIGHTERS];     // Byte offsets of each FighterDef
+} RosterHeader;
+
+extern char const *roster_path( char const *relative );
+extern bool roster_open( char const *path );
+extern bool roster_reload( char const *path );
+extern void roster_close( void );
+extern int roster_count( void );
+extern FighterDef const *roster_fighter( int index );
+extern int roster_find( char const *name );
+extern uint64_t roster_hash( void );
+
+#endif
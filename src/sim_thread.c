@@ -0,0 +1,144 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_timer.h>
+#include "sim_thread.h"
+#include "triple_buffer.h"
+#include "match.h"
+#include "input.h"
+#include "input_events.h"
+#include "clock.h"
+#include "trace.h"
+#include "game_types.h"
+#include "fighter_store.h"
+#include "player.h"
+
+#define SIM_DT_NS (NS_PER_SECOND / SIM_TICK_RATE)
+
+// If we fall further behind than this (e.g. debugger break) give up catching up
+#define MAX_TICKS_BEHIND (SIM_TICK_RATE / 4)
+
+// Sleep until this close to the next tick then spin - SDL_Delay is only ms accurate
+#define SPIN_THRESHOLD_NS 2000000ULL
+
+struct SimThread {
+    SDL_Thread *thread;
+    Match match;
+    InputEvents *input_events;
+    atomic_bool quit;
+
+    TripleBuffer snapshots;     // sim -> render
+    SimSnapshot snapshot_storage[3];
+};
+
+static int sim_thread_run( void *data );
+static void publish_snapshot( SimThread sim );
+static void wait_until( uint64_t target_ns );
+
+//NOTE: must be stopped with sim_thread_stop
+SimThread sim_thread_start( Match match, InputEvents *input_events )
+{
+    SimThread sim = calloc(1, sizeof(struct SimThread));
+    assert(sim != NULL);
+
+    sim->match = match;
+    sim->input_events = input_events;
+    atomic_init(&sim->quit, false);
+    triple_buffer_init(&sim->snapshots, sim->snapshot_storage, sizeof(SimSnapshot));
+    for (int i = 0; i < 3; i++)
+    {
+        SimSnapshot *snapshot = &sim->snapshot_storage[i];
+        fighter_store_init(&snapshot->fighters, snapshot->fighter_memory, 2);
+        fighter_store_bind(&snapshot->fighters, 0, &snapshot->player1);
+        fighter_store_bind(&snapshot->fighters, 1, &snapshot->player2);
+    }
+
+    // Make sure the renderer has something to draw before the first tick
+    publish_snapshot(sim);
+    triple_buffer_acquire(&sim->snapshots);
+
+    sim->thread = SDL_CreateThread(sim_thread_run, "simulation", sim);
+    if (!sim->thread)
+    {
+        fprintf(stderr, "Could not create simulation thread: %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    return sim;
+}
+
+// Newest finished tick - stays valid until the next call
+SimSnapshot const *sim_thread_latest( SimThread sim )
+{
+    triple_buffer_acquire(&sim->snapshots);
+    return triple_buffer_read_slot(&sim->snapshots);
+}
+
+// How far (0 to 1) the sim should be into the next tick at now_ns
+double sim_thread_alpha( SimSnapshot const *snapshot, uint64_t now_ns )
+{
+    if (now_ns <= snapshot->published_ns)
+    {
+        return 0.0;
+    }
+    double alpha = (double) (now_ns - snapshot->published_ns) / (double) SIM_DT_NS;
+    return (alpha > 1.0) ? 1.0 : alpha;
+}
+
+void sim_thread_stop( SimThread sim )
+{
+    atomic_store(&sim->quit, true);
+    SDL_WaitThread(sim->thread, NULL);
+    free(sim);
+}
+
+static int sim_thread_run( void *data )
+{
+    SimThread sim = data;
+    PlayerInput p1_input, p2_input;
+    uint64_t next_tick_ns = clock_now_ns() + SIM_DT_NS;
+    TRACE_THREAD("simulation");
+
+    while (!atomic_load(&sim->quit) && !sim->match->is_over)
+    {
+        wait_until(next_tick_ns);
+
+        // Every edge up to the scheduled end of this tick
+        input_events_next_tick(sim->input_events, next_tick_ns, &p1_input, &p2_input, NULL);
+        match_step(sim->match, p1_input, p2_input);
+        publish_snapshot(sim);
+
+        next_tick_ns += SIM_DT_NS;
+        uint64_t now = clock_now_ns();
+        if (now > next_tick_ns + MAX_TICKS_BEHIND * SIM_DT_NS)
+        {
+            next_tick_ns = now;
+        }
+    }
+    return 0;
+}
+
+static void publish_snapshot( SimThread sim )
+{
+    SimSnapshot *snapshot = triple_buffer_write_slot(&sim->snapshots);
+    player_copy(&snapshot->player1, &sim->match->player1);
+    player_copy(&snapshot->player2, &sim->match->player2);
+    snapshot->tick = sim->match->tick;
+    snapshot->is_over = sim->match->is_over;
+    snapshot->published_ns = clock_now_ns();
+    triple_buffer_publish(&sim->snapshots);
+}
+
+static void wait_until( uint64_t target_ns )
+{
+    uint64_t now = clock_now_ns();
+    while (now < target_ns)
+    {
+        uint64_t remaining = target_ns - now;
+        // SDL_Delay(0) still yields so we don't starve the render thread on small machines
+        SDL_Delay(remaining > SPIN_THRESHOLD_NS ? (uint32_t) ((remaining - SPIN_THRESHOLD_NS) / 1000000ULL) : 0);
+        now = clock_now_ns();
+    }
+}
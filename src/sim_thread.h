@@ -0,0 +1,36 @@
+#ifndef SIM_THREAD_H
+#define SIM_THREAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "game_types.h"
+#include "fighter_store.h"
+
+typedef struct Match *Match;
+typedef struct InputEvents InputEvents;
+
+/* Immutable copy of everything the renderer needs from one simulation tick */
+typedef struct SimSnapshot {
+    struct PlayerState player1;     // Slots 0 and 1 of fighters - copies, not the match's
+    struct PlayerState player2;
+    FighterStore fighters;
+    _Alignas(double) unsigned char fighter_memory[FIGHTER_STORE_SIZE(2)];
+    uint64_t tick;
+    uint64_t published_ns;  // clock_now_ns() when the tick finished - used for interpolation
+    bool is_over;
+} SimSnapshot;
+
+/*
+ * Runs match_step on its own thread at SIM_TICK_RATE so slow presents can't delay ticks.
+ * The sim thread drains the input event rings itself (it becomes their only consumer) and
+ * snapshots come out through a lock-free triple buffer - the render thread must not touch
+ * the match or the consumer side of the input events between sim_thread_start and sim_thread_stop.
+*/
+typedef struct SimThread *SimThread;
+
+extern SimThread sim_thread_start( Match match, InputEvents *input_events );
+extern SimSnapshot const *sim_thread_latest( SimThread sim );
+extern double sim_thread_alpha( SimSnapshot const *snapshot, uint64_t now_ns );
+extern void sim_thread_stop( SimThread sim );
+
+#endif
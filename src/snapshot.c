@@ -0,0 +1,316 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "snapshot.h"
+#include "match.h"
+#include "game_types.h"
+#include "roster.h"
+#include "player.h"
+#include "fighter_store.h"
+
+#define SNAPSHOT_MAGIC 0x50414e53u   // "SNAP"
+#define SNAPSHOT_VERSION 5
+
+/* Player flags packed into one byte - the rest of what the fighter is doing is its FighterState */
+#define FLAG_RIGHT_FACING    (1u << 0)
+#define FLAG_SWORD_THROWN    (1u << 1)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t sim_size;      // Bytes of simulation state after the header - hashed
+    uint16_t render_size;   // Bytes of render state after that - not hashed
+    uint16_t padding[3];
+} SnapshotHeader;
+
+/* Moves a cursor through the buffer one field at a time */
+typedef struct {
+    unsigned char *cursor;
+} Packer;
+
+typedef struct {
+    unsigned char const *cursor;
+} Unpacker;
+
+#define PACK(packer, value) (memcpy((packer)->cursor, &(value), sizeof(value)), (packer)->cursor += sizeof(value))
+#define UNPACK(unpacker, value) (memcpy(&(value), (unpacker)->cursor, sizeof(value)), (unpacker)->cursor += sizeof(value))
+
+static void pack_box( Packer *p, Box const *box );
+static void unpack_box( Unpacker *u, Box *box );
+static void pack_player( Packer *p, PlayerState player );
+static bool unpack_player( Unpacker *u, PlayerState player );
+static void pack_projectiles( Packer *p, ProjectilePool const *pool );
+static bool unpack_projectiles( Unpacker *u, ProjectilePool *pool );
+static uint8_t pack_flag( bool value, uint8_t flag );
+
+void game_snapshot_save( GameSnapshot *snapshot, Match match, double background_state )
+{
+    // Zeroed so the unused tail hashes the same every time
+    memset(snapshot, 0, sizeof(GameSnapshot));
+    unsigned char *base = (unsigned char *) snapshot->data;
+    Packer p = { base + sizeof(SnapshotHeader) };
+
+    pack_player(&p, &match->player1);
+    pack_player(&p, &match->player2);
+    PACK(&p, match->tick);
+    PACK(&p, match->death_time);
+    uint8_t match_flags = pack_flag(match->player_died, 1) | pack_flag(match->is_over, 2);
+    PACK(&p, match_flags);
+    pack_projectiles(&p, &match->projectiles);
+    size_t sim_size = p.cursor - base - sizeof(SnapshotHeader);
+
+    PACK(&p, match->player1.time_in_anim);
+    PACK(&p, match->player2.time_in_anim);
+    PACK(&p, background_state);
+    size_t render_size = p.cursor - base - sizeof(SnapshotHeader) - sim_size;
+
+    assert((size_t) (p.cursor - base) <= GAME_SNAPSHOT_SIZE);
+
+    SnapshotHeader header = { SNAPSHOT_MAGIC, SNAPSHOT_VERSION, (uint16_t) sim_size, (uint16_t) render_size, { 0 } };
+    memcpy(base, &header, sizeof(header));
+}
+
+// Returns false (leaving the match untouched) if the snapshot isn't one we wrote
+bool game_snapshot_restore( GameSnapshot const *snapshot, Match match, double *background_state )
+{
+    unsigned char const *base = (unsigned char const *) snapshot->data;
+    SnapshotHeader header;
+    memcpy(&header, base, sizeof(header));
+    if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION)
+    {
+        fprintf(stderr, "Invalid game snapshot\n");
+        return false;
+    }
+
+    // Unpacked into copies with a store of their own first, so a fighter this roster doesn't have
+    // leaves the match alone
+    Unpacker u = { base + sizeof(SnapshotHeader) };
+    FighterStore copies;
+    _Alignas(double) unsigned char copies_memory[FIGHTER_STORE_SIZE(2)];
+    struct PlayerState player1, player2;
+    fighter_store_init(&copies, copies_memory, 2);
+    fighter_store_bind(&copies, 0, &player1);
+    fighter_store_bind(&copies, 1, &player2);
+    player_copy(&player1, &match->player1);
+    player_copy(&player2, &match->player2);
+    if (!unpack_player(&u, &player1) || !unpack_player(&u, &player2))
+    {
+        fprintf(stderr, "Game snapshot has a fighter that isn't in the roster\n");
+        return false;
+    }
+    uint64_t tick;
+    double death_time;
+    uint8_t match_flags;
+    UNPACK(&u, tick);
+    UNPACK(&u, death_time);
+    UNPACK(&u, match_flags);
+    ProjectilePool projectiles;
+    if (!unpack_projectiles(&u, &projectiles))
+    {
+        fprintf(stderr, "Game snapshot has a thrown sword without a thrower\n");
+        return false;
+    }
+    player_copy(&match->player1, &player1);
+    player_copy(&match->player2, &player2);
+    match->tick = tick;
+    match->death_time = death_time;
+    match->player_died = match_flags & 1;
+    match->is_over = match_flags & 2;
+    match->projectiles = projectiles;
+
+    UNPACK(&u, match->player1.time_in_anim);
+    UNPACK(&u, match->player2.time_in_anim);
+    double background;
+    UNPACK(&u, background);
+    if (background_state)
+    {
+        *background_state = background;
+    }
+    return true;
+}
+
+// Hash of the simulation part only - two matches that hash the same will play out the same
+uint64_t game_snapshot_hash( GameSnapshot const *snapshot )
+{
+    SnapshotHeader header;
+    memcpy(&header, snapshot->data, sizeof(header));
+    size_t words = (sizeof(SnapshotHeader) + header.sim_size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    // Multiply-xorshift over whole words (the tail of the last word is always zero) then murmur3's finaliser
+    uint64_t hash = 0x9e3779b97f4a7c15ULL ^ header.sim_size;
+    for (size_t i = 0; i < words; i++)
+    {
+        hash ^= snapshot->data[i];
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 32;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+uint64_t match_hash( Match match )
+{
+    GameSnapshot snapshot;
+    game_snapshot_save(&snapshot, match, 0.0);
+    return game_snapshot_hash(&snapshot);
+}
+
+static uint8_t pack_flag( bool value, uint8_t flag )
+{
+    return value ? flag : 0;
+}
+
+static void pack_box( Packer *p, Box const *box )
+{
+    PACK(p, box->top_left.x);
+    PACK(p, box->top_left.y);
+    PACK(p, box->width);
+    PACK(p, box->height);
+    uint8_t enabled = box->enabled;
+    PACK(p, enabled);
+}
+
+static void unpack_box( Unpacker *u, Box *box )
+{
+    UNPACK(u, box->top_left.x);
+    UNPACK(u, box->top_left.y);
+    UNPACK(u, box->width);
+    UNPACK(u, box->height);
+    uint8_t enabled;
+    UNPACK(u, enabled);
+    box->enabled = enabled;
+}
+
+// time_in_anim is render state so packed separately by game_snapshot_save
+static void pack_player( Packer *p, PlayerState player )
+{
+    uint8_t id = player->id;
+    uint8_t character = player->character;
+    uint8_t stance = player->stance;
+    uint8_t sword_owner = player->sword.player;
+    uint8_t state = FIGHTER_STATE(player);
+    uint8_t anim_row = player->anim_row;
+    uint8_t flags = pack_flag(player->is_right_facing, FLAG_RIGHT_FACING)
+        | pack_flag(player->sword.thrown, FLAG_SWORD_THROWN);
+
+    PACK(p, id);
+    PACK(p, character);
+    PACK(p, stance);
+    PACK(p, sword_owner);
+    PACK(p, state);
+    PACK(p, anim_row);
+    PACK(p, flags);
+    PACK(p, FIGHTER_POS(player));
+    PACK(p, FIGHTER_PREV_POS(player));
+    PACK(p, FIGHTER_VEL(player));
+    pack_box(p, &player->hitbox);
+    pack_box(p, &FIGHTER_HURTBOX(player));
+
+    pack_box(p, &player->sword.hitbox);
+    PACK(p, player->sword.pos);
+    PACK(p, player->sword.internal.attack_ticks);
+    PACK(p, player->sword.internal.attack_delay);
+
+    PACK(p, player->internal.jump_delay);
+    PACK(p, player->internal.stance_delay);
+    PACK(p, player->internal.stunned_duration);
+}
+
+// Returns false if the character isn't in the open roster
+static bool unpack_player( Unpacker *u, PlayerState player )
+{
+    uint8_t id, character, stance, sword_owner, state, anim_row, flags;
+    UNPACK(u, id);
+    UNPACK(u, character);
+    UNPACK(u, stance);
+    UNPACK(u, sword_owner);
+    UNPACK(u, state);
+    UNPACK(u, anim_row);
+    UNPACK(u, flags);
+    player->id = (PlayerId) id;
+    player->character = character;
+    player->def = roster_fighter(character);
+    player->stance = (Stance) stance;
+    player->sword.player = (PlayerId) sword_owner;
+    FIGHTER_STATE(player) = (FighterState) state;
+    player->anim_row = anim_row;
+    player->is_right_facing = flags & FLAG_RIGHT_FACING;
+    player->sword.thrown = flags & FLAG_SWORD_THROWN;
+
+    UNPACK(u, FIGHTER_POS(player));
+    UNPACK(u, FIGHTER_PREV_POS(player));
+    UNPACK(u, FIGHTER_VEL(player));
+    unpack_box(u, &player->hitbox);
+    unpack_box(u, &FIGHTER_HURTBOX(player));
+
+    unpack_box(u, &player->sword.hitbox);
+    UNPACK(u, player->sword.pos);
+    UNPACK(u, player->sword.internal.attack_ticks);
+    UNPACK(u, player->sword.internal.attack_delay);
+
+    UNPACK(u, player->internal.jump_delay);
+    UNPACK(u, player->internal.stance_delay);
+    UNPACK(u, player->internal.stunned_duration);
+    return player->def != NULL;
+}
+
+// Only the live ones - a match never has more than one per player
+static void pack_projectiles( Packer *p, ProjectilePool const *pool )
+{
+    uint8_t count = pool->count;
+    PACK(p, count);
+    for (int i = 0; i < pool->count; i++)
+    {
+        uint8_t owner = pool->owner[i];
+        uint8_t flags = pool->flags[i];
+        PACK(p, pool->pos_x[i]);
+        PACK(p, pool->pos_y[i]);
+        PACK(p, pool->prev_x[i]);
+        PACK(p, pool->prev_y[i]);
+        PACK(p, pool->vel_x[i]);
+        PACK(p, pool->vel_y[i]);
+        PACK(p, pool->gravity[i]);
+        PACK(p, pool->half_width[i]);
+        PACK(p, pool->half_height[i]);
+        PACK(p, owner);
+        PACK(p, flags);
+    }
+}
+
+// Returns false if a projectile belongs to neither player
+static bool unpack_projectiles( Unpacker *u, ProjectilePool *pool )
+{
+    uint8_t count;
+    UNPACK(u, count);
+    if (count > 2)
+    {
+        return false;
+    }
+    pool->count = count;
+    for (int i = 0; i < pool->count; i++)
+    {
+        uint8_t owner, flags;
+        UNPACK(u, pool->pos_x[i]);
+        UNPACK(u, pool->pos_y[i]);
+        UNPACK(u, pool->prev_x[i]);
+        UNPACK(u, pool->prev_y[i]);
+        UNPACK(u, pool->vel_x[i]);
+        UNPACK(u, pool->vel_y[i]);
+        UNPACK(u, pool->gravity[i]);
+        UNPACK(u, pool->half_width[i]);
+        UNPACK(u, pool->half_height[i]);
+        UNPACK(u, owner);
+        UNPACK(u, flags);
+        if (owner > 1)
+        {
+            return false;
+        }
+        pool->owner[i] = owner;
+        pool->flags[i] = flags;
+    }
+    return true;
+}
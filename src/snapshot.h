@@ -0,0 +1,28 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct Match *Match;
+
+/*
+ * Whole match state packed field by field into a flat fixed size buffer - no pointers and no struct
+ * padding, so a snapshot can be copied, written to disk or sent to another process (same endianness)
+ * and restored bit for bit. The simulation part (players, swords, death timer) comes first and is
+ * what game_snapshot_hash covers, the render part (animation times, background frame) follows it
+ * as it depends on the render rate and shouldn't fail determinism checks.
+*/
+
+#define GAME_SNAPSHOT_SIZE 1024
+
+typedef struct GameSnapshot {
+    uint64_t data[GAME_SNAPSHOT_SIZE / sizeof(uint64_t)];   // uint64_t so the hash can read whole words
+} GameSnapshot;
+
+extern void game_snapshot_save( GameSnapshot *snapshot, Match match, double background_state );
+extern bool game_snapshot_restore( GameSnapshot const *snapshot, Match match, double *background_state );
+extern uint64_t game_snapshot_hash( GameSnapshot const *snapshot );
+extern uint64_t match_hash( Match match );
+
+#endif
@@ -0,0 +1,455 @@
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "soft_raster.h"
+#include "render_batch.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define HAVE_SSE2_KERNEL 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HAVE_NEON_KERNEL 1
+#endif
+
+#define OPAQUE 0xff000000u
+
+// A quad worked out once per flush so every tile only has to clip it - 32.32 fixed point texel steps,
+// fine enough that stepping across the whole screen never drifts onto the wrong texel
+typedef struct {
+    int x0;                     // Screen pixels covered, clipped to the screen
+    int y0;
+    int x1;
+    int y1;
+    uint32_t const *texels;     // First texel read for a row (last column when flipped), NULL for plain rects
+    int pitch;
+    int direction;              // 1, or -1 reading right to left for flipped sprites
+    uint64_t u_start;           // Texels from the source edge at x0's centre
+    uint64_t u_step;            // Per screen pixel
+    uint64_t v_start;
+    uint64_t v_step;
+    uint32_t color;             // Plain rects
+} PreparedQuad;
+
+static struct {
+    SDL_Renderer *renderer;
+    SDL_Texture *texture;       // Streaming - the whole frame goes up in one copy
+    uint32_t *framebuffer;
+    int width;
+    int height;
+    int tiles_x;
+    int tile_count;
+    bool clear_pending;         // Tiles clear themselves in the next pass
+
+    PreparedQuad quads[RENDER_BATCH_MAX_QUADS];
+    int quad_count;
+
+    SDL_Thread *workers[SOFT_RASTER_MAX_WORKERS];
+    int worker_count;
+    SDL_sem *start;             // Posted once per worker per pass
+    SDL_sem *done;
+    atomic_int next_tile;
+    atomic_bool quit;
+} raster;
+
+static int soft_raster_run( void *data );
+static void run_pass( void );
+static void draw_tiles( void );
+static void draw_tile( int tile );
+static bool prepare( PreparedQuad *prepared, RenderQuad const *quad, SoftImage const *images );
+static void fill_row( uint32_t *destination, int count, uint32_t color );
+static uint32_t blend( uint32_t source, uint32_t destination );
+static void blit_row_scalar( uint32_t *destination, uint32_t const *texels, int direction, int count, uint64_t u, uint64_t step );
+static void blit_row( uint32_t *destination, uint32_t const *texels, int direction, int count, uint64_t u, uint64_t step );
+
+// Framebuffer, streaming texture and a worker per core besides this one - false if any of it fails
+bool soft_raster_start( SDL_Renderer *renderer, int width, int height )
+{
+    raster.renderer = renderer;
+    raster.width = width;
+    raster.height = height;
+    raster.tiles_x = (width + SOFT_RASTER_TILE_WIDTH - 1) / SOFT_RASTER_TILE_WIDTH;
+    raster.tile_count = raster.tiles_x * ((height + SOFT_RASTER_TILE_HEIGHT - 1) / SOFT_RASTER_TILE_HEIGHT);
+    raster.clear_pending = true;
+
+    size_t size = ((size_t) width * height * sizeof(uint32_t) + 63) / 64 * 64;
+    raster.framebuffer = aligned_alloc(64, size);
+    raster.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+    raster.start = SDL_CreateSemaphore(0);
+    raster.done = SDL_CreateSemaphore(0);
+    if (!raster.framebuffer || !raster.texture || !raster.start || !raster.done)
+    {
+        fprintf(stderr, "Could not start the software renderer: %s\n", raster.framebuffer ? SDL_GetError() : "out of memory");
+        return false;
+    }
+
+    atomic_init(&raster.next_tile, 0);
+    atomic_init(&raster.quit, false);
+    int worker_count = SDL_GetCPUCount() - 1;
+    worker_count = (worker_count > SOFT_RASTER_MAX_WORKERS) ? SOFT_RASTER_MAX_WORKERS : worker_count;
+    for (int i = 0; i < worker_count; i++)
+    {
+        raster.workers[i] = SDL_CreateThread(soft_raster_run, "software renderer", NULL);
+        if (!raster.workers[i])
+        {
+            fprintf(stderr, "Could not create software renderer thread: %s\n", SDL_GetError());
+            break;
+        }
+        raster.worker_count++;
+    }
+    return true;
+}
+
+// To black, by the tiles themselves in the next pass
+void soft_raster_clear( void )
+{
+    raster.clear_pending = true;
+}
+
+// Quads back to front - plain rects are those with texture 0, textured ones read images[texture]
+void soft_raster_draw( RenderQuad const *quads, int count, SoftImage const *images )
+{
+    raster.quad_count = 0;
+    for (int i = 0; i < count; i++)
+    {
+        raster.quad_count += prepare(&raster.quads[raster.quad_count], &quads[i], images);
+    }
+    if (raster.quad_count > 0 || raster.clear_pending)
+    {
+        run_pass();
+    }
+}
+
+// Leaves the frame on the renderer's target - SDL_RenderPresent after
+void soft_raster_present( void )
+{
+    SDL_UpdateTexture(raster.texture, NULL, raster.framebuffer, raster.width * (int) sizeof(uint32_t));
+    SDL_RenderCopy(raster.renderer, raster.texture, NULL, NULL);
+}
+
+void soft_raster_stop( void )
+{
+    atomic_store(&raster.quit, true);
+    for (int i = 0; i < raster.worker_count; i++)
+    {
+        SDL_SemPost(raster.start);
+    }
+    for (int i = 0; i < raster.worker_count; i++)
+    {
+        SDL_WaitThread(raster.workers[i], NULL);
+    }
+    raster.worker_count = 0;
+    if (raster.texture)
+    {
+        SDL_DestroyTexture(raster.texture);
+    }
+    if (raster.start)
+    {
+        SDL_DestroySemaphore(raster.start);
+    }
+    if (raster.done)
+    {
+        SDL_DestroySemaphore(raster.done);
+    }
+    free(raster.framebuffer);
+    memset(&raster, 0, sizeof(raster));
+}
+
+static int soft_raster_run( void *data )
+{
+    (void) data;
+    while (true)
+    {
+        SDL_SemWait(raster.start);
+        if (atomic_load(&raster.quit))
+        {
+            return 0;
+        }
+        draw_tiles();
+        SDL_SemPost(raster.done);
+    }
+}
+
+// This thread takes tiles too - the semaphores order everything written before and after the pass
+static void run_pass( void )
+{
+    atomic_store(&raster.next_tile, 0);
+    for (int i = 0; i < raster.worker_count; i++)
+    {
+        SDL_SemPost(raster.start);
+    }
+    draw_tiles();
+    for (int i = 0; i < raster.worker_count; i++)
+    {
+        SDL_SemWait(raster.done);
+    }
+    raster.clear_pending = false;
+}
+
+static void draw_tiles( void )
+{
+    int tile;
+    while ((tile = atomic_fetch_add(&raster.next_tile, 1)) < raster.tile_count)
+    {
+        draw_tile(tile);
+    }
+}
+
+static void draw_tile( int tile )
+{
+    int left = (tile % raster.tiles_x) * SOFT_RASTER_TILE_WIDTH;
+    int top = (tile / raster.tiles_x) * SOFT_RASTER_TILE_HEIGHT;
+    int right = (left + SOFT_RASTER_TILE_WIDTH < raster.width) ? left + SOFT_RASTER_TILE_WIDTH : raster.width;
+    int bottom = (top + SOFT_RASTER_TILE_HEIGHT < raster.height) ? top + SOFT_RASTER_TILE_HEIGHT : raster.height;
+
+    if (raster.clear_pending)
+    {
+        for (int y = top; y < bottom; y++)
+        {
+            fill_row(raster.framebuffer + (size_t) y * raster.width + left, right - left, OPAQUE);
+        }
+    }
+
+    for (int i = 0; i < raster.quad_count; i++)
+    {
+        PreparedQuad const *quad = &raster.quads[i];
+        int x0 = (quad->x0 > left) ? quad->x0 : left;
+        int x1 = (quad->x1 < right) ? quad->x1 : right;
+        int y0 = (quad->y0 > top) ? quad->y0 : top;
+        int y1 = (quad->y1 < bottom) ? quad->y1 : bottom;
+        if (x0 >= x1 || y0 >= y1)
+        {
+            continue;
+        }
+        uint64_t u = quad->u_start + (uint64_t) (x0 - quad->x0) * quad->u_step;
+        for (int y = y0; y < y1; y++)
+        {
+            uint32_t *row = raster.framebuffer + (size_t) y * raster.width + x0;
+            if (!quad->texels)
+            {
+                fill_row(row, x1 - x0, quad->color);
+                continue;
+            }
+            uint64_t v = quad->v_start + (uint64_t) (y - quad->y0) * quad->v_step;
+            blit_row(row, quad->texels + (size_t) (v >> 32) * quad->pitch, quad->direction, x1 - x0, u, quad->u_step);
+        }
+    }
+}
+
+/*
+ * A pixel is covered when its centre is inside the destination and samples the texel under its
+ * centre, the way SDL's nearest neighbour scaling does. Steps are rounded down so the last pixel can
+ * never read past the source rect. Returns false for quads with nothing on screen
+*/
+static bool prepare( PreparedQuad *prepared, RenderQuad const *quad, SoftImage const *images )
+{
+    SDL_FRect const *rect = &quad->destination;
+    int x0 = (int) ceilf(rect->x - 0.5f);
+    int x1 = (int) ceilf(rect->x + rect->w - 0.5f);
+    int y0 = (int) ceilf(rect->y - 0.5f);
+    int y1 = (int) ceilf(rect->y + rect->h - 0.5f);
+    x0 = (x0 < 0) ? 0 : x0;
+    y0 = (y0 < 0) ? 0 : y0;
+    x1 = (x1 > raster.width) ? raster.width : x1;
+    y1 = (y1 > raster.height) ? raster.height : y1;
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return false;
+    }
+    *prepared = (PreparedQuad) { .x0 = x0, .y0 = y0, .x1 = x1, .y1 = y1 };
+
+    if (quad->texture == 0)
+    {
+        SDL_Color c = quad->color;
+        prepared->color = ((uint32_t) c.a << 24) | ((uint32_t) c.r << 16) | ((uint32_t) c.g << 8) | c.b;
+        return c.a > 0;
+    }
+
+    SoftImage const *image = &images[quad->texture];
+    SDL_Rect const *source = &quad->source;
+    if (source->w <= 0 || source->h <= 0)
+    {
+        return false;
+    }
+    double scale_x = source->w / (double) rect->w;
+    double scale_y = source->h / (double) rect->h;
+    prepared->u_start = (uint64_t) ((x0 + 0.5 - rect->x) * scale_x * 4294967296.0);
+    prepared->u_step = (uint64_t) (scale_x * 4294967296.0);
+    prepared->v_start = (uint64_t) ((y0 + 0.5 - rect->y) * scale_y * 4294967296.0);
+    prepared->v_step = (uint64_t) (scale_y * 4294967296.0);
+
+    // Doubles can still land a hair past the edge of a rect that exactly fits
+    while (prepared->u_step > 0 && (prepared->u_start + (uint64_t) (x1 - 1 - x0) * prepared->u_step) >> 32 >= (uint64_t) source->w)
+    {
+        prepared->u_step--;
+    }
+    while (prepared->v_step > 0 && (prepared->v_start + (uint64_t) (y1 - 1 - y0) * prepared->v_step) >> 32 >= (uint64_t) source->h)
+    {
+        prepared->v_step--;
+    }
+    if (prepared->u_start >> 32 >= (uint64_t) source->w || prepared->v_start >> 32 >= (uint64_t) source->h)
+    {
+        return false;
+    }
+
+    prepared->texels = image->pixels + (size_t) source->y * image->pitch + source->x + (quad->flip ? source->w - 1 : 0);
+    prepared->pitch = image->pitch;
+    prepared->direction = quad->flip ? -1 : 1;
+    return true;
+}
+
+static void fill_row( uint32_t *destination, int count, uint32_t color )
+{
+    if (color >> 24 == 0xff)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            destination[i] = color;
+        }
+        return;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        destination[i] = blend(color, destination[i]);
+    }
+}
+
+/*
+ * Source over destination per channel with exact rounding - (t + (t >> 8)) >> 8 is t / 255 rounded
+ * for every t this can make, and the SIMD kernels use the same sums so they match it bit for bit.
+ * The framebuffer is always opaque
+*/
+static uint32_t blend( uint32_t source, uint32_t destination )
+{
+    uint32_t alpha = source >> 24;
+    if (alpha == 0xff)
+    {
+        return source;
+    }
+    if (alpha == 0)
+    {
+        return destination;
+    }
+    uint32_t result = OPAQUE;
+    for (int shift = 0; shift < 24; shift += 8)
+    {
+        uint32_t t = ((source >> shift) & 0xff) * alpha + ((destination >> shift) & 0xff) * (0xff - alpha) + 128;
+        result |= ((t + (t >> 8)) >> 8) << shift;
+    }
+    return result;
+}
+
+static void blit_row_scalar( uint32_t *destination, uint32_t const *texels, int direction, int count, uint64_t u, uint64_t step )
+{
+    for (int i = 0; i < count; i++, u += step)
+    {
+        destination[i] = blend(texels[(int) (u >> 32) * direction], destination[i]);
+    }
+}
+
+/* ------- KERNELS ------- */
+
+// 4 pixels at a time - the texels are gathered one by one, then fully clear and fully opaque groups
+// (nearly all of them - sprites are cut out, the background is solid) skip the blend
+#ifdef HAVE_SSE2_KERNEL
+static void blit_row( uint32_t *destination, uint32_t const *texels, int direction, int count, uint64_t u, uint64_t step )
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const all_opaque = _mm_set1_epi32(0xff);
+    __m128i const opaque = _mm_set1_epi32((int) OPAQUE);
+    __m128i const rounding = _mm_set1_epi16(128);
+    __m128i const ones = _mm_set1_epi8((char) 0xff);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32_t t0 = texels[(int) (u >> 32) * direction];
+        uint32_t t1 = texels[(int) ((u + step) >> 32) * direction];
+        uint32_t t2 = texels[(int) ((u + 2 * step) >> 32) * direction];
+        uint32_t t3 = texels[(int) ((u + 3 * step) >> 32) * direction];
+        u += 4 * step;
+        __m128i source = _mm_set_epi32((int) t3, (int) t2, (int) t1, (int) t0);
+        __m128i alpha = _mm_srli_epi32(source, 24);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, all_opaque)) == 0xffff)
+        {
+            _mm_storeu_si128((__m128i *) (destination + i), source);
+            continue;
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xffff)
+        {
+            continue;
+        }
+
+        __m128i target = _mm_loadu_si128((__m128i const *) (destination + i));
+        __m128i alphas = _mm_or_si128(_mm_or_si128(alpha, _mm_slli_epi32(alpha, 8)),
+                                      _mm_or_si128(_mm_slli_epi32(alpha, 16), _mm_slli_epi32(alpha, 24)));
+        __m128i inverse = _mm_xor_si128(alphas, ones);
+
+        __m128i low = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(source, zero), _mm_unpacklo_epi8(alphas, zero)),
+                                                  _mm_mullo_epi16(_mm_unpacklo_epi8(target, zero), _mm_unpacklo_epi8(inverse, zero))), rounding);
+        __m128i high = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(source, zero), _mm_unpackhi_epi8(alphas, zero)),
+                                                   _mm_mullo_epi16(_mm_unpackhi_epi8(target, zero), _mm_unpackhi_epi8(inverse, zero))), rounding);
+        low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+        _mm_storeu_si128((__m128i *) (destination + i), _mm_or_si128(_mm_packus_epi16(low, high), opaque));
+    }
+    blit_row_scalar(destination + i, texels, direction, count - i, u, step);
+}
+#elif defined(HAVE_NEON_KERNEL)
+static void blit_row( uint32_t *destination, uint32_t const *texels, int direction, int count, uint64_t u, uint64_t step )
+{
+    uint32x4_t const opaque = vdupq_n_u32(OPAQUE);
+    uint16x8_t const rounding = vdupq_n_u16(128);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32_t gathered[4];
+        for (int lane = 0; lane < 4; lane++, u += step)
+        {
+            gathered[lane] = texels[(int) (u >> 32) * direction];
+        }
+        uint32x4_t source = vld1q_u32(gathered);
+        uint32x4_t alpha = vshrq_n_u32(source, 24);
+        // No movemask on NEON - and-ing and or-ing the lanes tells all opaque from all clear
+        uint32_t alpha_lanes[4];
+        vst1q_u32(alpha_lanes, alpha);
+        uint32_t all = alpha_lanes[0] & alpha_lanes[1] & alpha_lanes[2] & alpha_lanes[3];
+        uint32_t any = alpha_lanes[0] | alpha_lanes[1] | alpha_lanes[2] | alpha_lanes[3];
+        if (all == 0xff)
+        {
+            vst1q_u32(destination + i, source);
+            continue;
+        }
+        if (any == 0)
+        {
+            continue;
+        }
+
+        uint8x16_t source_bytes = vreinterpretq_u8_u32(source);
+        uint8x16_t target = vreinterpretq_u8_u32(vld1q_u32(destination + i));
+        uint8x16_t alphas = vreinterpretq_u8_u32(vmulq_n_u32(alpha, 0x01010101u));
+        uint8x16_t inverse = vmvnq_u8(alphas);
+
+        uint16x8_t low = vmlal_u8(vmull_u8(vget_low_u8(source_bytes), vget_low_u8(alphas)), vget_low_u8(target), vget_low_u8(inverse));
+        uint16x8_t high = vmlal_u8(vmull_u8(vget_high_u8(source_bytes), vget_high_u8(alphas)), vget_high_u8(target), vget_high_u8(inverse));
+        low = vaddq_u16(low, rounding);
+        high = vaddq_u16(high, rounding);
+        uint8x8_t low_bytes = vshrn_n_u16(vaddq_u16(low, vshrq_n_u16(low, 8)), 8);
+        uint8x8_t high_bytes = vshrn_n_u16(vaddq_u16(high, vshrq_n_u16(high, 8)), 8);
+        uint32x4_t result = vreinterpretq_u32_u8(vcombine_u8(low_bytes, high_bytes));
+        vst1q_u32(destination + i, vorrq_u32(result, opaque));
+    }
+    blit_row_scalar(destination + i, texels, direction, count - i, u, step);
+}
+#else
+static void blit_row( uint32_t *destination, uint32_t const *texels, int direction, int count, uint64_t u, uint64_t step )
+{
+    blit_row_scalar(destination, texels, direction, count, u, step);
+}
+#endif
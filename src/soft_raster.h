@@ -0,0 +1,43 @@
+#ifndef SOFT_RASTER_H
+#define SOFT_RASTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+typedef struct RenderQuad RenderQuad;
+
+/*
+ * CPU renderer for machines without a usable GPU (./main --software, or LIBGL_ALWAYS_SOFTWARE set).
+ * The render batch hands it each flush's quads back to front and they are drawn into an ARGB8888
+ * framebuffer in memory - nearest neighbour scaled, flipped and alpha blended 4 pixels at a time
+ * with SSE2 or NEON. The screen is cut into tiles shared out between a worker per core, each tile
+ * drawing every quad that touches it in order, so no two threads ever write the same pixel.
+ * A finished frame goes to the screen as one streaming texture copy.
+ *
+ * Usage:
+ *   soft_raster_start(renderer, SCREEN_SIZE_X, SCREEN_SIZE_Y);
+ *   SoftImage image = { pixels, width, height, pitch };      // Pixels are read in place, never copied
+ *   soft_raster_clear();  then render_batch_flush() calls soft_raster_draw
+ *   soft_raster_present();  SDL_RenderPresent(renderer);
+ *   soft_raster_stop();
+*/
+
+#define SOFT_RASTER_TILE_WIDTH 128
+#define SOFT_RASTER_TILE_HEIGHT 72
+#define SOFT_RASTER_MAX_WORKERS 16
+
+typedef struct {
+    uint32_t const *pixels;     // ARGB8888 - alpha in the top byte
+    int width;
+    int height;
+    int pitch;                  // Pixels from one row to the next
+} SoftImage;
+
+extern bool soft_raster_start( SDL_Renderer *renderer, int width, int height );
+extern void soft_raster_clear( void );
+extern void soft_raster_draw( RenderQuad const *quads, int count, SoftImage const *images );
+extern void soft_raster_present( void );
+extern void soft_raster_stop( void );
+
+#endif
@@ -1,198 +1,30 @@
 #include <stdio.h>
 #include "sword.h"
 #include "game_types.h"
+#include "roster.h"
+#include "fighter_store.h"
 
-#define MAX_ATTACK_FRAMES   4
-#define STANCE_NOS          3
-#define STANCE_LOW_OFFSET   40.0
-#define STANCE_HIGH_OFFSET   -27.5
-#define STANCE_MIDDLE_OFFSET -13.0
-#define STANCE_ANGLE_PENALTY 10.0
-
-/* Sword constants */
-#define SWORD_LENGTH 55.0    
-#define SWORD_WIDTH 10.0
-
-#define LOW_ATTACK_DURATION 1.1
-#define LOW_ATTACK_DELAY 0.4
-
-#define MID_ATTACK_DURATION 0.4
-#define MID_ATTACK_DELAY 0.1
-
-#define HIGH_ATTACK_DURATION 1.1
-#define HIGH_ATTACK_DELAY 0.2
-
-
-typedef struct {
-    const double attack_frames[MAX_ATTACK_FRAMES]; // Array of attack frames
-    double attack_over;
-    Stance stance;
-} AttackData;
-
-static const AttackData attack_datas[] = {
-    {
-        {
-            0.1,
-            0.1,
-            0.1,
-            0.1
-        },
-        0.1,
-        MIDDLE
-    },
-    {
-        {
-            0.2,
-            0.3,
-            0.4,
-            0.2
-        },
-        0.4,
-        LOW
-    },
-    {
-        {
-            0.6,
-            0.1,
-            0.3,
-            0.1
-        },
-        0.2,
-        HIGH
-    }
-};
-
-
-typedef struct {
-    Box frames[MAX_ATTACK_FRAMES];
-    Stance stance;
-} HitboxTuple;
-
-// This stores the hitboxes (relative to player pos) of each frame of each stance
-static const HitboxTuple attack_frames[] = {
-    {
-        .stance = HIGH,
-        .frames = {
-            {
-                .top_left = {
-                    .x = -100,
-                    .y = -80
-                },
-                .height = 80,
-                .width = 10,
-                .enabled = true
-            },
-            {
-                .top_left = {
-                    .x = -20,
-                    .y = -80
-                },
-                .height = 100,
-                .width = 10,
-                .enabled = true
-            },
-            {
-                .top_left = {
-                    .x = -40,
-                    .y = -100
-                },
-                .height = 170,
-                .width = 200,
-                .enabled = true
-            },
-            {
-                .enabled = false
-            }
-        }
-    },
-    {
-        .stance = MIDDLE,
-        .frames = {
-            {
-                .top_left = {
-                    .x = -30,
-                    .y = 60
-                },
-                .height = 20,
-                .width = 110,
-                .enabled = true
-            },
-            {
-                .enabled = false
-            },
-            {
-                .top_left = {
-                    .x = -30,
-                    .y = 60
-                },
-                .height = 20,
-                .width = 170,
-                .enabled = true
-            },
-            {
-                .top_left = {
-                    .x = -30,
-                    .y = 60
-                },
-                .height = 20,
-                .width = 110
-            }
-        }
-    },
-    {
-        .stance = LOW,
-        .frames = {
-            {
-                .top_left = {
-                    .x = 80,
-                    .y = 60
-                },
-                .height = 20,
-                .width = 40,
-                .enabled = true
-            },
-            {
-                .enabled = false
-            },
-            {
-                .top_left = {
-                    .x = -150,
-                    .y = 60
-                },
-                .height = 50,
-                .width = 250,
-                .enabled = true
-            },
-            {
-                .top_left = {
-                    .x = -180,
-                    .y = 60
-                },
-                .height = 50,
-                .width = 80,
-                .enabled = true
-            },
-        }
-    }
-};
+// Sword sizes, guard offsets and the attack tables all come from the fighter's FighterDef
 
 void move_sword_to_player( Sword *sword, Vector_2D player_pos, bool right_facing, Stance stance ); 
 static void sword_update_hitbox( Sword *sword );
+static AttackTick const *attack_tick( PlayerState player );
 
 Sword sword_init( PlayerState player ) {
     Sword sword;
     
-    sword.hitbox.width = SWORD_LENGTH;
-    sword.hitbox.height = SWORD_WIDTH;
+    sword.hitbox.width = player->def->sword_length;
+    sword.hitbox.height = player->def->sword_width;
     sword.hitbox.enabled = false;
     
     sword.player = player->id;
     sword.thrown = false;
     
-    move_sword_to_player(&sword, player->pos, player->is_right_facing, player->stance);
+    move_sword_to_player(&sword, FIGHTER_POS(player), player->is_right_facing, player->stance);
 
-    sword.internal.attack_timer = 0;
+    sword.internal.attack_ticks = 0;
     sword.internal.attack_delay = 0;
+    sword.internal.launching = false;
 
     return sword;
 }
@@ -219,7 +51,7 @@ void sword_update_internal_state( Sword *sword, bool is_attacking, double dt )
 
     if (is_attacking)
     {
-        sword->internal.attack_timer += dt;
+        sword->internal.attack_ticks++;
     }
 }
 
@@ -231,58 +63,43 @@ bool sword_can_attack( Sword *sword )
 void sword_begin_melee_attack(Sword *sword, Stance stance)
 {
     sword->hitbox.enabled = true;
-    sword->internal.attack_timer = 0;
+    sword->internal.attack_ticks = 0;
 }
 
+// Hitbox from the attack frames - for fighters in STATE_ATTACK
 void sword_update_attack_hitbox( PlayerState player )
 {
-    int scale_factor = (player->is_right_facing) ? 1 : -1;
-    if (player->is_attacking && !player->is_jumping)
+    Sword *sword = &(player->sword);
+    Box const *hitbox = &attack_tick(player)->hitbox;
+    if (hitbox->enabled)
     {
-        for (int i = 0; i < STANCE_NOS; i ++)
-        {
-            if (player->stance == attack_frames[i].stance)
-            {
-                Sword *sword = &(player->sword);
-                Box hitbox = attack_frames[i].frames[sword_get_frame(player)];
-                if (hitbox.enabled)
-                {
-                    int offset = (player->is_right_facing) ? player->hurtbox.width : -hitbox.width;
-                    sword->hitbox.top_left.x = hitbox.top_left.x * scale_factor + player->hurtbox.top_left.x + offset;  
-                    sword->hitbox.top_left.y = hitbox.top_left.y + player->hurtbox.top_left.y;
-                    sword->hitbox.width = hitbox.width;
-                    sword->hitbox.height = hitbox.height;
-                }
-                sword->hitbox.enabled = hitbox.enabled;
-                break;
-            }
-        }
-    } 
-    else if (player->vel.x == 0.0 && player->vel.y == 0.0 && !player->is_dead && !player->is_crouching)
+        // Table x is already mirrored - measured from whichever side of the hurtbox we face
+        double edge = FIGHTER_HURTBOX(player).top_left.x + ((player->is_right_facing) ? FIGHTER_HURTBOX(player).width : 0.0);
+        sword->hitbox.top_left.x = edge + hitbox->top_left.x;
+        sword->hitbox.top_left.y = hitbox->top_left.y + FIGHTER_HURTBOX(player).top_left.y;
+        sword->hitbox.width = hitbox->width;
+        sword->hitbox.height = hitbox->height;
+    }
+    sword->hitbox.enabled = hitbox->enabled;
+}
+
+// Sword held out in the current stance - only blocks while the fighter stands still
+void sword_update_guard_hitbox( PlayerState player )
+{
+    int scale_factor = (player->is_right_facing) ? 1 : -1;
+    if (FIGHTER_VEL(player).x == 0.0 && FIGHTER_VEL(player).y == 0.0)
     {
-        int offset = 0;
-        int penalty = 0;
-        switch (player->stance)
-        {
-            case HIGH:
-                offset = STANCE_HIGH_OFFSET;
-                penalty = STANCE_ANGLE_PENALTY;
-                break;
-            case LOW:
-                offset =  STANCE_LOW_OFFSET;
-                penalty = STANCE_ANGLE_PENALTY;
-                break;
-            default:
-                offset = STANCE_MIDDLE_OFFSET;
-                break;
-        }
+        FighterDef const *def = player->def;
+        // Whole pixels, as the guard has always been placed
+        int offset = def->guard_offsets[player->stance];
+        int penalty = (player->stance == MIDDLE) ? 0 : def->guard_angle_penalty;
         Sword *sword = &player->sword;
-        sword->pos.x = player->pos.x + scale_factor * (sword->hitbox.width / 2.0 + penalty);
-        sword->pos.y = player->pos.y + offset;
+        sword->pos.x = FIGHTER_POS(player).x + scale_factor * (sword->hitbox.width / 2.0 + penalty);
+        sword->pos.y = FIGHTER_POS(player).y + offset;
         sword->hitbox.top_left.y = sword->hitbox.top_left.y + offset;
         sword->hitbox.enabled = true;
-        sword->hitbox.height = SWORD_WIDTH;
-        sword->hitbox.width = SWORD_LENGTH - penalty;
+        sword->hitbox.height = def->sword_width;
+        sword->hitbox.width = def->sword_length - penalty;
     }
     else
     {
@@ -292,56 +109,37 @@ void sword_update_attack_hitbox( PlayerState player )
 
 int sword_get_frame( PlayerState player )
 {
-    int current_frame = 0;
-    for (int i = 0; i < STANCE_NOS; i++)
-    {
-        if (attack_datas[i].stance == player->stance)
-        {
-            double time_remaining = player->sword.internal.attack_timer;
-            while (current_frame < MAX_ATTACK_FRAMES && time_remaining > attack_datas[i].attack_frames[current_frame])
-            {
-                time_remaining -= attack_datas[i].attack_frames[current_frame];
-                current_frame++;
-            }
-            return current_frame;
-        }
-    }
-    return -1;
+    return attack_tick(player)->frame;
 }
 
-bool sword_check_attack_over(Sword *sword, Stance stance)
+bool sword_check_attack_over( PlayerState player )
 {
-    double duration;
-    double delay;
-    switch(stance) {
-        case LOW:
-            duration = LOW_ATTACK_DURATION;
-            delay = LOW_ATTACK_DELAY;
-            break;
-        case MIDDLE:
-            duration = MID_ATTACK_DURATION;
-            delay = MID_ATTACK_DELAY;
-            break;
-        case HIGH:
-            duration = HIGH_ATTACK_DURATION;
-            delay = HIGH_ATTACK_DELAY;
-            break;
-        default:
-            fprintf(stderr, "Error: unknown stance \n");
-    }
-
-    // TODO() get stance so we know what kind of attakc doing and check against correct delay
-    if (sword->internal.attack_timer >= duration) 
+    Sword *sword = &player->sword;
+    FighterAttack const *attack = &player->def->attacks[player->stance];
+    if (sword->internal.attack_ticks >= attack->ticks) 
     {
         // Attack over
-        sword->internal.attack_timer = 0;
-        sword->internal.attack_delay = delay;
+        sword->internal.attack_ticks = 0;
+        sword->internal.attack_delay = attack->delay;
         sword->hitbox.enabled = false;
         return true;
     }     
     return false;
 }
 
+// Past the end of the table (a dive kick counts ticks too) the last tick repeats
+static AttackTick const *attack_tick( PlayerState player )
+{
+    FighterAttack const *attack = &player->def->attacks[player->stance];
+    AttackTick const *table = (AttackTick const *) ((unsigned char const *) player->def + attack->table);
+    int tick = player->sword.internal.attack_ticks;
+    if (tick >= attack->ticks)
+    {
+        tick = attack->ticks - 1;
+    }
+    return &table[tick * 2 + player->is_right_facing];
+}
+
 static void sword_update_hitbox( Sword *sword ) {
     // sword->pos is center
     // Remember bigger y means lower
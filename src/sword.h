@@ -9,7 +9,8 @@ void sword_update_internal_state( Sword *sword, bool is_attacking, double dt );
 bool sword_can_attack( Sword *sword );
 void sword_begin_melee_attack( Sword *sword, Stance stance );
 void sword_update_attack_hitbox( PlayerState player );
-bool sword_check_attack_over( Sword *sword, Stance stance );
+void sword_update_guard_hitbox( PlayerState player );
+bool sword_check_attack_over( PlayerState player );
 int sword_get_frame( PlayerState player );
 
 #endif
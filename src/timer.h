@@ -7,19 +7,22 @@
 /* Timer that can start, stop and pause */
 // All values in the struct are internal values - DO NOT USE THEM DIRECTLY unless you know what you are doing
 // Instead use the timer by calling functions below e.g. timer_get_seconds()
+// Timers are plain values (no allocation) - declare one with Timer t = TIMER_INIT;
+// Time comes from whichever clock source is selected in clock.h
 typedef struct Timer {
-    uint64_t _start_counter;
-    uint64_t _paused_counter;
+    uint64_t _start_ns;
+    uint64_t _paused_ns;
     bool _started;
     bool _paused;
-} *Timer;
+} Timer;
 
-extern Timer timer_create( void );
-extern void timer_start( Timer t );
-extern void timer_reset( Timer t );
-extern void timer_pause( Timer t );
-extern void timer_unpause( Timer t );
-extern double timer_get_seconds( Timer t );
-extern void timer_free( Timer t );
+#define TIMER_INIT ((Timer) { 0, 0, false, false })
+
+extern void timer_start( Timer *t );
+extern void timer_reset( Timer *t );
+extern void timer_pause( Timer *t );
+extern void timer_unpause( Timer *t );
+extern uint64_t timer_get_ns( Timer const *t );
+extern double timer_get_seconds( Timer const *t );
 
 #endif
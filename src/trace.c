@@ -0,0 +1,219 @@
+#include "trace.h"
+
+#ifdef ENABLE_TRACE
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Must be a power of 2 - at ~20 events a frame this holds the last ~50 seconds at 60fps
+#define TRACE_CAPACITY (1 << 16)
+
+// Threads past this many still get their own track, just without a name
+#define TRACE_MAX_THREADS 8
+
+typedef struct {
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    double value;       // Only used by counters
+    TraceZone zone;
+    uint32_t thread;    // 1 for the first thread to record, 2 for the next...
+} TraceEvent;
+
+// A ring entry - the render and sim threads both record, and F9 can dump while they do, so every field
+// is a relaxed atomic (plain loads and stores on x86 and ARM) and the sequence says when it's complete
+typedef struct {
+    atomic_uint_fast64_t start_ns;
+    atomic_uint_fast64_t duration_ns;
+    atomic_uint_fast64_t value;     // The double's bits
+    atomic_uint zone;
+    atomic_uint thread;
+    atomic_uint_fast64_t sequence;  // Ring index + 1 once the event is written, 0 while it's being written
+} TraceSlot;
+
+static char const *zone_names[TRACE_ZONE_COUNT] = {
+    [TRACE_INPUT] = "input",
+    [TRACE_PLAYER_UPDATE] = "player_update",
+    [TRACE_COMBAT_UPDATE] = "combat_update",
+    [TRACE_DRAW_BACKGROUND] = "renderer_draw_background",
+    [TRACE_DRAW_PLAYER] = "renderer_draw_player",
+    [TRACE_END_FRAME] = "renderer_end_frame",
+    [TRACE_CAP_SLEEP] = "cap_sleep",
+    [TRACE_FPS] = "fps",
+};
+
+// Preallocated so recording never touches the heap
+static TraceSlot events[TRACE_CAPACITY];
+static atomic_uint_fast64_t event_count;
+
+static atomic_uint thread_count;
+static _Thread_local uint32_t thread_id;
+static char const *_Atomic thread_names[TRACE_MAX_THREADS + 1];
+
+static void write_event( TraceZone zone, uint64_t start_ns, uint64_t duration_ns, double value );
+static bool read_event( uint64_t index, TraceEvent *out );
+static uint32_t current_thread( void );
+static void dump_chrome( char const *path, uint64_t first, uint64_t last );
+static void dump_csv( char const *path, uint64_t first, uint64_t last );
+
+uint64_t trace_now_ns( void )
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+void trace_record( TraceZone zone, uint64_t start_ns )
+{
+    write_event(zone, start_ns, trace_now_ns() - start_ns, 0.0);
+}
+
+void trace_counter( TraceZone counter, double value )
+{
+    write_event(counter, trace_now_ns(), 0, value);
+}
+
+// Usage: trace_name_thread("simulation") - once, on the thread being named
+void trace_name_thread( char const *name )
+{
+    uint32_t thread = current_thread();
+    if (thread <= TRACE_MAX_THREADS)
+    {
+        atomic_store(&thread_names[thread], name);
+    }
+}
+
+/*
+ * Usage: trace_dump("trace")
+ * Writes everything still in the ring buffer to <path>.json and <path>.csv
+*/
+void trace_dump( char const *path )
+{
+    uint64_t last = atomic_load(&event_count);
+    uint64_t first = (last > TRACE_CAPACITY) ? last - TRACE_CAPACITY : 0;
+
+    char file_path[256];
+    snprintf(file_path, sizeof(file_path), "%s.json", path);
+    dump_chrome(file_path, first, last);
+    snprintf(file_path, sizeof(file_path), "%s.csv", path);
+    dump_csv(file_path, first, last);
+
+    printf("trace: wrote %llu events to %s.json and %s.csv\n", (unsigned long long) (last - first), path, path);
+}
+
+// Every producer claims its own slot with the fetch_add, so two threads only meet in one if the ring
+// laps a thread mid-write - the sequence then keeps the dump from reading the mixed up event
+static void write_event( TraceZone zone, uint64_t start_ns, uint64_t duration_ns, double value )
+{
+    uint64_t index = atomic_fetch_add_explicit(&event_count, 1, memory_order_relaxed);
+    TraceSlot *slot = &events[index & (TRACE_CAPACITY - 1)];
+    atomic_store_explicit(&slot->sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    uint64_t value_bits;
+    memcpy(&value_bits, &value, sizeof(value_bits));
+    atomic_store_explicit(&slot->start_ns, start_ns, memory_order_relaxed);
+    atomic_store_explicit(&slot->duration_ns, duration_ns, memory_order_relaxed);
+    atomic_store_explicit(&slot->value, value_bits, memory_order_relaxed);
+    atomic_store_explicit(&slot->zone, (unsigned) zone, memory_order_relaxed);
+    atomic_store_explicit(&slot->thread, current_thread(), memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, index + 1, memory_order_release);
+}
+
+// A copy of the event at index - false if it's still being written or has been overwritten since
+static bool read_event( uint64_t index, TraceEvent *out )
+{
+    TraceSlot *slot = &events[index & (TRACE_CAPACITY - 1)];
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != index + 1)
+    {
+        return false;
+    }
+    uint64_t value_bits = atomic_load_explicit(&slot->value, memory_order_relaxed);
+    memcpy(&out->value, &value_bits, sizeof(out->value));
+    out->start_ns = atomic_load_explicit(&slot->start_ns, memory_order_relaxed);
+    out->duration_ns = atomic_load_explicit(&slot->duration_ns, memory_order_relaxed);
+    out->zone = (TraceZone) atomic_load_explicit(&slot->zone, memory_order_relaxed);
+    out->thread = atomic_load_explicit(&slot->thread, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->sequence, memory_order_relaxed) == index + 1 && out->zone < TRACE_ZONE_COUNT;
+}
+
+static uint32_t current_thread( void )
+{
+    if (thread_id == 0)
+    {
+        thread_id = atomic_fetch_add_explicit(&thread_count, 1, memory_order_relaxed) + 1;
+    }
+    return thread_id;
+}
+
+static void dump_chrome( char const *path, uint64_t first, uint64_t last )
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "trace: could not open %s\n", path);
+        return;
+    }
+
+    // Track names first - every event ends with a separator and the process name closes the list
+    fprintf(file, "{\"traceEvents\":[\n");
+    uint32_t threads = atomic_load(&thread_count);
+    for (uint32_t thread = 1; thread <= threads && thread <= TRACE_MAX_THREADS; thread++)
+    {
+        char const *name = atomic_load(&thread_names[thread]);
+        if (name)
+        {
+            fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n", thread, name);
+        }
+    }
+    for (uint64_t i = first; i < last; i++)
+    {
+        TraceEvent event;
+        if (!read_event(i, &event))
+        {
+            continue;
+        }
+        // Chrome trace timestamps are in microseconds
+        if (event.zone == TRACE_FPS)
+        {
+            fprintf(file, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"%s\":%.2f}},\n",
+                zone_names[event.zone], event.start_ns / 1000.0, event.thread, zone_names[event.zone], event.value);
+        }
+        else
+        {
+            fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u},\n",
+                zone_names[event.zone], event.start_ns / 1000.0, event.duration_ns / 1000.0, event.thread);
+        }
+    }
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"arcade-fighter\"}}\n");
+    fprintf(file, "]}\n");
+    fclose(file);
+}
+
+static void dump_csv( char const *path, uint64_t first, uint64_t last )
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        fprintf(stderr, "trace: could not open %s\n", path);
+        return;
+    }
+
+    fprintf(file, "zone,thread,start_ns,duration_ns,value\n");
+    for (uint64_t i = first; i < last; i++)
+    {
+        TraceEvent event;
+        if (!read_event(i, &event))
+        {
+            continue;
+        }
+        fprintf(file, "%s,%u,%llu,%llu,%.2f\n", zone_names[event.zone], event.thread,
+            (unsigned long long) event.start_ns, (unsigned long long) event.duration_ns, event.value);
+    }
+    fclose(file);
+}
+
+#endif
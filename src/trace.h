@@ -0,0 +1,57 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Low overhead per-phase timing. Zones are recorded into a preallocated ring buffer and can be
+ * dumped as Chrome trace JSON (open in chrome://tracing or ui.perfetto.dev) and CSV.
+ * Only compiled in when built with ENABLE_TRACE (make TRACE=1) - otherwise every macro
+ * below expands to nothing and the zones cost nothing.
+ *
+ * Every thread that records gets its own track - TRACE_THREAD names it.
+ *
+ * Usage:
+ *   TRACE_THREAD("simulation");
+ *   TRACE_ZONE(TRACE_COMBAT_UPDATE) {
+ *       combat_update(player1, player2);
+ *   }
+ * Don't break/return out of a zone block - the zone would never get recorded.
+*/
+
+typedef enum {
+    TRACE_INPUT,
+    TRACE_PLAYER_UPDATE,
+    TRACE_COMBAT_UPDATE,
+    TRACE_DRAW_BACKGROUND,
+    TRACE_DRAW_PLAYER,
+    TRACE_END_FRAME,
+    TRACE_CAP_SLEEP,
+    TRACE_FPS,        // Counter rather than a zone
+    TRACE_ZONE_COUNT
+} TraceZone;
+
+#ifdef ENABLE_TRACE
+
+#define TRACE_ZONE(zone) \
+    for (uint64_t _trace_start = trace_now_ns(), _trace_once = 1; _trace_once; trace_record((zone), _trace_start), _trace_once = 0)
+#define TRACE_COUNTER(counter, value) trace_counter((counter), (value))
+#define TRACE_DUMP(path) trace_dump(path)
+#define TRACE_THREAD(name) trace_name_thread(name)
+
+extern uint64_t trace_now_ns( void );
+extern void trace_record( TraceZone zone, uint64_t start_ns );
+extern void trace_counter( TraceZone counter, double value );
+extern void trace_dump( char const *path );
+extern void trace_name_thread( char const *name );
+
+#else
+
+#define TRACE_ZONE(zone)
+#define TRACE_COUNTER(counter, value) ((void) (value))
+#define TRACE_DUMP(path) ((void) (path))
+#define TRACE_THREAD(name) ((void) (name))
+
+#endif
+
+#endif
@@ -0,0 +1,48 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+#include "triple_buffer.h"
+
+#define TRIPLE_BUFFER_NEW 4u
+#define TRIPLE_BUFFER_INDEX_MASK 3u
+
+// storage must hold 3 * slot_size bytes, every slot starts zeroed
+void triple_buffer_init( TripleBuffer *tb, void *storage, size_t slot_size )
+{
+    tb->storage = storage;
+    tb->slot_size = slot_size;
+    memset(storage, 0, 3 * slot_size);
+
+    tb->write_index = 0;
+    atomic_init(&tb->middle, 1);
+    tb->read_index = 2;
+}
+
+void *triple_buffer_write_slot( TripleBuffer *tb )
+{
+    return tb->storage + tb->write_index * tb->slot_size;
+}
+
+// Swaps the filled write slot into the middle - release so the reader sees everything we wrote
+void triple_buffer_publish( TripleBuffer *tb )
+{
+    unsigned previous = atomic_exchange_explicit(&tb->middle, tb->write_index | TRIPLE_BUFFER_NEW, memory_order_acq_rel);
+    tb->write_index = previous & TRIPLE_BUFFER_INDEX_MASK;
+}
+
+// Returns true if there was a newer value - otherwise the read slot is left as it was
+bool triple_buffer_acquire( TripleBuffer *tb )
+{
+    if (!(atomic_load_explicit(&tb->middle, memory_order_relaxed) & TRIPLE_BUFFER_NEW))
+    {
+        return false;
+    }
+    unsigned previous = atomic_exchange_explicit(&tb->middle, tb->read_index, memory_order_acq_rel);
+    tb->read_index = previous & TRIPLE_BUFFER_INDEX_MASK;
+    return true;
+}
+
+void *triple_buffer_read_slot( TripleBuffer *tb )
+{
+    return tb->storage + tb->read_index * tb->slot_size;
+}
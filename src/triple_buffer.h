@@ -0,0 +1,31 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Lock-free single writer / single reader triple buffer.
+ * The writer always has a slot of its own to fill, the reader always has a slot of its own to read,
+ * and the third slot holds the newest published value. Neither side ever waits on the other -
+ * the reader just sees the newest complete value and values it was too slow to see are skipped.
+ *
+ * Writer:  fill triple_buffer_write_slot(tb) then triple_buffer_publish(tb)
+ * Reader:  triple_buffer_acquire(tb) then read triple_buffer_read_slot(tb)
+*/
+typedef struct TripleBuffer {
+    unsigned char *storage;     // 3 slots of slot_size bytes - owned by the caller
+    size_t slot_size;
+    atomic_uint middle;         // Index of the published slot, TRIPLE_BUFFER_NEW set if reader hasn't taken it
+    unsigned write_index;       // Only touched by the writer
+    unsigned read_index;        // Only touched by the reader
+} TripleBuffer;
+
+extern void triple_buffer_init( TripleBuffer *tb, void *storage, size_t slot_size );
+extern void *triple_buffer_write_slot( TripleBuffer *tb );
+extern void triple_buffer_publish( TripleBuffer *tb );
+extern bool triple_buffer_acquire( TripleBuffer *tb );
+extern void *triple_buffer_read_slot( TripleBuffer *tb );
+
+#endif